@@ -0,0 +1,197 @@
+/*-
+ * Copyright (c) 2026 Xfce Development Team <xfce4-dev@xfce.org>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#ifdef HAVE_ERRNO_H
+#include <errno.h>
+#endif
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include <glib/gprintf.h>
+#include <libbladeutil/libbladeutil.h>
+#include <blxo/blxo.h>
+
+
+
+static gboolean  opt_help = FALSE;
+static gboolean  opt_version = FALSE;
+static gboolean  opt_dry_run = FALSE;
+static gchar    *opt_max_size = NULL;
+
+static GOptionEntry entries[] =
+{
+  { "help", '?', 0, G_OPTION_ARG_NONE, &opt_help, NULL, NULL, },
+  { "version", 'V', 0, G_OPTION_ARG_NONE, &opt_version, NULL, NULL, },
+  { "dry-run", 'n', 0, G_OPTION_ARG_NONE, &opt_dry_run, NULL, NULL, },
+  { "max-size", 's', 0, G_OPTION_ARG_STRING, &opt_max_size, NULL, NULL, },
+  { NULL, },
+};
+
+
+
+static void
+usage (void)
+{
+  g_print ("%s\n", _("Usage: blxo-thumbnail-gc [OPTIONS...]"));
+  g_print ("\n");
+  g_print ("%s\n", _("  -?, --help                          Print this help message and exit"));
+  g_print ("%s\n", _("  -V, --version                       Print version information and exit"));
+  g_print ("\n");
+  g_print ("%s\n", _("  -s, --max-size SIZE                 Remove the least recently used thumbnails\n"
+                     "                                      until the cache is at most SIZE bytes,\n"
+                     "                                      optionally followed by K, M or G."));
+  g_print ("%s\n", _("  -n, --dry-run                       Report what would be removed, without\n"
+                     "                                      removing anything."));
+  g_print ("\n");
+  g_print ("%s\n", _("Removes the thumbnails whose file no longer exists or was modified from\n"
+                     "the thumbnail cache, and then the least recently used thumbnails if the\n"
+                     "cache is larger than the --max-size."));
+  g_print ("\n");
+}
+
+
+
+static gboolean
+parse_size (const gchar *text,
+            guint64     *size_return)
+{
+  guint64  size;
+  gchar   *end;
+  guint    shift = 0;
+
+  /* g_ascii_strtoull() accepts negative values, which wrap around */
+  if (strchr (text, '-') != NULL)
+    return FALSE;
+
+  errno = 0;
+  size = g_ascii_strtoull (text, &end, 10);
+  if (end == text || errno == ERANGE)
+    return FALSE;
+
+  switch (g_ascii_toupper (*end))
+    {
+    case 'G':
+      shift += 10;
+      /* fall through */
+
+    case 'M':
+      shift += 10;
+      /* fall through */
+
+    case 'K':
+      shift += 10;
+      end++;
+      break;
+    }
+
+  /* reject sizes that do not fit, rather than wrapping to a small budget */
+  if (size > (G_MAXUINT64 >> shift))
+    return FALSE;
+  size <<= shift;
+
+  /* allow a B suffix, as in "500MB" */
+  if (g_ascii_toupper (*end) == 'B')
+    end++;
+
+  *size_return = size;
+
+  return (*end == '\0');
+}
+
+
+
+int
+main (int argc, char **argv)
+{
+  BlxoThumbnailGcStats  stats;
+  GOptionContext       *context;
+  GError               *err = NULL;
+  guint64               max_size = 0;
+  gchar                *reclaimed;
+  gchar                *remaining;
+
+#ifdef GETTEXT_PACKAGE
+  /* setup i18n support */
+  xfce_textdomain (GETTEXT_PACKAGE, PACKAGE_LOCALE_DIR, "UTF-8");
+#endif
+
+  /* try to parse the command line parameters */
+  context = g_option_context_new (NULL);
+  g_option_context_set_help_enabled (context, FALSE);
+  g_option_context_add_main_entries (context, entries, GETTEXT_PACKAGE);
+  if (!g_option_context_parse (context, &argc, &argv, &err))
+    {
+      g_fprintf (stderr, "blxo-thumbnail-gc: %s.\n", err->message);
+      g_error_free (err);
+      return EXIT_FAILURE;
+    }
+  g_option_context_free (context);
+
+  if (G_UNLIKELY (opt_help))
+    {
+      usage ();
+      return EXIT_SUCCESS;
+    }
+  else if (G_UNLIKELY (opt_version))
+    {
+      g_print ("%s %s\n\n", g_get_prgname (), PACKAGE_VERSION);
+      g_print (_("%s comes with ABSOLUTELY NO WARRANTY,\n"
+                 "You may redistribute copies of %s under the terms of\n"
+                 "the GNU Lesser General Public License which can be found in the\n"
+                 "%s source package.\n\n"), g_get_prgname (), g_get_prgname (), PACKAGE_TARNAME);
+      g_print (_("Please report bugs to <%s>.\n"), PACKAGE_BUGREPORT);
+      return EXIT_SUCCESS;
+    }
+
+  if (opt_max_size != NULL && !parse_size (opt_max_size, &max_size))
+    {
+      g_fprintf (stderr, "blxo-thumbnail-gc: ");
+      g_fprintf (stderr, _("Invalid size \"%s\""), opt_max_size);
+      g_fprintf (stderr, ".\n");
+      return EXIT_FAILURE;
+    }
+
+  if (!blxo_thumbnail_gc (max_size, opt_dry_run, &stats, NULL, &err))
+    {
+      g_fprintf (stderr, "blxo-thumbnail-gc: %s.\n", err->message);
+      g_error_free (err);
+      return EXIT_FAILURE;
+    }
+
+  reclaimed = g_format_size (stats.n_bytes_reclaimed);
+  remaining = g_format_size (stats.n_bytes_remaining);
+
+  g_print (opt_dry_run
+           ? _("Scanned %u thumbnails, would remove %u stale and %u least recently used, reclaiming %s (%s remaining).\n")
+           : _("Scanned %u thumbnails, removed %u stale and %u least recently used, reclaimed %s (%s remaining).\n"),
+           stats.n_scanned, stats.n_stale, stats.n_evicted, reclaimed, remaining);
+
+  g_free (reclaimed);
+  g_free (remaining);
+  g_free (opt_max_size);
+
+  return EXIT_SUCCESS;
+}
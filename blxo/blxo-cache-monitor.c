@@ -0,0 +1,490 @@
+/*-
+ * Copyright (c) 2026 Xfce Development Team <xfce4-dev@xfce.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include <gio/gio.h>
+
+#include <blxo/blxo-cache-monitor.h>
+#include <blxo/blxo-private.h>
+#include <blxo/blxo-alias.h>
+
+/* The cache monitor tells the in-memory caches when files they hold
+ * images of change, so cache hits do not need to stat() the file. The
+ * caches watch the files of their entries, and the parent directories
+ * of watched files are monitored with a GFileMonitor. Any event for a
+ * watched file marks it as changed; the changed files are collected for
+ * a short while, so bursts of events, like those of a file being written,
+ * evict the entries only once. The events are delivered by the default
+ * main context, where the caches are notified as well.
+ *
+ * Loads that race with a change are detected by the stamp returned by
+ * _blxo_cache_monitor_watch(), that can be compared with the stamp of the
+ * last change of the file using _blxo_cache_monitor_has_changed().
+ *
+ * Directories on remote file systems are not monitored, because changes
+ * made by other hosts are not reported for them; the caches keep checking
+ * the mtime of those files instead.
+ */
+
+/* the maximum number of monitored directories, beyond which files are not monitored */
+#define BLXO_CACHE_MONITOR_MAX_DIRS (256)
+
+/* milliseconds during which changes are collected before the caches are notified */
+#define BLXO_CACHE_MONITOR_DELAY (100)
+
+/* the maximum number of directories whose file system type is remembered */
+#define BLXO_CACHE_MONITOR_MAX_REMOTE (1024)
+
+
+
+typedef struct _BlxoCacheMonitorDir  BlxoCacheMonitorDir;
+typedef struct _BlxoCacheMonitorFile BlxoCacheMonitorFile;
+
+
+
+static void blxo_cache_monitor_dir_free     (BlxoCacheMonitorDir *dir);
+static void blxo_cache_monitor_file_free    (gpointer             data);
+static void blxo_cache_monitor_mark         (BlxoCacheMonitorDir *dir,
+                                            const gchar         *basename,
+                                            BlxoCacheMonitorFile *file);
+static void blxo_cache_monitor_mark_path    (const gchar         *path);
+static void blxo_cache_monitor_changed      (GFileMonitor        *monitor,
+                                            GFile               *file,
+                                            GFile               *other_file,
+                                            GFileMonitorEvent    event_type,
+                                            gpointer             user_data);
+static gboolean blxo_cache_monitor_dispatch (gpointer             user_data);
+static gboolean blxo_cache_monitor_is_remote (GFile             *gfile,
+                                              const gchar       *dirname);
+
+
+
+struct _BlxoCacheMonitorDir
+{
+  gchar        *path;
+  GFileMonitor *monitor;
+
+  /* the watched files, by basename */
+  GHashTable   *files;
+};
+
+struct _BlxoCacheMonitorFile
+{
+  guint ref_count;
+
+  /* the stamp of the last change, or 0 */
+  guint changed;
+};
+
+
+
+static GHashTable *monitor_dirs = NULL;
+static GHashTable *monitor_pending = NULL;
+static GHashTable *monitor_remote = NULL;
+static GSList     *monitor_funcs = NULL;
+static guint       monitor_stamp = 0;
+static guint       monitor_dispatch_id = 0;
+G_LOCK_DEFINE_STATIC (cache_monitor);
+
+
+
+static void
+blxo_cache_monitor_dir_free (BlxoCacheMonitorDir *dir)
+{
+  if (G_LIKELY (dir->monitor != NULL))
+    {
+      g_file_monitor_cancel (dir->monitor);
+      g_object_unref (G_OBJECT (dir->monitor));
+    }
+
+  g_hash_table_destroy (dir->files);
+  g_free (dir->path);
+  g_slice_free (BlxoCacheMonitorDir, dir);
+}
+
+
+
+static void
+blxo_cache_monitor_file_free (gpointer data)
+{
+  g_slice_free (BlxoCacheMonitorFile, data);
+}
+
+
+
+static void
+blxo_cache_monitor_mark (BlxoCacheMonitorDir  *dir,
+                         const gchar          *basename,
+                         BlxoCacheMonitorFile *file)
+{
+  file->changed = ++monitor_stamp;
+
+  if (G_UNLIKELY (monitor_pending == NULL))
+    monitor_pending = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  g_hash_table_add (monitor_pending, g_build_filename (dir->path, basename, NULL));
+
+  /* notify the caches once the burst of events is over */
+  if (monitor_dispatch_id == 0)
+    monitor_dispatch_id = g_timeout_add (BLXO_CACHE_MONITOR_DELAY, blxo_cache_monitor_dispatch, NULL);
+}
+
+
+
+static void
+blxo_cache_monitor_mark_path (const gchar *path)
+{
+  BlxoCacheMonitorFile *file;
+  BlxoCacheMonitorDir  *dir;
+  GHashTableIter        iter;
+  const gchar          *basename;
+  gchar                *dirname;
+
+  /* the monitored directory itself was removed or unmounted, which affects all its files */
+  dir = g_hash_table_lookup (monitor_dirs, path);
+  if (G_UNLIKELY (dir != NULL))
+    {
+      g_hash_table_iter_init (&iter, dir->files);
+      while (g_hash_table_iter_next (&iter, (gpointer *) &basename, (gpointer *) &file))
+        blxo_cache_monitor_mark (dir, basename, file);
+      return;
+    }
+
+  dirname = g_path_get_dirname (path);
+  dir = g_hash_table_lookup (monitor_dirs, dirname);
+  g_free (dirname);
+
+  /* events of files that are not watched are ignored */
+  if (dir != NULL)
+    {
+      basename = strrchr (path, G_DIR_SEPARATOR) + 1;
+      file = g_hash_table_lookup (dir->files, basename);
+      if (file != NULL)
+        blxo_cache_monitor_mark (dir, basename, file);
+    }
+}
+
+
+
+static void
+blxo_cache_monitor_changed (GFileMonitor     *monitor,
+                            GFile            *file,
+                            GFile            *other_file,
+                            GFileMonitorEvent event_type,
+                            gpointer          user_data)
+{
+  BlxoCacheMonitorDir *dir;
+  const gchar         *dirname = user_data;
+  gchar               *path;
+
+  G_LOCK (cache_monitor);
+
+  /* the directory may no longer be watched, or be watched by a new monitor */
+  dir = g_hash_table_lookup (monitor_dirs, dirname);
+  if (G_LIKELY (dir != NULL && dir->monitor == monitor))
+    {
+      if (event_type == G_FILE_MONITOR_EVENT_PRE_UNMOUNT || event_type == G_FILE_MONITOR_EVENT_UNMOUNTED)
+        {
+          blxo_cache_monitor_mark_path (dirname);
+        }
+      else
+        {
+          /* files may be replaced by a rename, so every event of a watched file counts */
+          path = g_file_get_path (file);
+          if (G_LIKELY (path != NULL)
+              && (strcmp (path, dirname) != 0
+                  || event_type == G_FILE_MONITOR_EVENT_DELETED
+                  || event_type == G_FILE_MONITOR_EVENT_MOVED))
+            blxo_cache_monitor_mark_path (path);
+          g_free (path);
+
+          path = (other_file != NULL) ? g_file_get_path (other_file) : NULL;
+          if (G_UNLIKELY (path != NULL))
+            blxo_cache_monitor_mark_path (path);
+          g_free (path);
+        }
+    }
+
+  G_UNLOCK (cache_monitor);
+}
+
+
+
+static gboolean
+blxo_cache_monitor_dispatch (gpointer user_data)
+{
+  GHashTable *filenames;
+  GSList     *funcs;
+  GSList     *lp;
+
+  G_LOCK (cache_monitor);
+  filenames = monitor_pending;
+  funcs = g_slist_copy (monitor_funcs);
+  monitor_pending = NULL;
+  monitor_dispatch_id = 0;
+  G_UNLOCK (cache_monitor);
+
+  /* the caches take their own locks, and unwatch files while evicting entries */
+  if (G_LIKELY (filenames != NULL))
+    {
+      for (lp = funcs; lp != NULL; lp = lp->next)
+        ((BlxoCacheMonitorFunc) lp->data) (filenames);
+      g_hash_table_destroy (filenames);
+    }
+
+  g_slist_free (funcs);
+
+  return FALSE;
+}
+
+
+
+static gboolean
+blxo_cache_monitor_is_remote (GFile       *gfile,
+                              const gchar *dirname)
+{
+  GFileInfo *info;
+  gpointer   value;
+  gboolean   remote = FALSE;
+
+  /* directories are watched and unwatched all the time, but their file system does not change */
+  if (G_UNLIKELY (monitor_remote == NULL))
+    monitor_remote = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  else if (g_hash_table_lookup_extended (monitor_remote, dirname, NULL, &value))
+    return GPOINTER_TO_INT (value);
+
+  info = g_file_query_filesystem_info (gfile, G_FILE_ATTRIBUTE_FILESYSTEM_REMOTE, NULL, NULL);
+  if (G_LIKELY (info != NULL))
+    {
+      remote = g_file_info_get_attribute_boolean (info, G_FILE_ATTRIBUTE_FILESYSTEM_REMOTE);
+      g_object_unref (G_OBJECT (info));
+    }
+
+  if (g_hash_table_size (monitor_remote) >= BLXO_CACHE_MONITOR_MAX_REMOTE)
+    g_hash_table_remove_all (monitor_remote);
+  g_hash_table_insert (monitor_remote, g_strdup (dirname), GINT_TO_POINTER (remote));
+
+  return remote;
+}
+
+
+
+/**
+ * _blxo_cache_monitor_connect:
+ * @func : the function that evicts cache entries.
+ *
+ * Registers @func to be called with the files that changed. The
+ * functions registered cannot be removed again.
+ **/
+void
+_blxo_cache_monitor_connect (BlxoCacheMonitorFunc func)
+{
+  _blxo_return_if_fail (func != NULL);
+
+  G_LOCK (cache_monitor);
+  if (g_slist_find (monitor_funcs, (gpointer) func) == NULL)
+    monitor_funcs = g_slist_prepend (monitor_funcs, (gpointer) func);
+  G_UNLOCK (cache_monitor);
+}
+
+
+
+/**
+ * _blxo_cache_monitor_watch:
+ * @filename     : the absolute path to a file.
+ * @stamp_return : return location for the current stamp or %NULL.
+ *
+ * Watches @filename for changes, until it is unwatched again using
+ * _blxo_cache_monitor_unwatch(). Watches are counted, so every call
+ * requires a matching call to _blxo_cache_monitor_unwatch().
+ *
+ * The @stamp_return can be passed to _blxo_cache_monitor_has_changed()
+ * later to find out whether @filename changed after this call.
+ *
+ * May be called from any thread.
+ *
+ * Returns: %TRUE if changes of @filename are reported, %FALSE if its
+ *          directory could not be monitored or is on a remote file system.
+ **/
+gboolean
+_blxo_cache_monitor_watch (const gchar *filename,
+                           guint       *stamp_return)
+{
+  BlxoCacheMonitorFile *file;
+  BlxoCacheMonitorDir  *dir;
+  gboolean              monitored;
+  GFile                *gfile;
+  gchar                *dirname;
+  gchar                *basename;
+
+  _blxo_return_val_if_fail (g_path_is_absolute (filename), FALSE);
+
+  dirname = g_path_get_dirname (filename);
+  basename = g_path_get_basename (filename);
+
+  G_LOCK (cache_monitor);
+
+  if (G_UNLIKELY (monitor_dirs == NULL))
+    monitor_dirs = g_hash_table_new (g_str_hash, g_str_equal);
+
+  dir = g_hash_table_lookup (monitor_dirs, dirname);
+  if (G_UNLIKELY (dir == NULL))
+    {
+      dir = g_slice_new0 (BlxoCacheMonitorDir);
+      dir->files = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, blxo_cache_monitor_file_free);
+
+      /* the events are delivered by the default main context, also for monitors created on worker threads */
+      if (g_hash_table_size (monitor_dirs) < BLXO_CACHE_MONITOR_MAX_DIRS)
+        {
+          /* NFS, CIFS and FUSE mounts can be monitored, but changes made by other hosts are not reported */
+          gfile = g_file_new_for_path (dirname);
+          if (!blxo_cache_monitor_is_remote (gfile, dirname))
+            dir->monitor = g_file_monitor_directory (gfile, G_FILE_MONITOR_NONE, NULL, NULL);
+          g_object_unref (G_OBJECT (gfile));
+
+          if (G_LIKELY (dir->monitor != NULL))
+            {
+              g_signal_connect_data (G_OBJECT (dir->monitor), "changed", G_CALLBACK (blxo_cache_monitor_changed),
+                                     g_strdup (dirname), (GClosureNotify) g_free, 0);
+            }
+        }
+
+      dir->path = dirname;
+      dirname = NULL;
+      g_hash_table_insert (monitor_dirs, dir->path, dir);
+    }
+
+  file = g_hash_table_lookup (dir->files, basename);
+  if (G_LIKELY (file == NULL))
+    {
+      file = g_slice_new0 (BlxoCacheMonitorFile);
+      g_hash_table_insert (dir->files, basename, file);
+      basename = NULL;
+    }
+
+  file->ref_count++;
+
+  if (stamp_return != NULL)
+    *stamp_return = monitor_stamp;
+  monitored = (dir->monitor != NULL);
+
+  G_UNLOCK (cache_monitor);
+
+  g_free (dirname);
+  g_free (basename);
+
+  return monitored;
+}
+
+
+
+/**
+ * _blxo_cache_monitor_unwatch:
+ * @filename : the absolute path to a watched file.
+ *
+ * Drops a watch of @filename added by _blxo_cache_monitor_watch(). The
+ * monitor of the directory is released with the last watched file in it.
+ *
+ * May be called from any thread.
+ **/
+void
+_blxo_cache_monitor_unwatch (const gchar *filename)
+{
+  BlxoCacheMonitorFile *file;
+  BlxoCacheMonitorDir  *dir;
+  gchar                *dirname;
+  gchar                *basename;
+
+  _blxo_return_if_fail (g_path_is_absolute (filename));
+
+  dirname = g_path_get_dirname (filename);
+  basename = g_path_get_basename (filename);
+
+  G_LOCK (cache_monitor);
+
+  dir = (monitor_dirs != NULL) ? g_hash_table_lookup (monitor_dirs, dirname) : NULL;
+  file = (dir != NULL) ? g_hash_table_lookup (dir->files, basename) : NULL;
+  if (G_LIKELY (file != NULL) && --file->ref_count == 0)
+    {
+      g_hash_table_remove (dir->files, basename);
+      if (g_hash_table_size (dir->files) == 0)
+        {
+          g_hash_table_remove (monitor_dirs, dir->path);
+          blxo_cache_monitor_dir_free (dir);
+        }
+    }
+
+  G_UNLOCK (cache_monitor);
+
+  g_free (dirname);
+  g_free (basename);
+}
+
+
+
+/**
+ * _blxo_cache_monitor_has_changed:
+ * @filename : the absolute path to a watched file.
+ * @stamp    : a stamp returned by _blxo_cache_monitor_watch().
+ *
+ * Checks whether a change of the watched @filename was reported after
+ * the @stamp was taken. Changes that happened before the event is
+ * delivered to the main context are not known yet.
+ *
+ * May be called from any thread.
+ *
+ * Returns: %TRUE if @filename changed after @stamp.
+ **/
+gboolean
+_blxo_cache_monitor_has_changed (const gchar *filename,
+                                 guint        stamp)
+{
+  BlxoCacheMonitorFile *file;
+  BlxoCacheMonitorDir  *dir;
+  gboolean              changed;
+  gchar                *dirname;
+
+  _blxo_return_val_if_fail (g_path_is_absolute (filename), FALSE);
+
+  dirname = g_path_get_dirname (filename);
+
+  G_LOCK (cache_monitor);
+
+  dir = (monitor_dirs != NULL) ? g_hash_table_lookup (monitor_dirs, dirname) : NULL;
+  file = (dir != NULL) ? g_hash_table_lookup (dir->files, strrchr (filename, G_DIR_SEPARATOR) + 1) : NULL;
+  changed = (file != NULL && file->changed > stamp);
+
+  G_UNLOCK (cache_monitor);
+
+  g_free (dirname);
+
+  return changed;
+}
+
+
+
+#define __BLXO_CACHE_MONITOR_C__
+#include <blxo/blxo-aliasdef.c>
@@ -0,0 +1,51 @@
+/*-
+ * Copyright (c) 2026 Xfce Development Team <xfce4-dev@xfce.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+
+#if !defined (BLXO_COMPILATION)
+#error "Only <blxo/blxo.h> can be included directly, this file is not part of the public API."
+#endif
+
+#ifndef __BLXO_CACHE_MONITOR_H__
+#define __BLXO_CACHE_MONITOR_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+ * BlxoCacheMonitorFunc:
+ * @filenames : the set of absolute paths of the files that changed.
+ *
+ * Called on the main thread to evict the cache entries of @filenames.
+ **/
+typedef void (*BlxoCacheMonitorFunc) (GHashTable *filenames);
+
+G_GNUC_INTERNAL void     _blxo_cache_monitor_connect     (BlxoCacheMonitorFunc func);
+
+G_GNUC_INTERNAL gboolean _blxo_cache_monitor_watch       (const gchar         *filename,
+                                                         guint               *stamp_return);
+G_GNUC_INTERNAL void     _blxo_cache_monitor_unwatch     (const gchar         *filename);
+
+G_GNUC_INTERNAL gboolean _blxo_cache_monitor_has_changed (const gchar         *filename,
+                                                         guint                stamp);
+
+G_END_DECLS
+
+#endif /* !__BLXO_CACHE_MONITOR_H__ */
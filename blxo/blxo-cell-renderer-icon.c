@@ -22,10 +22,15 @@
 #include <config.h>
 #endif
 
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
 #include <gio/gio.h>
 
 #include <blxo/blxo-cell-renderer-icon.h>
 #include <blxo/blxo-gdk-pixbuf-extensions.h>
+#include <blxo/blxo-icon-cache.h>
 #include <blxo/blxo-private.h>
 #include <blxo/blxo-thumbnail.h>
 #include <blxo/blxo-alias.h>
@@ -48,6 +53,11 @@
  * rendering icons based on the state of the view if the
  * <link linkend="BlxoCellRendererIcon--follow-state">follow-state</link>
  * property is set.
+ *
+ * Loading image files and scalable icons can take a while, so if the
+ * <link linkend="BlxoCellRendererIcon--async">async</link> property is set,
+ * the renderer draws a placeholder icon until the image was loaded in the
+ * background, and redraws the cell afterwards.
  **/
 
 /* HACK: fix dead API via #define */
@@ -55,10 +65,14 @@
 # define gtk_icon_info_free(info) g_object_unref (info)
 #endif
 
+/* pack the channels of a GdkColor for use in a BlxoIconCacheVariant */
+#define PACK_COLOR(color) (((guint64) (color)->red << 32) | ((guint64) (color)->green << 16) | (guint64) (color)->blue)
+
 /* Property identifiers */
 enum
 {
   PROP_0,
+  PROP_ASYNC,
   PROP_FOLLOW_STATE,
   PROP_ICON,
   PROP_GICON,
@@ -106,8 +120,28 @@ static void blxo_cell_renderer_icon_render       (GtkCellRenderer          *rend
 
 
 
+typedef struct
+{
+  gchar *name;
+  gint   size;
+  gint   scale;
+} BlxoCellRendererIconSizeKey;
+
+typedef struct
+{
+  /* placeholder pixbufs for async loads, by size */
+  GHashTable *placeholders;
+
+  /* best icon size, by BlxoCellRendererIconSizeKey */
+  GHashTable *sizes;
+
+  /* the file to prefetch or %NULL, by BlxoCellRendererIconSizeKey */
+  GHashTable *prefetch_files;
+} BlxoCellRendererIconThemeData;
+
 struct _BlxoCellRendererIconPrivate
 {
+  guint  async : 1;
   guint  follow_state : 1;
   guint  icon_static : 1;
   gchar *icon;
@@ -139,6 +173,23 @@ blxo_cell_renderer_icon_class_init (BlxoCellRendererIconClass *klass)
   /* initialize the library's i18n support */
   _blxo_i18n_init ();
 
+  /**
+   * BlxoCellRendererIcon:async:
+   *
+   * Specifies whether image files and scalable icons should be loaded
+   * in the background. Until the image is available, a themed placeholder
+   * icon is rendered and the cell is redrawn once the image was loaded.
+   *
+   * Since: 0.13.0
+   **/
+  g_object_class_install_property (gobject_class,
+                                   PROP_ASYNC,
+                                   g_param_spec_boolean ("async",
+                                                         _("Async"),
+                                                         _("Load image files in the background."),
+                                                         FALSE,
+                                                         BLXO_PARAM_READWRITE));
+
   /**
    * BlxoCellRendererIcon:follow-state:
    *
@@ -257,6 +308,10 @@ blxo_cell_renderer_icon_get_property (GObject    *object,
 
   switch (prop_id)
     {
+    case PROP_ASYNC:
+      g_value_set_boolean (value, priv->async);
+      break;
+
     case PROP_FOLLOW_STATE:
       g_value_set_boolean (value, priv->follow_state);
       break;
@@ -292,6 +347,10 @@ blxo_cell_renderer_icon_set_property (GObject      *object,
 
   switch (prop_id)
     {
+    case PROP_ASYNC:
+      priv->async = g_value_get_boolean (value);
+      break;
+
     case PROP_FOLLOW_STATE:
       priv->follow_state = g_value_get_boolean (value);
       break;
@@ -345,6 +404,11 @@ blxo_cell_renderer_icon_get_size (GtkCellRenderer *renderer,
   gtk_cell_renderer_get_alignment (renderer, &xalign, &yalign);
   gtk_cell_renderer_get_padding (renderer, &xpad, &ypad);
 
+  /* the cell is positioned to be painted soon, unlike when the view only
+   * measures its rows for the layout */
+  if (cell_area != NULL)
+    _blxo_cell_renderer_icon_prefetch (renderer, widget);
+
   if (cell_area != NULL)
     {
       if (x_offset != NULL)
@@ -377,6 +441,325 @@ blxo_cell_renderer_icon_get_size (GtkCellRenderer *renderer,
 }
 
 
+
+static guint
+blxo_cell_renderer_icon_size_key_hash (gconstpointer data)
+{
+  const BlxoCellRendererIconSizeKey *key = data;
+
+  return g_str_hash (key->name) ^ (key->size * key->scale);
+}
+
+
+
+static gboolean
+blxo_cell_renderer_icon_size_key_equal (gconstpointer a,
+                                       gconstpointer b)
+{
+  const BlxoCellRendererIconSizeKey *key_a = a;
+  const BlxoCellRendererIconSizeKey *key_b = b;
+
+  return (key_a->size == key_b->size && key_a->scale == key_b->scale && strcmp (key_a->name, key_b->name) == 0);
+}
+
+
+
+static void
+blxo_cell_renderer_icon_size_key_free (gpointer data)
+{
+  BlxoCellRendererIconSizeKey *key = data;
+
+  g_free (key->name);
+  g_slice_free (BlxoCellRendererIconSizeKey, key);
+}
+
+
+
+static void
+blxo_cell_renderer_icon_theme_data_free (gpointer data)
+{
+  BlxoCellRendererIconThemeData *theme_data = data;
+
+  g_hash_table_destroy (theme_data->placeholders);
+  g_hash_table_destroy (theme_data->sizes);
+  g_hash_table_destroy (theme_data->prefetch_files);
+  g_slice_free (BlxoCellRendererIconThemeData, theme_data);
+}
+
+
+
+static void
+blxo_cell_renderer_icon_theme_changed (GtkIconTheme                 *icon_theme,
+                                      BlxoCellRendererIconThemeData *theme_data)
+{
+  /* everything we remembered about the theme is invalid now */
+  g_hash_table_remove_all (theme_data->placeholders);
+  g_hash_table_remove_all (theme_data->sizes);
+  g_hash_table_remove_all (theme_data->prefetch_files);
+}
+
+
+
+static BlxoCellRendererIconThemeData*
+blxo_cell_renderer_icon_get_theme_data (GtkIconTheme *icon_theme)
+{
+  BlxoCellRendererIconThemeData *theme_data;
+
+  /* the data is shared by all renderers using the icon theme */
+  theme_data = g_object_get_data (G_OBJECT (icon_theme), "blxo-cell-renderer-icon-theme-data");
+  if (G_UNLIKELY (theme_data == NULL))
+    {
+      theme_data = g_slice_new (BlxoCellRendererIconThemeData);
+      theme_data->placeholders = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_object_unref);
+      theme_data->sizes = g_hash_table_new_full (blxo_cell_renderer_icon_size_key_hash,
+                                                 blxo_cell_renderer_icon_size_key_equal,
+                                                 blxo_cell_renderer_icon_size_key_free, NULL);
+      theme_data->prefetch_files = g_hash_table_new_full (blxo_cell_renderer_icon_size_key_hash,
+                                                          blxo_cell_renderer_icon_size_key_equal,
+                                                          blxo_cell_renderer_icon_size_key_free, g_free);
+      g_object_set_data_full (G_OBJECT (icon_theme), "blxo-cell-renderer-icon-theme-data",
+                              theme_data, blxo_cell_renderer_icon_theme_data_free);
+      g_signal_connect (G_OBJECT (icon_theme), "changed", G_CALLBACK (blxo_cell_renderer_icon_theme_changed), theme_data);
+    }
+
+  return theme_data;
+}
+
+
+
+static gint
+blxo_cell_renderer_icon_get_best_size (GtkIconTheme *icon_theme,
+                                      const gchar  *name,
+                                      gint          size)
+{
+  BlxoCellRendererIconThemeData *theme_data;
+  BlxoCellRendererIconSizeKey    lookup_key;
+  BlxoCellRendererIconSizeKey   *key;
+  gpointer                      value;
+  gint                         *icon_sizes;
+  gint                          icon_size;
+  gint                          n;
+
+  /* check if we already know the best size */
+  theme_data = blxo_cell_renderer_icon_get_theme_data (icon_theme);
+  lookup_key.name = (gchar *) name;
+  lookup_key.size = size;
+  lookup_key.scale = 1;
+  if (g_hash_table_lookup_extended (theme_data->sizes, &lookup_key, NULL, &value))
+    return GPOINTER_TO_INT (value);
+
+  /* determine the best icon size (GtkIconTheme is somewhat messy scaling up small icons) */
+  icon_sizes = gtk_icon_theme_get_icon_sizes (icon_theme, name);
+  for (icon_size = -1, n = 0; icon_sizes[n] != 0; ++n)
+    {
+      /* we can use any size if scalable, because we load the file directly */
+      if (icon_sizes[n] == -1)
+        icon_size = size;
+      else if (icon_sizes[n] > icon_size && icon_sizes[n] <= size)
+        icon_size = icon_sizes[n];
+    }
+  g_free (icon_sizes);
+
+  /* if we don't know any icon sizes at all, the icon is probably not present */
+  if (G_UNLIKELY (icon_size < 0))
+    icon_size = size;
+
+  /* remember the size for the next paint */
+  key = g_slice_new (BlxoCellRendererIconSizeKey);
+  key->name = g_strdup (name);
+  key->size = size;
+  key->scale = 1;
+  g_hash_table_insert (theme_data->sizes, key, GINT_TO_POINTER (icon_size));
+
+  return icon_size;
+}
+
+
+
+static inline gboolean
+blxo_cell_renderer_icon_use_thumbnail (const gchar *filename)
+{
+  /* loading SVG icons is terribly slow, so we try to use thumbnail instead */
+  return g_str_has_suffix (filename, ".svg");
+}
+
+
+
+static const gchar*
+blxo_cell_renderer_icon_get_prefetch_file (GtkIconTheme *icon_theme,
+                                          const gchar  *name,
+                                          gint          size,
+                                          gint          scale_factor)
+{
+  BlxoCellRendererIconThemeData *theme_data;
+  BlxoCellRendererIconSizeKey    lookup_key;
+  BlxoCellRendererIconSizeKey   *key;
+  GtkIconInfo                  *icon_info;
+  const gchar                  *filename;
+  gpointer                      value;
+  gchar                        *prefetch_file = NULL;
+  gint                          icon_size;
+
+  /* check if we already resolved the icon, icon theme lookups are not cached */
+  theme_data = blxo_cell_renderer_icon_get_theme_data (icon_theme);
+  lookup_key.name = (gchar *) name;
+  lookup_key.size = size;
+  lookup_key.scale = scale_factor;
+  if (g_hash_table_lookup_extended (theme_data->prefetch_files, &lookup_key, NULL, &value))
+    return value;
+
+  icon_size = blxo_cell_renderer_icon_get_best_size (icon_theme, name, size);
+#if GTK_CHECK_VERSION (3, 0, 0)
+  icon_info = gtk_icon_theme_lookup_icon_for_scale (icon_theme, name, icon_size, scale_factor, 0);
+#else
+  icon_info = gtk_icon_theme_lookup_icon (icon_theme, name, icon_size, 0);
+#endif
+  if (G_LIKELY (icon_info != NULL))
+    {
+      /* only the icons loaded via the thumbnail path are prefetched */
+      filename = gtk_icon_info_get_filename (icon_info);
+      if (filename != NULL && blxo_cell_renderer_icon_use_thumbnail (filename))
+        prefetch_file = g_strdup (filename);
+      gtk_icon_info_free (icon_info);
+    }
+
+  /* remember the file, or that there is nothing to prefetch */
+  key = g_slice_new (BlxoCellRendererIconSizeKey);
+  key->name = g_strdup (name);
+  key->size = size;
+  key->scale = scale_factor;
+  g_hash_table_insert (theme_data->prefetch_files, key, prefetch_file);
+
+  return prefetch_file;
+}
+
+
+
+/**
+ * _blxo_cell_renderer_icon_prefetch:
+ * @renderer : a #BlxoCellRendererIcon.
+ * @widget   : the #GtkWidget the @renderer paints on.
+ *
+ * Queues loading the image of the current cell data of @renderer on a
+ * worker thread, because the cell is likely to be painted soon. Views call
+ * this for the rows around their visible area, after setting the cell data.
+ **/
+void
+_blxo_cell_renderer_icon_prefetch (GtkCellRenderer *renderer,
+                                  GtkWidget       *widget)
+{
+  const BlxoCellRendererIconPrivate *priv = blxo_cell_renderer_icon_get_instance_private (BLXO_CELL_RENDERER_ICON (renderer));
+  GtkIconTheme                     *icon_theme;
+  const gchar                      *filename;
+  gint                              scale_factor = 1;
+
+  /* only image files and scalable named icons are worth to be prefetched;
+   * views that load synchronously find them in the cache when painting */
+  if (priv->icon == NULL)
+    return;
+
+  /* the rows of hidden views are not going to be painted soon */
+  if (!gtk_widget_get_realized (widget) || !gtk_widget_get_visible (widget))
+    return;
+
+#if GTK_CHECK_VERSION (3, 0, 0)
+  scale_factor = gtk_widget_get_scale_factor (widget);
+#endif
+
+  if (g_path_is_absolute (priv->icon))
+    {
+      filename = priv->icon;
+    }
+  else
+    {
+      icon_theme = gtk_icon_theme_get_for_screen (gtk_widget_get_screen (widget));
+      filename = blxo_cell_renderer_icon_get_prefetch_file (icon_theme, priv->icon, priv->size, scale_factor);
+    }
+
+  /* rasterize the image on a worker thread, the same way render() loads it */
+  if (filename != NULL)
+    _blxo_icon_cache_prefetch (filename, _blxo_thumbnail_size_for (priv->size * scale_factor),
+                               _blxo_thumbnail_size_for (priv->size));
+}
+
+
+
+static GdkPixbuf*
+blxo_cell_renderer_icon_get_placeholder (GtkIconTheme *icon_theme,
+                                        gint          size)
+{
+  BlxoCellRendererIconThemeData *theme_data;
+  GdkPixbuf                    *placeholder;
+
+  theme_data = blxo_cell_renderer_icon_get_theme_data (icon_theme);
+  placeholder = g_hash_table_lookup (theme_data->placeholders, GINT_TO_POINTER (size));
+  if (G_UNLIKELY (placeholder == NULL))
+    {
+      placeholder = gtk_icon_theme_load_icon (icon_theme, "image-loading", size, 0, NULL);
+      if (G_UNLIKELY (placeholder == NULL))
+        placeholder = gtk_icon_theme_load_icon (icon_theme, "image-x-generic", size, 0, NULL);
+      if (G_UNLIKELY (placeholder == NULL))
+        return NULL;
+
+      g_hash_table_insert (theme_data->placeholders, GINT_TO_POINTER (size), placeholder);
+    }
+
+  return g_object_ref (G_OBJECT (placeholder));
+}
+
+
+
+#if GTK_CHECK_VERSION (3, 0, 0)
+static GdkPixbuf*
+blxo_cell_renderer_icon_get_effect_dest (GdkPixbuf *icon,
+                                        gboolean   icon_owned)
+{
+  /* effects can be applied in place, if nobody else knows the icon */
+  if (icon_owned)
+    return g_object_ref (G_OBJECT (icon));
+
+  /* otherwise reuse the pixels of an icon we released earlier */
+  return _blxo_gdk_pixbuf_new_recycled (gdk_pixbuf_get_has_alpha (icon),
+                                        gdk_pixbuf_get_width (icon),
+                                        gdk_pixbuf_get_height (icon));
+}
+#endif
+
+
+
+static cairo_surface_t*
+blxo_cell_renderer_icon_create_surface (GdkPixbuf *pixbuf,
+                                       GtkWidget *widget,
+                                       gint       scale_factor)
+{
+  cairo_surface_t *surface;
+#if !GTK_CHECK_VERSION (3, 0, 0)
+  cairo_t         *surface_cr;
+#endif
+
+#if GTK_CHECK_VERSION (3, 0, 0)
+  /* let gdk create an image surface, that is similar to the window's surface */
+  surface = gdk_cairo_surface_create_from_pixbuf (pixbuf, scale_factor, gtk_widget_get_window (widget));
+#else
+  /* the surface is cached for all widgets, including those on other screens and
+   * printing or offscreen targets, so it must not be tied to a display or visual */
+  surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+                                        gdk_pixbuf_get_width (pixbuf),
+                                        gdk_pixbuf_get_height (pixbuf));
+
+  /* premultiply the pixbuf into the surface */
+  surface_cr = cairo_create (surface);
+  cairo_set_operator (surface_cr, CAIRO_OPERATOR_SOURCE);
+  gdk_cairo_set_source_pixbuf (surface_cr, pixbuf, 0, 0);
+  cairo_paint (surface_cr);
+  cairo_destroy (surface_cr);
+#endif
+
+  return surface;
+}
+
+
+
 #if GTK_CHECK_VERSION (3, 0, 0)
 static void
 blxo_cell_renderer_icon_render (GtkCellRenderer     *renderer,
@@ -389,7 +772,7 @@ blxo_cell_renderer_icon_render (GtkCellRenderer     *renderer,
     GdkRectangle        clip_area;
     GdkRectangle       *expose_area = &clip_area;
     GdkRGBA            *color_rgba;
-    GdkColor            color_gdk;
+    GdkColor            insensitive_color;
     GtkStyleContext    *style_context;
 #else
 static void
@@ -403,6 +786,7 @@ blxo_cell_renderer_icon_render (GtkCellRenderer     *renderer,
 {
   cairo_t *cr = gdk_cairo_create (window);
   GtkIconSource                    *icon_source;
+  GtkStyle                         *style;
   GtkStateType                      state;
 #endif
   const BlxoCellRendererIconPrivate *priv = blxo_cell_renderer_icon_get_instance_private (BLXO_CELL_RENDERER_ICON (renderer));
@@ -410,60 +794,78 @@ blxo_cell_renderer_icon_render (GtkCellRenderer     *renderer,
   GdkRectangle                      icon_area;
   GdkRectangle                      draw_area;
   const gchar                      *filename;
+  const gchar                      *thumbnail_path = NULL;
+  BlxoThumbnailSize                  thumbnail_size;
+  BlxoThumbnailSize                  base_size;
+  const gchar                      *cache_path = NULL;
+  gint                              cache_size = 0;
+  BlxoIconCacheVariant               variant;
+  BlxoGdkPixbufEffects               effects;
+  gboolean                          has_variant;
+  gboolean                          is_variant;
+  gboolean                          icon_owned = FALSE;
+  GdkColor                          selected_color;
+  gboolean                          failed;
   GtkIconInfo                      *icon_info = NULL;
   GdkPixbuf                        *icon = NULL;
   GdkPixbuf                        *temp;
   GError                           *err = NULL;
   gchar                            *display_name = NULL;
-  gint                             *icon_sizes;
   gint                              icon_size;
-  gint                              n;
+  gint                              scale_factor = 1;
+  cairo_surface_t                  *surface = NULL;
 
 #if GTK_CHECK_VERSION (3, 0, 0)
   gdk_cairo_get_clip_rectangle (cr, expose_area);
+
+  /* icons are loaded in device pixels on HiDPI displays */
+  scale_factor = gtk_widget_get_scale_factor (widget);
 #endif
 
   /* verify that we have an icon */
   if (G_UNLIKELY (priv->icon == NULL && priv->gicon == NULL))
     return;
 
+  /* remember that the cells of this widget are still being painted */
+  if (priv->async)
+    _blxo_icon_cache_widget_painted (widget);
+
   /* icon may be either an image file or a named icon */
   if (priv->icon != NULL && g_path_is_absolute (priv->icon))
     {
       /* load the icon via the thumbnail database */
-      icon = _blxo_thumbnail_get_for_file (priv->icon, (priv->size > 128) ? BLXO_THUMBNAIL_SIZE_LARGE : BLXO_THUMBNAIL_SIZE_NORMAL, &err);
+      thumbnail_path = priv->icon;
     }
   else if (priv->icon != NULL || priv->gicon != NULL)
     {
-      /* determine the best icon size (GtkIconTheme is somewhat messy scaling up small icons) */
       icon_theme = gtk_icon_theme_get_for_screen (gtk_widget_get_screen (widget));
 
       if (priv->icon != NULL)
         {
-          icon_sizes = gtk_icon_theme_get_icon_sizes (icon_theme, priv->icon);
-          for (icon_size = -1, n = 0; icon_sizes[n] != 0; ++n)
-            {
-              /* we can use any size if scalable, because we load the file directly */
-              if (icon_sizes[n] == -1)
-                icon_size = priv->size;
-              else if (icon_sizes[n] > icon_size && icon_sizes[n] <= priv->size)
-                icon_size = icon_sizes[n];
-            }
-          g_free (icon_sizes);
-
-          /* if we don't know any icon sizes at all, the icon is probably not present */
-          if (G_UNLIKELY (icon_size < 0))
-            icon_size = priv->size;
+          /* determine the best icon size (GtkIconTheme is somewhat messy scaling up small icons) */
+          icon_size = blxo_cell_renderer_icon_get_best_size (icon_theme, priv->icon, priv->size);
 
           /* lookup the icon in the icon theme */
+#if GTK_CHECK_VERSION (3, 0, 0)
+          icon_info = gtk_icon_theme_lookup_icon_for_scale (icon_theme, priv->icon, icon_size, scale_factor, 0);
+#else
           icon_info = gtk_icon_theme_lookup_icon (icon_theme, priv->icon, icon_size, 0);
+#endif
         }
       else if (priv->gicon != NULL)
         {
+#if GTK_CHECK_VERSION (3, 0, 0)
+          icon_info = gtk_icon_theme_lookup_by_gicon_for_scale (icon_theme,
+                                                                priv->gicon,
+                                                                priv->size,
+                                                                scale_factor,
+                                                                GTK_ICON_LOOKUP_USE_BUILTIN);
+#else
           icon_info = gtk_icon_theme_lookup_by_gicon (icon_theme,
                                                       priv->gicon,
                                                       priv->size,
                                                       GTK_ICON_LOOKUP_USE_BUILTIN);
+#endif
         }
 
       if (G_UNLIKELY (icon_info == NULL))
@@ -471,33 +873,83 @@ blxo_cell_renderer_icon_render (GtkCellRenderer     *renderer,
 
       /* check if we have an SVG icon here */
       filename = gtk_icon_info_get_filename (icon_info);
-      if (filename != NULL && g_str_has_suffix (filename, ".svg"))
+      if (filename != NULL && blxo_cell_renderer_icon_use_thumbnail (filename))
         {
           /* loading SVG icons is terribly slow, so we try to use thumbnail instead, and we use the
            * real available cell area directly here, because loading thumbnails involves scaling anyway
            * and this way we need to the thumbnail pixbuf scale only once.
            */
-          icon = _blxo_thumbnail_get_for_file (filename, (priv->size > 128) ? BLXO_THUMBNAIL_SIZE_LARGE : BLXO_THUMBNAIL_SIZE_NORMAL, &err);
+          thumbnail_path = filename;
+        }
+      else if (filename != NULL)
+        {
+          /* regularly load the icon from the theme, unless it is cached already */
+          cache_path = filename;
+          cache_size = ((priv->icon != NULL) ? icon_size : priv->size) * scale_factor;
+          icon = _blxo_icon_cache_lookup (cache_path, cache_size, NULL);
+          if (icon == NULL)
+            {
+              icon = gtk_icon_info_load_icon (icon_info, &err);
+              if (G_LIKELY (icon != NULL))
+                _blxo_icon_cache_insert (cache_path, cache_size, icon);
+            }
         }
       else
         {
-          /* regularly load the icon from the theme */
+          /* builtin icons are not cached */
           icon = gtk_icon_info_load_icon (icon_info, &err);
         }
-      gtk_icon_info_free (icon_info);
+    }
+
+  /* image files and scalable icons are loaded via the icon cache */
+  if (thumbnail_path != NULL)
+    {
+      thumbnail_size = _blxo_thumbnail_size_for (priv->size * scale_factor);
+      base_size = _blxo_thumbnail_size_for (priv->size);
+      icon = _blxo_icon_cache_lookup (thumbnail_path, thumbnail_size, &failed);
+      if (icon != NULL)
+        {
+          /* the icon states are derived from the cached image */
+          cache_path = thumbnail_path;
+          cache_size = thumbnail_size;
+        }
+      else if (!failed)
+        {
+          if (priv->async)
+            {
+              /* load the image in the background and draw a placeholder meanwhile */
+#if GTK_CHECK_VERSION (3, 0, 0)
+              _blxo_icon_cache_load_async (thumbnail_path, thumbnail_size, base_size, widget, NULL, cell_area);
+#else
+              _blxo_icon_cache_load_async (thumbnail_path, thumbnail_size, base_size, widget, window, cell_area);
+#endif
+              icon_theme = gtk_icon_theme_get_for_screen (gtk_widget_get_screen (widget));
+              icon = blxo_cell_renderer_icon_get_placeholder (icon_theme, MIN (priv->size * scale_factor, thumbnail_size));
+            }
+          else
+            {
+              /* load the image right now and remember it for the next paint */
+              icon = _blxo_icon_cache_load (thumbnail_path, thumbnail_size, base_size, &err);
+              cache_path = thumbnail_path;
+              cache_size = thumbnail_size;
+            }
+        }
     }
 
   /* check if we failed */
   if (G_UNLIKELY (icon == NULL))
     {
+      if (icon_info != NULL)
+        gtk_icon_info_free (icon_info);
+
       /* better let the user know whats going on, might be surprising otherwise */
-      if (G_LIKELY (priv->icon != NULL))
+      if (err != NULL && G_LIKELY (priv->icon != NULL))
         {
           display_name = g_filename_display_name (priv->icon);
         }
-      else if (G_UNLIKELY (priv->gicon != NULL
-                           && g_object_class_find_property (G_OBJECT_GET_CLASS (priv->gicon),
-                                                            "name")))
+      else if (err != NULL && G_UNLIKELY (priv->gicon != NULL
+                                          && g_object_class_find_property (G_OBJECT_GET_CLASS (priv->gicon),
+                                                                           "name")))
         {
           g_object_get (priv->gicon, "name", &display_name, NULL);
         }
@@ -508,19 +960,107 @@ blxo_cell_renderer_icon_render (GtkCellRenderer     *renderer,
           g_free (display_name);
         }
 
-      g_error_free (err);
+      if (err != NULL)
+        g_error_free (err);
       return;
     }
 
-  /* determine the real icon size */
+  /* determine the real icon size, in device pixels */
   icon_area.width = gdk_pixbuf_get_width (icon);
   icon_area.height = gdk_pixbuf_get_height (icon);
 
-  /* scale down the icon on-demand */
-  if (G_UNLIKELY (icon_area.width > cell_area->width || icon_area.height > cell_area->height))
+  /* determine the version of the icon to render for the cell state */
+  memset (&variant, 0, sizeof (variant));
+  if (G_UNLIKELY (icon_area.width > cell_area->width * scale_factor || icon_area.height > cell_area->height * scale_factor))
+    {
+      variant.width = cell_area->width * scale_factor;
+      variant.height = cell_area->height * scale_factor;
+    }
+
+  /* colorize the icon if we should follow the selection state */
+  if (priv->follow_state)
+    variant.flags |= (flags & (GTK_CELL_RENDERER_SELECTED | GTK_CELL_RENDERER_PRELIT));
+
+  if ((variant.flags & GTK_CELL_RENDERER_SELECTED) != 0)
+    {
+#if GTK_CHECK_VERSION (3, 0, 0)
+      style_context = gtk_widget_get_style_context (widget);
+      gtk_style_context_get (style_context, gtk_widget_has_focus (widget) ? GTK_STATE_FLAG_SELECTED : GTK_STATE_FLAG_ACTIVE,
+                             GTK_STYLE_PROPERTY_BACKGROUND_COLOR, &color_rgba,
+                             NULL);
+
+      selected_color.pixel = 0;
+      selected_color.red = color_rgba->red * 65535;
+      selected_color.blue = color_rgba->blue * 65535;
+      selected_color.green = color_rgba->green * 65535;
+      gdk_rgba_free (color_rgba);
+#else
+      state = gtk_widget_has_focus (widget) ? GTK_STATE_SELECTED : GTK_STATE_ACTIVE;
+      selected_color = gtk_widget_get_style (widget)->base[state];
+#endif
+      variant.selected_color = PACK_COLOR (&selected_color);
+    }
+
+  /* check if we should render an insensitive icon */
+#if GTK_CHECK_VERSION (3, 0, 0)
+  if (G_UNLIKELY (gtk_widget_get_state_flags(widget) & GTK_STATE_INSENSITIVE || !gtk_cell_renderer_get_sensitive (renderer)))
+    {
+      style_context = gtk_widget_get_style_context (widget);
+      gtk_style_context_get (style_context, GTK_STATE_FLAG_INSENSITIVE,
+                             GTK_STYLE_PROPERTY_COLOR, &color_rgba,
+                             NULL);
+
+      insensitive_color.pixel = 0;
+      insensitive_color.red = color_rgba->red * 65535;
+      insensitive_color.blue = color_rgba->blue * 65535;
+      insensitive_color.green = color_rgba->green * 65535;
+      gdk_rgba_free (color_rgba);
+
+      variant.flags |= GTK_CELL_RENDERER_INSENSITIVE;
+      variant.insensitive_color = PACK_COLOR (&insensitive_color);
+    }
+#else
+  if (G_UNLIKELY (gtk_widget_get_state (widget) == GTK_STATE_INSENSITIVE || !gtk_cell_renderer_get_sensitive (renderer)))
+    {
+      /* gtk_style_render_icon() derives the insensitive icon from the style's
+       * colours, in a way that depends on the theme engine of the style */
+      style = gtk_widget_get_style (widget);
+      variant.flags |= GTK_CELL_RENDERER_INSENSITIVE;
+      variant.insensitive_color = PACK_COLOR (&style->fg[GTK_STATE_INSENSITIVE]);
+      variant.insensitive_bg = PACK_COLOR (&style->bg[GTK_STATE_INSENSITIVE]);
+      variant.style_type = G_OBJECT_TYPE (style);
+    }
+#endif
+
+  /* check if we already rendered the icon in this state */
+  has_variant = (variant.flags != 0 || variant.width != 0);
+  is_variant = has_variant;
+  if (is_variant && cache_path != NULL)
+    {
+      temp = _blxo_icon_cache_lookup_variant (cache_path, cache_size, &variant);
+      if (G_LIKELY (temp != NULL))
+        {
+          g_object_unref (G_OBJECT (icon));
+          icon = temp;
+          is_variant = FALSE;
+
+          /* determine the icon dimensions again */
+          icon_area.width = gdk_pixbuf_get_width (icon);
+          icon_area.height = gdk_pixbuf_get_height (icon);
+        }
+    }
+
+  /* scale down, colorize and lighten the icon in a single pass */
+  if (is_variant && (variant.width != 0 || (variant.flags & (GTK_CELL_RENDERER_SELECTED | GTK_CELL_RENDERER_PRELIT)) != 0))
     {
-      /* scale down to fit */
-      temp = blxo_gdk_pixbuf_scale_down (icon, TRUE, cell_area->width, cell_area->height);
+      memset (&effects, 0, sizeof (effects));
+      effects.max_width = variant.width;
+      effects.max_height = variant.height;
+      effects.tint = (variant.flags & GTK_CELL_RENDERER_SELECTED) != 0 ? &selected_color : NULL;
+      effects.lighten = (variant.flags & GTK_CELL_RENDERER_PRELIT) != 0;
+
+      temp = blxo_gdk_pixbuf_apply_effects (icon, &effects);
+      icon_owned = (temp != icon);
       g_object_unref (G_OBJECT (icon));
       icon = temp;
 
@@ -529,6 +1069,9 @@ blxo_cell_renderer_icon_render (GtkCellRenderer     *renderer,
       icon_area.height = gdk_pixbuf_get_height (icon);
     }
 
+  /* the icon is painted in user space */
+  icon_area.width /= scale_factor;
+  icon_area.height /= scale_factor;
   icon_area.x = cell_area->x + (cell_area->width - icon_area.width) / 2;
   icon_area.y = cell_area->y + (cell_area->height - icon_area.height) / 2;
 
@@ -536,63 +1079,16 @@ blxo_cell_renderer_icon_render (GtkCellRenderer     *renderer,
   /* Gtk3: we don't have any expose rectangle and just draw everything */
   if (gdk_rectangle_intersect (expose_area, &icon_area, &draw_area))
     {
-      /* colorize the icon if we should follow the selection state */
-      if ((flags & (GTK_CELL_RENDERER_SELECTED | GTK_CELL_RENDERER_PRELIT)) != 0 && priv->follow_state)
-        {
-          if ((flags & GTK_CELL_RENDERER_SELECTED) != 0)
-            {
-#if GTK_CHECK_VERSION (3, 0, 0)
-              style_context = gtk_widget_get_style_context (widget);
-              gtk_style_context_get (style_context, gtk_widget_has_focus (widget) ? GTK_STATE_FLAG_SELECTED : GTK_STATE_FLAG_ACTIVE,
-                                     GTK_STYLE_PROPERTY_BACKGROUND_COLOR, &color_rgba,
-                                     NULL);
-
-              color_gdk.pixel = 0;
-              color_gdk.red = color_rgba->red * 65535;
-              color_gdk.blue = color_rgba->blue * 65535;
-              color_gdk.green = color_rgba->green * 65535;
-              gdk_rgba_free (color_rgba);
-              temp = blxo_gdk_pixbuf_colorize (icon, &color_gdk);
-#else
-              state = gtk_widget_has_focus (widget) ? GTK_STATE_SELECTED : GTK_STATE_ACTIVE;
+      /* check if we can paint the cached surface right away */
+      if (!is_variant && cache_path != NULL)
+        surface = _blxo_icon_cache_lookup_surface (cache_path, cache_size, has_variant ? &variant : NULL, scale_factor);
 
-              temp = blxo_gdk_pixbuf_colorize (icon, &gtk_widget_get_style (widget)->base[state]);
-#endif
-              g_object_unref (G_OBJECT (icon));
-              icon = temp;
-            }
-
-          if ((flags & GTK_CELL_RENDERER_PRELIT) != 0)
-            {
-              temp = blxo_gdk_pixbuf_spotlight (icon);
-              g_object_unref (G_OBJECT (icon));
-              icon = temp;
-            }
-        }
-
-#if GTK_CHECK_VERSION (3, 0, 0)
-      /* check if we should render an insensitive icon */
-      if (G_UNLIKELY (gtk_widget_get_state_flags(widget) & GTK_STATE_INSENSITIVE || !gtk_cell_renderer_get_sensitive (renderer)))
+      if ((variant.flags & GTK_CELL_RENDERER_INSENSITIVE) != 0 && is_variant)
         {
-          style_context = gtk_widget_get_style_context (widget);
-          gtk_style_context_get (style_context, GTK_STATE_FLAG_INSENSITIVE,
-                                 GTK_STYLE_PROPERTY_COLOR, &color_rgba,
-                                 NULL);
-
-          color_gdk.pixel = 0;
-          color_gdk.red = color_rgba->red * 65535;
-          color_gdk.blue = color_rgba->blue * 65535;
-          color_gdk.green = color_rgba->green * 65535;
-          gdk_rgba_free (color_rgba);
-          temp = blxo_gdk_pixbuf_colorize (icon, &color_gdk);
-
-          g_object_unref (G_OBJECT (icon));
-          icon = temp;
-        }
+#if GTK_CHECK_VERSION (3, 0, 0)
+          temp = blxo_cell_renderer_icon_get_effect_dest (icon, icon_owned);
+          blxo_gdk_pixbuf_colorize_into (icon, &insensitive_color, temp);
 #else
-      /* check if we should render an insensitive icon */
-      if (G_UNLIKELY (gtk_widget_get_state (widget) == GTK_STATE_INSENSITIVE || !gtk_cell_renderer_get_sensitive (renderer)))
-        {
           /* allocate an icon source */
           icon_source = gtk_icon_source_new ();
           gtk_icon_source_set_pixbuf (icon_source, icon);
@@ -602,23 +1098,40 @@ blxo_cell_renderer_icon_render (GtkCellRenderer     *renderer,
           /* render the insensitive icon */
           temp = gtk_style_render_icon (gtk_widget_get_style (widget), icon_source, gtk_widget_get_direction (widget),
                                         GTK_STATE_INSENSITIVE, -1, widget, "gtkcellrendererpixbuf");
-          g_object_unref (G_OBJECT (icon));
-          icon = temp;
 
           /* release the icon source */
           gtk_icon_source_free (icon_source);
-        }
 #endif
+          g_object_unref (G_OBJECT (icon));
+          icon = temp;
+        }
+
+      /* remember the icon in this state for the next paint */
+      if (is_variant && cache_path != NULL)
+        _blxo_icon_cache_insert_variant (cache_path, cache_size, &variant, icon);
+
+      /* convert the icon to a surface for the target only once */
+      if (surface == NULL)
+        {
+          surface = blxo_cell_renderer_icon_create_surface (icon, widget, scale_factor);
+          if (cache_path != NULL)
+            _blxo_icon_cache_insert_surface (cache_path, cache_size, has_variant ? &variant : NULL, scale_factor, surface);
+        }
 
       /* render the invalid parts of the icon */
-      gdk_cairo_set_source_pixbuf (cr, icon, icon_area.x, icon_area.y);
+      cairo_set_source_surface (cr, surface, icon_area.x, icon_area.y);
       cairo_rectangle (cr, draw_area.x, draw_area.y, draw_area.width, draw_area.height);
       cairo_fill (cr);
+      cairo_surface_destroy (surface);
     }
 
   /* release the file's icon */
   g_object_unref (G_OBJECT (icon));
 
+  /* the icon info owns the cache_path of theme icons */
+  if (icon_info != NULL)
+    gtk_icon_info_free (icon_info);
+
 #if !GTK_CHECK_VERSION (3, 0, 0)
   cairo_destroy (cr);
 #endif
@@ -0,0 +1,456 @@
+/*-
+ * Copyright (c) 2026 Xfce Development Team <xfce4-dev@xfce.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include <blxo/blxo-exif.h>
+#include <blxo/blxo-private.h>
+#include <blxo/blxo-alias.h>
+
+/* Camera JPEGs carry a small EXIF thumbnail, and most RAW formats (CR2,
+ * NEF, ARW, DNG, ORF, PEF, ...) are TIFF files with one or more embedded
+ * JPEG previews. The parser below walks the TIFF image file directories
+ * of such files, without copying or decoding anything, to find a preview
+ * that is large enough to be decoded instead of the full image.
+ */
+
+/* the maximum number of image file directories visited per file */
+#define BLXO_EXIF_MAX_IFDS (32)
+
+/* the maximum number of candidate previews per file */
+#define BLXO_EXIF_MAX_PREVIEWS (8)
+
+/* TIFF tags */
+#define TAG_IMAGE_WIDTH          (0x0100)
+#define TAG_IMAGE_LENGTH         (0x0101)
+#define TAG_COMPRESSION          (0x0103)
+#define TAG_STRIP_OFFSETS        (0x0111)
+#define TAG_ORIENTATION          (0x0112)
+#define TAG_STRIP_BYTE_COUNTS    (0x0117)
+#define TAG_SUB_IFDS             (0x014a)
+#define TAG_JPEG_OFFSET          (0x0201)
+#define TAG_JPEG_LENGTH          (0x0202)
+#define TAG_EXIF_IFD             (0x8769)
+#define TAG_PIXEL_X_DIMENSION    (0xa002)
+#define TAG_PIXEL_Y_DIMENSION    (0xa003)
+
+/* TIFF field types */
+#define TYPE_SHORT (3)
+#define TYPE_LONG  (4)
+#define TYPE_IFD   (13)
+
+
+
+typedef struct
+{
+  /* the TIFF data and its offset in the file */
+  const guchar *data;
+  gsize         length;
+  gsize         base;
+  gboolean      big_endian;
+
+  /* the image file directories still to visit */
+  guint32       ifds[BLXO_EXIF_MAX_IFDS];
+  guint         n_ifds;
+
+  /* the candidate previews, relative to the TIFF data */
+  guint32       offsets[BLXO_EXIF_MAX_PREVIEWS];
+  guint32       lengths[BLXO_EXIF_MAX_PREVIEWS];
+  guint         n_previews;
+
+  /* the dimensions of the main image, if known */
+  gint          width;
+  gint          height;
+
+  /* the orientation of the main image, 0 if unknown */
+  guint         orientation;
+} BlxoExifTiff;
+
+
+
+static guint16
+blxo_exif_read16 (const BlxoExifTiff *tiff,
+                  gsize               offset)
+{
+  const guchar *p = tiff->data + offset;
+
+  return tiff->big_endian ? (p[0] << 8) | p[1] : (p[1] << 8) | p[0];
+}
+
+
+
+static guint32
+blxo_exif_read32 (const BlxoExifTiff *tiff,
+                  gsize               offset)
+{
+  const guchar *p = tiff->data + offset;
+
+  if (tiff->big_endian)
+    return ((guint32) p[0] << 24) | ((guint32) p[1] << 16) | ((guint32) p[2] << 8) | p[3];
+  return ((guint32) p[3] << 24) | ((guint32) p[2] << 16) | ((guint32) p[1] << 8) | p[0];
+}
+
+
+
+static void
+blxo_exif_add_ifd (BlxoExifTiff *tiff,
+                   guint32       offset)
+{
+  guint n;
+
+  if (offset < 8 || offset >= tiff->length || tiff->n_ifds >= BLXO_EXIF_MAX_IFDS)
+    return;
+
+  /* ignore directories we know already, broken files may contain loops */
+  for (n = 0; n < tiff->n_ifds; ++n)
+    if (tiff->ifds[n] == offset)
+      return;
+
+  tiff->ifds[tiff->n_ifds++] = offset;
+}
+
+
+
+static void
+blxo_exif_add_preview (BlxoExifTiff *tiff,
+                       guint32       offset,
+                       guint32       length)
+{
+  if (offset == 0 || length < 4 || offset >= tiff->length || length > tiff->length - offset)
+    return;
+
+  if (tiff->n_previews < BLXO_EXIF_MAX_PREVIEWS)
+    {
+      tiff->offsets[tiff->n_previews] = offset;
+      tiff->lengths[tiff->n_previews] = length;
+      tiff->n_previews++;
+    }
+}
+
+
+
+static void
+blxo_exif_parse_ifd (BlxoExifTiff *tiff,
+                     guint32       offset)
+{
+  guint32 jpeg_offset = 0;
+  guint32 jpeg_length = 0;
+  guint32 strip_offset = 0;
+  guint32 strip_length = 0;
+  guint32 compression = 0;
+  guint32 width = 0;
+  guint32 height = 0;
+  guint32 value;
+  guint32 count;
+  guint16 type;
+  guint16 tag;
+  gsize   entry;
+  guint   n_entries;
+  guint   n;
+
+  if ((gsize) offset + 2 > tiff->length)
+    return;
+
+  n_entries = blxo_exif_read16 (tiff, offset);
+  for (n = 0, entry = offset + 2; n < n_entries && entry + 12 <= tiff->length; ++n, entry += 12)
+    {
+      tag = blxo_exif_read16 (tiff, entry);
+      type = blxo_exif_read16 (tiff, entry + 2);
+      count = blxo_exif_read32 (tiff, entry + 4);
+
+      /* we only need integer values */
+      if (type == TYPE_SHORT)
+        value = blxo_exif_read16 (tiff, entry + 8);
+      else if (type == TYPE_LONG || type == TYPE_IFD)
+        value = blxo_exif_read32 (tiff, entry + 8);
+      else
+        continue;
+
+      switch (tag)
+        {
+        case TAG_IMAGE_WIDTH:
+        case TAG_PIXEL_X_DIMENSION:
+          width = value;
+          break;
+
+        case TAG_IMAGE_LENGTH:
+        case TAG_PIXEL_Y_DIMENSION:
+          height = value;
+          break;
+
+        case TAG_COMPRESSION:
+          compression = value;
+          break;
+
+        case TAG_STRIP_OFFSETS:
+          if (count == 1)
+            strip_offset = value;
+          break;
+
+        case TAG_STRIP_BYTE_COUNTS:
+          if (count == 1)
+            strip_length = value;
+          break;
+
+        case TAG_ORIENTATION:
+          /* only IFD0 describes the main image */
+          if (offset == tiff->ifds[0] && value >= 1 && value <= 8)
+            tiff->orientation = value;
+          break;
+
+        case TAG_JPEG_OFFSET:
+          jpeg_offset = value;
+          break;
+
+        case TAG_JPEG_LENGTH:
+          jpeg_length = value;
+          break;
+
+        case TAG_EXIF_IFD:
+          blxo_exif_add_ifd (tiff, value);
+          break;
+
+        case TAG_SUB_IFDS:
+          if (count == 1)
+            blxo_exif_add_ifd (tiff, value);
+          else if (type != TYPE_SHORT && value < tiff->length && count <= (tiff->length - value) / 4)
+            for (; count > 0; --count, value += 4)
+              blxo_exif_add_ifd (tiff, blxo_exif_read32 (tiff, value));
+          break;
+        }
+    }
+
+  /* the largest image in the file is the main image */
+  if ((gint64) width * height > (gint64) tiff->width * tiff->height && width <= G_MAXINT && height <= G_MAXINT)
+    {
+      tiff->width = width;
+      tiff->height = height;
+    }
+
+  /* JPEG thumbnails and previews stored as a single JPEG strip */
+  blxo_exif_add_preview (tiff, jpeg_offset, jpeg_length);
+  if (compression == 6 || compression == 7)
+    blxo_exif_add_preview (tiff, strip_offset, strip_length);
+
+  /* continue with the next directory */
+  entry = offset + 2 + (gsize) n_entries * 12;
+  if (entry + 4 <= tiff->length)
+    blxo_exif_add_ifd (tiff, blxo_exif_read32 (tiff, entry));
+}
+
+
+
+static gboolean
+blxo_exif_parse_tiff (BlxoExifTiff *tiff,
+                      const guchar *data,
+                      gsize         length,
+                      gsize         base)
+{
+  guint n;
+
+  if (length < 8)
+    return FALSE;
+
+  if (memcmp (data, "MM\0*", 4) == 0)
+    tiff->big_endian = TRUE;
+  else if (memcmp (data, "II*\0", 4) == 0)
+    tiff->big_endian = FALSE;
+  else
+    return FALSE;
+
+  tiff->data = data;
+  tiff->length = length;
+  tiff->base = base;
+
+  /* visit all directories reachable from the first one */
+  blxo_exif_add_ifd (tiff, blxo_exif_read32 (tiff, 4));
+  for (n = 0; n < tiff->n_ifds; ++n)
+    blxo_exif_parse_ifd (tiff, tiff->ifds[n]);
+
+  return TRUE;
+}
+
+
+
+/* determines the size of a JPEG image, and the location of its EXIF data */
+static gboolean
+blxo_exif_parse_jpeg (const guchar  *data,
+                      gsize          length,
+                      gint          *width,
+                      gint          *height,
+                      const guchar **exif,
+                      gsize         *exif_length)
+{
+  guint  marker;
+  gsize  segment_length;
+  gsize  offset;
+
+  if (length < 4 || data[0] != 0xff || data[1] != 0xd8)
+    return FALSE;
+
+  for (offset = 2; offset + 4 <= length; )
+    {
+      if (data[offset] != 0xff)
+        return FALSE;
+
+      /* skip fill bytes and markers without a segment */
+      marker = data[offset + 1];
+      if (marker == 0xff)
+        {
+          offset += 1;
+          continue;
+        }
+      else if (marker == 0x01 || (marker >= 0xd0 && marker <= 0xd8))
+        {
+          offset += 2;
+          continue;
+        }
+      else if (marker == 0xd9 || marker == 0xda)
+        {
+          /* no frame header before the image data */
+          return FALSE;
+        }
+
+      segment_length = (data[offset + 2] << 8) | data[offset + 3];
+      if (segment_length < 2 || offset + 2 + segment_length > length)
+        return FALSE;
+
+      if (marker == 0xe1 && exif != NULL && *exif == NULL
+          && segment_length > 8 && memcmp (data + offset + 4, "Exif\0\0", 6) == 0)
+        {
+          *exif = data + offset + 10;
+          *exif_length = segment_length - 8;
+        }
+      else if (marker == 0xc0 || marker == 0xc1 || marker == 0xc2)
+        {
+          /* baseline, extended and progressive images can be decoded */
+          if (segment_length < 7)
+            return FALSE;
+          *height = (data[offset + 5] << 8) | data[offset + 6];
+          *width = (data[offset + 7] << 8) | data[offset + 8];
+          return (*width > 0 && *height > 0);
+        }
+      else if (marker >= 0xc3 && marker <= 0xcf && marker != 0xc4 && marker != 0xc8 && marker != 0xcc)
+        {
+          /* lossless, hierarchical and arithmetic coded images cannot be decoded */
+          return FALSE;
+        }
+
+      offset += 2 + segment_length;
+    }
+
+  return FALSE;
+}
+
+
+
+/**
+ * _blxo_exif_find_preview:
+ * @data                  : the contents of a JPEG or TIFF based file.
+ * @length                : the length of @data in bytes.
+ * @min_width             : the width the preview must have.
+ * @min_height            : the height the preview must have.
+ * @preserve_aspect_ratio : %TRUE if the image will be scaled to fit into
+ *                          @min_width and @min_height, in which case one of
+ *                          the dimensions must be large enough.
+ * @preview               : return location for the preview.
+ *
+ * Looks for the smallest embedded JPEG preview in @data, that is at least
+ * as large as the given dimensions, has the aspect ratio of the main image,
+ * and is smaller than the main image. The previews are stored unrotated,
+ * so the orientation of the main image is returned with them.
+ *
+ * Returns: %TRUE if such a preview was found.
+ **/
+gboolean
+_blxo_exif_find_preview (const guchar    *data,
+                         gsize            length,
+                         gint             min_width,
+                         gint             min_height,
+                         gboolean         preserve_aspect_ratio,
+                         BlxoExifPreview *preview)
+{
+  const guchar *exif = NULL;
+  BlxoExifTiff  tiff;
+  gboolean      found = FALSE;
+  gint64        a, b;
+  gsize         exif_length = 0;
+  gint          width;
+  gint          height;
+  guint         n;
+
+  memset (&tiff, 0, sizeof (tiff));
+
+  /* JPEG files keep their EXIF data in an APP1 segment */
+  if (blxo_exif_parse_jpeg (data, length, &tiff.width, &tiff.height, &exif, &exif_length))
+    {
+      if (exif == NULL || !blxo_exif_parse_tiff (&tiff, exif, exif_length, exif - data))
+        return FALSE;
+    }
+  else if (!blxo_exif_parse_tiff (&tiff, data, length, 0))
+    {
+      return FALSE;
+    }
+
+  for (n = 0; n < tiff.n_previews; ++n)
+    {
+      if (!blxo_exif_parse_jpeg (tiff.data + tiff.offsets[n], tiff.lengths[n], &width, &height, NULL, NULL))
+        continue;
+
+      /* check if the preview is large enough */
+      if (preserve_aspect_ratio ? (width < min_width && height < min_height) : (width < min_width || height < min_height))
+        continue;
+
+      /* and smaller than anything found before */
+      if (found && (gint64) width * height >= (gint64) preview->width * preview->height)
+        continue;
+
+      /* and smaller than the image, with the same aspect ratio within 2% */
+      if (tiff.width > 0 && tiff.height > 0)
+        {
+          if ((gint64) width * height >= (gint64) tiff.width * tiff.height)
+            continue;
+
+          a = (gint64) width * tiff.height;
+          b = (gint64) height * tiff.width;
+          if (ABS (a - b) * 50 > MAX (a, b))
+            continue;
+        }
+
+      preview->offset = tiff.base + tiff.offsets[n];
+      preview->length = tiff.lengths[n];
+      preview->width = width;
+      preview->height = height;
+      preview->orientation = MAX (tiff.orientation, 1);
+      found = TRUE;
+    }
+
+  return found;
+}
+
+
+
+#define __BLXO_EXIF_C__
+#include <blxo/blxo-aliasdef.c>
@@ -0,0 +1,61 @@
+/*-
+ * Copyright (c) 2026 Xfce Development Team <xfce4-dev@xfce.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#if !defined (BLXO_COMPILATION)
+#error "Only <blxo/blxo.h> can be included directly, this file is not part of the public API."
+#endif
+
+#ifndef __BLXO_EXIF_H__
+#define __BLXO_EXIF_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _BlxoExifPreview BlxoExifPreview;
+
+/**
+ * BlxoExifPreview:
+ * @offset      : the offset of the preview JPEG in the file.
+ * @length      : the length of the preview JPEG in bytes.
+ * @width       : the width of the preview.
+ * @height      : the height of the preview.
+ * @orientation : the EXIF orientation of the main image, 1 to 8.
+ *
+ * An embedded preview image, found by _blxo_exif_find_preview().
+ **/
+struct _BlxoExifPreview
+{
+  gsize offset;
+  gsize length;
+  gint  width;
+  gint  height;
+  guint orientation;
+};
+
+G_GNUC_INTERNAL gboolean _blxo_exif_find_preview (const guchar    *data,
+                                                  gsize            length,
+                                                  gint             min_width,
+                                                  gint             min_height,
+                                                  gboolean         preserve_aspect_ratio,
+                                                  BlxoExifPreview *preview);
+
+G_END_DECLS
+
+#endif /* !__BLXO_EXIF_H__ */
@@ -42,12 +42,12 @@
 #ifdef HAVE_MATH_H
 #include <math.h>
 #endif
-#ifdef HAVE_MMINTRIN_H
-#include <mmintrin.h>
-#endif
 #ifdef HAVE_STDLIB_H
 #include <stdlib.h>
 #endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>
 #endif
@@ -57,7 +57,11 @@
 #define GDK_PIXBUF_ENABLE_BACKEND
 #endif
 
+#include <blxo/blxo-exif.h>
 #include <blxo/blxo-gdk-pixbuf-extensions.h>
+#include <blxo/blxo-pixbuf-feeder.h>
+#include <blxo/blxo-pixbuf-kernels.h>
+#include <blxo/blxo-pixbuf-scaler.h>
 #include <blxo/blxo-private.h>
 #include <blxo/blxo-alias.h>
 
@@ -73,6 +77,58 @@
 #define _O_BINARY 0
 #endif
 
+/* the number of rows scaled at once by blxo_gdk_pixbuf_apply_effects() */
+#define BLXO_GDK_PIXBUF_EFFECTS_STRIP (16)
+
+/* the maximum number of pixel buffers kept for reuse, and their total size */
+#define BLXO_GDK_PIXBUF_POOL_MAX_BUFFERS (16)
+#define BLXO_GDK_PIXBUF_POOL_MAX_BYTES   (4 * 1024 * 1024)
+
+/* the number of framed backgrounds cached per frame */
+#define BLXO_PIXBUF_FRAME_MAX_BACKGROUNDS (4)
+
+
+
+typedef struct
+{
+  gint    rowstride;
+  gint    height;
+  guchar *pixels;
+} BlxoGdkPixbufBuffer;
+
+typedef struct
+{
+  gint             width;
+  gint             height;
+  GdkPixbuf       *pixbuf;
+  cairo_surface_t *surface;
+} BlxoPixbufFrameBackground;
+
+struct _BlxoPixbufFrame
+{
+  gint       ref_count;
+  GMutex     mutex;
+
+  /* the slices of the frame image, row by row, sharing its pixels;
+   * the middle slice is never used, and empty slices are %NULL */
+  GdkPixbuf *slices[9];
+
+  gint       left_offset;
+  gint       top_offset;
+  gint       right_offset;
+  gint       bottom_offset;
+
+  /* the framed backgrounds, most recently used first */
+  GSList    *backgrounds;
+};
+
+
+
+/* pixel buffers of released recycled pixbufs, most recently released first */
+G_LOCK_DEFINE_STATIC (pixbuf_pool);
+static GQueue pixbuf_pool = G_QUEUE_INIT;
+static gsize  pixbuf_pool_n_bytes = 0;
+
 /**
  * SECTION: blxo-gdk-pixbuf-extensions
  * @title: Extensions to gdk-pixbuf
@@ -105,150 +161,101 @@ blxo_gdk_pixbuf_colorize (const GdkPixbuf *source,
                          const GdkColor  *color)
 {
   GdkPixbuf *dst;
-  gboolean   has_alpha;
-  gint       dst_row_stride;
-  gint       src_row_stride;
-  gint       width;
-  gint       height;
-  gint       i;
-
-  /* determine source parameters */
-  width = gdk_pixbuf_get_width (source);
-  height = gdk_pixbuf_get_height (source);
-  has_alpha = gdk_pixbuf_get_has_alpha (source);
 
   /* allocate the destination pixbuf */
-  dst = gdk_pixbuf_new (gdk_pixbuf_get_colorspace (source), has_alpha, gdk_pixbuf_get_bits_per_sample (source), width, height);
-
-  /* determine row strides on src/dst */
-  dst_row_stride = gdk_pixbuf_get_rowstride (dst);
-  src_row_stride = gdk_pixbuf_get_rowstride (source);
-
-#if defined(__GNUC__) && defined(__MMX__)
-  /* check if there's a good reason to use MMX */
-  if (G_LIKELY (has_alpha && dst_row_stride == width * 4 && src_row_stride == width * 4 && (width * height) % 2 == 0))
-    {
-      __m64 *pixdst = (__m64 *) gdk_pixbuf_get_pixels (dst);
-      __m64 *pixsrc = (__m64 *) gdk_pixbuf_get_pixels (source);
-      __m64  alpha_mask = _mm_set_pi8 (0xff, 0, 0, 0, 0xff, 0, 0, 0);
-      __m64  color_factor = _mm_set_pi16 (0, color->blue, color->green, color->red);
-      __m64  zero = _mm_setzero_si64 ();
-      __m64  src, alpha, hi, lo;
-
-      /* divide color components by 256 */
-      color_factor = _mm_srli_pi16 (color_factor, 8);
-
-      for (i = (width * height) >> 1; i > 0; --i)
-        {
-          /* read the source pixel */
-          src = *pixsrc;
+  dst = gdk_pixbuf_new (gdk_pixbuf_get_colorspace (source), gdk_pixbuf_get_has_alpha (source),
+                        gdk_pixbuf_get_bits_per_sample (source), gdk_pixbuf_get_width (source),
+                        gdk_pixbuf_get_height (source));
 
-          /* remember the two alpha values */
-          alpha = _mm_and_si64 (alpha_mask, src);
+  blxo_gdk_pixbuf_colorize_into (source, color, dst);
 
-          /* extract the hi pixel */
-          hi = _mm_unpackhi_pi8 (src, zero);
-          hi = _mm_mullo_pi16 (hi, color_factor);
-
-          /* extract the lo pixel */
-          lo = _mm_unpacklo_pi8 (src, zero);
-          lo = _mm_mullo_pi16 (lo, color_factor);
+  return dst;
+}
 
-          /* prefetch the next two pixels */
-          __builtin_prefetch (++pixsrc, 0, 1);
 
-          /* divide by 256 */
-          hi = _mm_srli_pi16 (hi, 8);
-          lo = _mm_srli_pi16 (lo, 8);
 
-          /* combine the 2 pixels again */
-          src = _mm_packs_pu16 (lo, hi);
+/**
+ * blxo_gdk_pixbuf_colorize_into:
+ * @source : the source #GdkPixbuf.
+ * @color  : the new color.
+ * @dest   : the destination #GdkPixbuf.
+ *
+ * Writes the version of @source, which is colorized to @color, to
+ * @dest. The @dest must have the same dimensions and channels as
+ * @source, and may also be @source itself.
+ *
+ * Since: 0.13.0
+ **/
+void
+blxo_gdk_pixbuf_colorize_into (const GdkPixbuf *source,
+                              const GdkColor  *color,
+                              GdkPixbuf       *dest)
+{
+  const BlxoPixbufKernels *kernels;
+  guint16                 factors[BLXO_PIXBUF_KERNEL_TABLE_SIZE];
+  guchar                 *dst_pixels;
+  guchar                 *src_pixels;
+  gint                    dst_row_stride;
+  gint                    src_row_stride;
+  gint                    n_channels;
+  gint                    width;
+  gint                    height;
+  gint                    i;
+
+  g_return_if_fail (GDK_IS_PIXBUF (source));
+  g_return_if_fail (GDK_IS_PIXBUF (dest));
+  g_return_if_fail (color != NULL);
+  g_return_if_fail (gdk_pixbuf_get_width (dest) == gdk_pixbuf_get_width (source));
+  g_return_if_fail (gdk_pixbuf_get_height (dest) == gdk_pixbuf_get_height (source));
+  g_return_if_fail (gdk_pixbuf_get_n_channels (dest) == gdk_pixbuf_get_n_channels (source));
 
-          /* write back the calculated color together with the alpha */
-          *pixdst = _mm_or_si64 (alpha, src);
+  /* determine source parameters */
+  width = gdk_pixbuf_get_width (source);
+  height = gdk_pixbuf_get_height (source);
+  n_channels = gdk_pixbuf_get_n_channels (source);
 
-          /* advance the dest pointer */
-          ++pixdst;
-        }
+  /* determine row strides on src/dst */
+  dst_row_stride = gdk_pixbuf_get_rowstride (dest);
+  src_row_stride = gdk_pixbuf_get_rowstride (source);
 
-      _mm_empty ();
-    }
-  else
-#endif
+  /* the factors for the channels, the alpha channel is kept */
+  for (i = 0; i < BLXO_PIXBUF_KERNEL_TABLE_SIZE; ++i)
     {
-      guchar *dst_pixels = gdk_pixbuf_get_pixels (dst);
-      guchar *src_pixels = gdk_pixbuf_get_pixels (source);
-      guchar *pixdst;
-      guchar *pixsrc;
-      gint    red_value = color->red / 255.0;
-      gint    green_value = color->green / 255.0;
-      gint    blue_value = color->blue / 255.0;
-      gint    j;
-
-      for (i = height; --i >= 0; )
+      switch (i % n_channels)
         {
-          pixdst = dst_pixels + i * dst_row_stride;
-          pixsrc = src_pixels + i * src_row_stride;
-
-          for (j = width; j > 0; --j)
-            {
-              *pixdst++ = (*pixsrc++ * red_value) >> 8;
-              *pixdst++ = (*pixsrc++ * green_value) >> 8;
-              *pixdst++ = (*pixsrc++ * blue_value) >> 8;
-
-              if (has_alpha)
-                *pixdst++ = *pixsrc++;
-            }
+        case 0:  factors[i] = color->red / 255.0;   break;
+        case 1:  factors[i] = color->green / 255.0; break;
+        case 2:  factors[i] = color->blue / 255.0;  break;
+        default: factors[i] = 256;                  break;
         }
     }
 
-  return dst;
-}
-
-
-
-static inline void
-draw_frame_row (const GdkPixbuf *frame_image,
-                gint             target_width,
-                gint             source_width,
-                gint             source_v_position,
-                gint             dest_v_position,
-                GdkPixbuf       *result_pixbuf,
-                gint             left_offset,
-                gint             height)
-{
-  gint remaining_width;
-  gint slab_width;
-  gint h_offset;
-
-  for (h_offset = 0, remaining_width = target_width; remaining_width > 0; h_offset += slab_width, remaining_width -= slab_width)
-    {
-      slab_width = (remaining_width > source_width) ? source_width : remaining_width;
-      gdk_pixbuf_copy_area (frame_image, left_offset, source_v_position, slab_width, height, result_pixbuf, left_offset + h_offset, dest_v_position);
-    }
+  /* colorize the rows using the best kernel for this CPU */
+  kernels = _blxo_pixbuf_kernels_get ();
+  dst_pixels = gdk_pixbuf_get_pixels (dest);
+  src_pixels = gdk_pixbuf_get_pixels (source);
+  for (i = 0; i < height; ++i)
+    kernels->colorize (dst_pixels + i * dst_row_stride, src_pixels + i * src_row_stride, width * n_channels, factors);
 }
 
 
 
-static inline void
-draw_frame_column (const GdkPixbuf *frame_image,
-                   gint             target_height,
-                   gint             source_height,
-                   gint             source_h_position,
-                   gint             dest_h_position,
-                   GdkPixbuf       *result_pixbuf,
-                   gint             top_offset,
-                   gint             width)
+/**
+ * blxo_gdk_pixbuf_colorize_inplace:
+ * @pixbuf : a #GdkPixbuf.
+ * @color  : the new color.
+ *
+ * Colorizes @pixbuf to @color, without allocating a new #GdkPixbuf.
+ * The @pixbuf must be owned by the caller only, i.e. it must not be
+ * shared with a cache, like the #GtkIconTheme.
+ *
+ * Since: 0.13.0
+ **/
+void
+blxo_gdk_pixbuf_colorize_inplace (GdkPixbuf      *pixbuf,
+                                 const GdkColor *color)
 {
-  gint remaining_height;
-  gint slab_height;
-  gint v_offset;
-
-  for (v_offset = 0, remaining_height = target_height; remaining_height > 0; v_offset += slab_height, remaining_height -= slab_height)
-    {
-      slab_height = (remaining_height > source_height) ? source_height : remaining_height;
-      gdk_pixbuf_copy_area (frame_image, source_h_position, top_offset, width, slab_height, result_pixbuf, dest_h_position, top_offset + v_offset);
-    }
+  blxo_gdk_pixbuf_colorize_into (pixbuf, color, pixbuf);
 }
 
 
@@ -278,312 +285,950 @@ blxo_gdk_pixbuf_frame (const GdkPixbuf *source,
                       gint             right_offset,
                       gint             bottom_offset)
 {
-  GdkPixbuf *dst;
-  gint       dst_width;
-  gint       dst_height;
-  gint       frame_width;
-  gint       frame_height;
-  gint       src_width;
-  gint       src_height;
+  BlxoPixbufFrame *pixbuf_frame;
+  GdkPixbuf       *dst;
 
   g_return_val_if_fail (GDK_IS_PIXBUF (frame), NULL);
   g_return_val_if_fail (GDK_IS_PIXBUF (source), NULL);
 
-  src_width = gdk_pixbuf_get_width (source);
-  src_height = gdk_pixbuf_get_height (source);
+  pixbuf_frame = blxo_pixbuf_frame_new (frame, left_offset, top_offset, right_offset, bottom_offset);
+  if (G_UNLIKELY (pixbuf_frame == NULL))
+    return NULL;
+
+  dst = blxo_pixbuf_frame_apply (pixbuf_frame, source);
+  blxo_pixbuf_frame_unref (pixbuf_frame);
 
-  frame_width = gdk_pixbuf_get_width (frame);
-  frame_height = gdk_pixbuf_get_height (frame);
+  return dst;
+}
 
-  dst_width = src_width + left_offset + right_offset;
-  dst_height = src_height + top_offset + bottom_offset;
 
-  /* allocate the resulting pixbuf */
-  dst = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8, dst_width, dst_height);
 
-  /* fill the destination if the source has an alpha channel */
-  if (G_UNLIKELY (gdk_pixbuf_get_has_alpha (source)))
-    gdk_pixbuf_fill (dst, 0xffffffff);
+G_DEFINE_BOXED_TYPE (BlxoPixbufFrame, blxo_pixbuf_frame, blxo_pixbuf_frame_ref, blxo_pixbuf_frame_unref)
 
-  /* draw the left top cornder and top row */
-  gdk_pixbuf_copy_area (frame, 0, 0, left_offset, top_offset, dst, 0, 0);
-  draw_frame_row (frame, src_width, frame_width - left_offset - right_offset, 0, 0, dst, left_offset, top_offset);
 
-  /* draw the right top corner and left column */
-  gdk_pixbuf_copy_area (frame, frame_width - right_offset, 0, right_offset, top_offset, dst, dst_width - right_offset, 0);
-  draw_frame_column (frame, src_height, frame_height - top_offset - bottom_offset, 0, 0, dst, top_offset, left_offset);
 
-  /* draw the bottom right corner and bottom row */
-  gdk_pixbuf_copy_area (frame, frame_width - right_offset, frame_height - bottom_offset, right_offset,
-                        bottom_offset, dst, dst_width - right_offset, dst_height - bottom_offset);
-  draw_frame_row (frame, src_width, frame_width - left_offset - right_offset, frame_height - bottom_offset,
-                  dst_height - bottom_offset, dst, left_offset, bottom_offset);
+static void
+blxo_pixbuf_frame_background_free (gpointer data)
+{
+  BlxoPixbufFrameBackground *background = data;
+
+  g_object_unref (G_OBJECT (background->pixbuf));
+  if (background->surface != NULL)
+    cairo_surface_destroy (background->surface);
+  g_slice_free (BlxoPixbufFrameBackground, background);
+}
 
-  /* draw the bottom left corner and the right column */
-  gdk_pixbuf_copy_area (frame, 0, frame_height - bottom_offset, left_offset, bottom_offset, dst, 0, dst_height - bottom_offset);
-  draw_frame_column (frame, src_height, frame_height - top_offset - bottom_offset, frame_width - right_offset,
-                     dst_width - right_offset, dst, top_offset, right_offset);
 
-  /* copy the source pixbuf into the framed area */
-  gdk_pixbuf_copy_area (source, 0, 0, src_width, src_height, dst, left_offset, top_offset);
 
-  return dst;
+static void
+blxo_pixbuf_frame_tile (const GdkPixbuf *slice,
+                        GdkPixbuf       *dst,
+                        gint             x,
+                        gint             y,
+                        gint             width,
+                        gint             height)
+{
+  gint slice_width;
+  gint slice_height;
+  gint n;
+
+  if (slice == NULL || width <= 0 || height <= 0)
+    return;
+
+  slice_width = MIN (gdk_pixbuf_get_width (slice), width);
+  slice_height = MIN (gdk_pixbuf_get_height (slice), height);
+
+  /* copy the slice once, then double the tiled area */
+  gdk_pixbuf_copy_area (slice, 0, 0, slice_width, slice_height, dst, x, y);
+  for (n = slice_width; n < width; n += n)
+    gdk_pixbuf_copy_area (dst, x, y, MIN (n, width - n), slice_height, dst, x + n, y);
+  for (n = slice_height; n < height; n += n)
+    gdk_pixbuf_copy_area (dst, x, y, width, MIN (n, height - n), dst, x, y + n);
+}
+
+
+
+/* called with the frame's mutex held */
+static BlxoPixbufFrameBackground*
+blxo_pixbuf_frame_get_background (BlxoPixbufFrame *frame,
+                                  gint             width,
+                                  gint             height)
+{
+  BlxoPixbufFrameBackground *background;
+  GSList                    *lp;
+  gint                       dst_width;
+  gint                       dst_height;
+  gint                       right;
+  gint                       bottom;
+
+  for (lp = frame->backgrounds; lp != NULL; lp = lp->next)
+    {
+      background = lp->data;
+      if (background->width == width && background->height == height)
+        {
+          /* move it to the front */
+          frame->backgrounds = g_slist_remove_link (frame->backgrounds, lp);
+          frame->backgrounds = g_slist_concat (lp, frame->backgrounds);
+          return background;
+        }
+    }
+
+  dst_width = width + frame->left_offset + frame->right_offset;
+  dst_height = height + frame->top_offset + frame->bottom_offset;
+  right = dst_width - frame->right_offset;
+  bottom = dst_height - frame->bottom_offset;
+
+  background = g_slice_new0 (BlxoPixbufFrameBackground);
+  background->width = width;
+  background->height = height;
+
+  /* render the frame around a transparent area for the content */
+  background->pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8, dst_width, dst_height);
+  gdk_pixbuf_fill (background->pixbuf, 0x00000000);
+  blxo_pixbuf_frame_tile (frame->slices[0], background->pixbuf, 0, 0, frame->left_offset, frame->top_offset);
+  blxo_pixbuf_frame_tile (frame->slices[1], background->pixbuf, frame->left_offset, 0, width, frame->top_offset);
+  blxo_pixbuf_frame_tile (frame->slices[2], background->pixbuf, right, 0, frame->right_offset, frame->top_offset);
+  blxo_pixbuf_frame_tile (frame->slices[3], background->pixbuf, 0, frame->top_offset, frame->left_offset, height);
+  blxo_pixbuf_frame_tile (frame->slices[5], background->pixbuf, right, frame->top_offset, frame->right_offset, height);
+  blxo_pixbuf_frame_tile (frame->slices[6], background->pixbuf, 0, bottom, frame->left_offset, frame->bottom_offset);
+  blxo_pixbuf_frame_tile (frame->slices[7], background->pixbuf, frame->left_offset, bottom, width, frame->bottom_offset);
+  blxo_pixbuf_frame_tile (frame->slices[8], background->pixbuf, right, bottom, frame->right_offset, frame->bottom_offset);
+
+  frame->backgrounds = g_slist_prepend (frame->backgrounds, background);
+
+  /* drop the least recently used background */
+  lp = g_slist_nth (frame->backgrounds, BLXO_PIXBUF_FRAME_MAX_BACKGROUNDS);
+  if (G_UNLIKELY (lp != NULL))
+    {
+      blxo_pixbuf_frame_background_free (lp->data);
+      frame->backgrounds = g_slist_delete_link (frame->backgrounds, lp);
+    }
+
+  return background;
 }
 
 
 
 /**
- * blxo_gdk_pixbuf_lucent:
- * @source  : the source #GdkPixbuf.
- * @percent : the percentage of translucency.
+ * blxo_pixbuf_frame_new:
+ * @image         : the frame #GdkPixbuf.
+ * @left_offset   : the left frame offset.
+ * @top_offset    : the top frame offset.
+ * @right_offset  : the right frame offset.
+ * @bottom_offset : the bottom frame offset.
  *
- * Returns a version of @source, whose pixels translucency is
- * @percent of the original @source pixels.
+ * Creates a new #BlxoPixbufFrame, which embeds images in the @image,
+ * like blxo_gdk_pixbuf_frame() does. The @image is sliced into its
+ * corners and edges once, and the frames rendered for the most
+ * recently used image sizes are cached, so framing an image only
+ * copies the image itself.
  *
- * The caller is responsible to free the returned object
- * using g_object_unref() when no longer needed.
+ * The caller is responsible to free the returned object using
+ * blxo_pixbuf_frame_unref() when no longer needed.
  *
- * Returns: a translucent version of @source.
+ * Returns: the new #BlxoPixbufFrame.
  *
- * Since: 0.3.1.3
+ * Since: 0.13.0
  **/
-GdkPixbuf*
-blxo_gdk_pixbuf_lucent (const GdkPixbuf *source,
-                       guint            percent)
+BlxoPixbufFrame*
+blxo_pixbuf_frame_new (const GdkPixbuf *image,
+                       gint             left_offset,
+                       gint             top_offset,
+                       gint             right_offset,
+                       gint             bottom_offset)
 {
-  GdkPixbuf *dst;
-  guchar    *dst_pixels;
-  guchar    *src_pixels;
-  guchar    *pixdst;
-  guchar    *pixsrc;
-  gint       dst_row_stride;
-  gint       src_row_stride;
-  gint       width;
-  gint       height;
-  gint       i, j;
-
-  g_return_val_if_fail (GDK_IS_PIXBUF (source), NULL);
-  g_return_val_if_fail ((gint) percent >= 0 && percent <= 100, NULL);
-
-  /* determine source parameters */
-  width = gdk_pixbuf_get_width (source);
-  height = gdk_pixbuf_get_height (source);
-
-  /* allocate the destination pixbuf */
-  dst = gdk_pixbuf_new (gdk_pixbuf_get_colorspace (source), TRUE, gdk_pixbuf_get_bits_per_sample (source), width, height);
-
-  /* determine row strides on src/dst */
-  dst_row_stride = gdk_pixbuf_get_rowstride (dst);
-  src_row_stride = gdk_pixbuf_get_rowstride (source);
-
-  /* determine pixels on src/dst */
-  dst_pixels = gdk_pixbuf_get_pixels (dst);
-  src_pixels = gdk_pixbuf_get_pixels (source);
+  BlxoPixbufFrame *frame;
+  gint             widths[3];
+  gint             heights[3];
+  gint             x, y;
+  gint             col, row;
+
+  g_return_val_if_fail (GDK_IS_PIXBUF (image), NULL);
+  g_return_val_if_fail (left_offset >= 0 && top_offset >= 0 && right_offset >= 0 && bottom_offset >= 0, NULL);
+  g_return_val_if_fail (gdk_pixbuf_get_width (image) > left_offset + right_offset, NULL);
+  g_return_val_if_fail (gdk_pixbuf_get_height (image) > top_offset + bottom_offset, NULL);
+
+  frame = g_slice_new0 (BlxoPixbufFrame);
+  frame->ref_count = 1;
+  g_mutex_init (&frame->mutex);
+  frame->left_offset = left_offset;
+  frame->top_offset = top_offset;
+  frame->right_offset = right_offset;
+  frame->bottom_offset = bottom_offset;
+
+  widths[0] = left_offset;
+  widths[1] = gdk_pixbuf_get_width (image) - left_offset - right_offset;
+  widths[2] = right_offset;
+  heights[0] = top_offset;
+  heights[1] = gdk_pixbuf_get_height (image) - top_offset - bottom_offset;
+  heights[2] = bottom_offset;
+
+  for (row = 0, y = 0; row < 3; y += heights[row++])
+    for (col = 0, x = 0; col < 3; x += widths[col++])
+      if ((row != 1 || col != 1) && widths[col] > 0 && heights[row] > 0)
+        frame->slices[row * 3 + col] = gdk_pixbuf_new_subpixbuf ((GdkPixbuf *) image, x, y, widths[col], heights[row]);
+
+  return frame;
+}
 
-  /* check if the source already contains an alpha channel */
-  if (G_LIKELY (gdk_pixbuf_get_has_alpha (source)))
-    {
-      for (i = height; --i >= 0; )
-        {
-          pixdst = dst_pixels + i * dst_row_stride;
-          pixsrc = src_pixels + i * src_row_stride;
 
-          for (j = width; --j >= 0; )
-            {
-              *pixdst++ = *pixsrc++;
-              *pixdst++ = *pixsrc++;
-              *pixdst++ = *pixsrc++;
-              *pixdst++ = ((guint) *pixsrc++ * percent) / 100u;
-            }
-        }
-    }
-  else
-    {
-      /* pre-calculate the alpha value */
-      percent = (255u * percent) / 100u;
 
-      for (i = height; --i >= 0; )
-        {
-          pixdst = dst_pixels + i * dst_row_stride;
-          pixsrc = src_pixels + i * src_row_stride;
+/**
+ * blxo_pixbuf_frame_ref:
+ * @frame : a #BlxoPixbufFrame.
+ *
+ * Increases the reference count of @frame by one.
+ *
+ * Returns: the @frame.
+ *
+ * Since: 0.13.0
+ **/
+BlxoPixbufFrame*
+blxo_pixbuf_frame_ref (BlxoPixbufFrame *frame)
+{
+  g_return_val_if_fail (frame != NULL, NULL);
+  g_return_val_if_fail (frame->ref_count > 0, NULL);
 
-          for (j = width; --j >= 0; )
-            {
-              *pixdst++ = *pixsrc++;
-              *pixdst++ = *pixsrc++;
-              *pixdst++ = *pixsrc++;
-              *pixdst++ = percent;
-            }
-        }
-    }
+  g_atomic_int_inc (&frame->ref_count);
 
-  return dst;
+  return frame;
 }
 
 
 
-static inline guchar
-lighten_channel (guchar cur_value)
+/**
+ * blxo_pixbuf_frame_unref:
+ * @frame : a #BlxoPixbufFrame.
+ *
+ * Decreases the reference count of @frame by one, and frees
+ * it when the reference count drops to zero.
+ *
+ * Since: 0.13.0
+ **/
+void
+blxo_pixbuf_frame_unref (BlxoPixbufFrame *frame)
 {
-  gint new_value = cur_value;
+  guint n;
 
-  new_value += 24 + (new_value >> 3);
-  if (G_UNLIKELY (new_value > 255))
-    new_value = 255;
+  g_return_if_fail (frame != NULL);
+  g_return_if_fail (frame->ref_count > 0);
+
+  if (g_atomic_int_dec_and_test (&frame->ref_count))
+    {
+      for (n = 0; n < G_N_ELEMENTS (frame->slices); ++n)
+        if (frame->slices[n] != NULL)
+          g_object_unref (G_OBJECT (frame->slices[n]));
 
-  return (guchar) new_value;
+      g_slist_free_full (frame->backgrounds, blxo_pixbuf_frame_background_free);
+      g_mutex_clear (&frame->mutex);
+      g_slice_free (BlxoPixbufFrame, frame);
+    }
 }
 
 
 
 /**
- * blxo_gdk_pixbuf_spotlight:
+ * blxo_pixbuf_frame_apply:
+ * @frame  : a #BlxoPixbufFrame.
  * @source : the source #GdkPixbuf.
  *
- * Creates a lightened version of @source, suitable for
- * prelit state display of icons.
+ * Embeds @source in @frame and returns the result as new #GdkPixbuf.
  *
- * The caller is responsible to free the returned
- * pixbuf using #g_object_unref().
+ * The caller is responsible to free the returned #GdkPixbuf using g_object_unref().
  *
- * Returns: the lightened version of @source.
+ * Returns: the framed version of @source.
  *
- * Since: 0.3.1.3
+ * Since: 0.13.0
  **/
 GdkPixbuf*
-blxo_gdk_pixbuf_spotlight (const GdkPixbuf *source)
+blxo_pixbuf_frame_apply (BlxoPixbufFrame *frame,
+                         const GdkPixbuf *source)
 {
-  GdkPixbuf *dst;
-  gboolean   has_alpha;
-  gint       dst_row_stride;
-  gint       src_row_stride;
-  gint       width;
-  gint       height;
-  gint       i;
+  BlxoPixbufFrameBackground *background;
+  GdkPixbuf                 *dst;
+  gint                       width;
+  gint                       height;
+
+  g_return_val_if_fail (frame != NULL, NULL);
+  g_return_val_if_fail (GDK_IS_PIXBUF (source), NULL);
 
-  /* determine source parameters */
   width = gdk_pixbuf_get_width (source);
   height = gdk_pixbuf_get_height (source);
-  has_alpha = gdk_pixbuf_get_has_alpha (source);
 
-  /* allocate the destination pixbuf */
-  dst = gdk_pixbuf_new (gdk_pixbuf_get_colorspace (source), has_alpha, gdk_pixbuf_get_bits_per_sample (source), width, height);
+  g_mutex_lock (&frame->mutex);
+  background = blxo_pixbuf_frame_get_background (frame, width, height);
+  dst = gdk_pixbuf_copy (background->pixbuf);
+  g_mutex_unlock (&frame->mutex);
 
-  /* determine src/dst row strides */
-  dst_row_stride = gdk_pixbuf_get_rowstride (dst);
-  src_row_stride = gdk_pixbuf_get_rowstride (source);
+  /* copy the source pixbuf into the framed area */
+  gdk_pixbuf_copy_area (source, 0, 0, width, height, dst, frame->left_offset, frame->top_offset);
 
-#if defined(__GNUC__) && defined(__MMX__)
-  /* check if there's a good reason to use MMX */
-  if (G_LIKELY (has_alpha && dst_row_stride == width * 4 && src_row_stride == width * 4 && (width * height) % 2 == 0))
-    {
-      __m64 *pixdst = (__m64 *) gdk_pixbuf_get_pixels (dst);
-      __m64 *pixsrc = (__m64 *) gdk_pixbuf_get_pixels (source);
-      __m64  alpha_mask = _mm_set_pi8 (0xff, 0, 0, 0, 0xff, 0, 0, 0);
-      __m64  twentyfour = _mm_set_pi8 (0, 24, 24, 24, 0, 24, 24, 24);
-      __m64  zero = _mm_setzero_si64 ();
+  return dst;
+}
 
-      for (i = (width * height) >> 1; i > 0; --i)
-        {
-          /* read the source pixel */
-          __m64 src = *pixsrc;
 
-          /* remember the two alpha values */
-          __m64 alpha = _mm_and_si64 (alpha_mask, src);
 
-          /* extract the hi pixel */
-          __m64 hi = _mm_unpackhi_pi8 (src, zero);
+/**
+ * blxo_pixbuf_frame_paint:
+ * @frame  : a #BlxoPixbufFrame.
+ * @cr     : the cairo context to paint to.
+ * @source : the source #GdkPixbuf.
+ * @x      : the left edge of the frame in user space.
+ * @y      : the top edge of the frame in user space.
+ *
+ * Paints @source embedded in @frame to @cr. The frame for the size of
+ * @source is converted to a cairo surface only once, so only @source
+ * itself is converted when painting.
+ *
+ * Since: 0.13.0
+ **/
+void
+blxo_pixbuf_frame_paint (BlxoPixbufFrame *frame,
+                         cairo_t         *cr,
+                         const GdkPixbuf *source,
+                         gdouble          x,
+                         gdouble          y)
+{
+  BlxoPixbufFrameBackground *background;
+  cairo_surface_t           *surface;
+
+  g_return_if_fail (frame != NULL);
+  g_return_if_fail (cr != NULL);
+  g_return_if_fail (GDK_IS_PIXBUF (source));
+
+  g_mutex_lock (&frame->mutex);
+  background = blxo_pixbuf_frame_get_background (frame, gdk_pixbuf_get_width (source), gdk_pixbuf_get_height (source));
+  if (background->surface == NULL)
+    background->surface = blxo_gdk_pixbuf_create_surface (background->pixbuf);
+  surface = cairo_surface_reference (background->surface);
+  g_mutex_unlock (&frame->mutex);
+
+  cairo_save (cr);
+  cairo_set_source_surface (cr, surface, x, y);
+  cairo_paint (cr);
+  gdk_cairo_set_source_pixbuf (cr, source, x + frame->left_offset, y + frame->top_offset);
+  cairo_paint (cr);
+  cairo_restore (cr);
+
+  cairo_surface_destroy (surface);
+}
+
+
 
-          /* extract the lo pixel */
-          __m64 lo = _mm_unpacklo_pi8 (src, zero);
+/**
+ * blxo_pixbuf_frame_create_surface:
+ * @frame  : a #BlxoPixbufFrame.
+ * @source : the source image surface.
+ *
+ * Embeds @source in @frame, like blxo_pixbuf_frame_apply() does, but
+ * works on premultiplied cairo image surfaces. The frame is converted
+ * to a cairo surface only once per size.
+ *
+ * The caller is responsible to free the returned surface using
+ * cairo_surface_destroy() when no longer needed.
+ *
+ * Returns: the framed version of @source, in %CAIRO_FORMAT_ARGB32.
+ *
+ * Since: 0.13.0
+ **/
+cairo_surface_t*
+blxo_pixbuf_frame_create_surface (BlxoPixbufFrame *frame,
+                                  cairo_surface_t *source)
+{
+  BlxoPixbufFrameBackground *background;
+  cairo_surface_t           *surface;
+  cairo_t                   *cr;
+  gint                       width;
+  gint                       height;
+
+  g_return_val_if_fail (frame != NULL, NULL);
+  g_return_val_if_fail (cairo_surface_get_type (source) == CAIRO_SURFACE_TYPE_IMAGE, NULL);
+
+  width = cairo_image_surface_get_width (source);
+  height = cairo_image_surface_get_height (source);
+
+  g_mutex_lock (&frame->mutex);
+  background = blxo_pixbuf_frame_get_background (frame, width, height);
+  if (background->surface == NULL)
+    background->surface = blxo_gdk_pixbuf_create_surface (background->pixbuf);
+  surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+                                        cairo_image_surface_get_width (background->surface),
+                                        cairo_image_surface_get_height (background->surface));
+  cr = cairo_create (surface);
+  cairo_set_source_surface (cr, background->surface, 0, 0);
+  cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
+  cairo_paint (cr);
+  g_mutex_unlock (&frame->mutex);
+
+  /* the area for the source is transparent */
+  cairo_set_source_surface (cr, source, frame->left_offset, frame->top_offset);
+  cairo_rectangle (cr, frame->left_offset, frame->top_offset, width, height);
+  cairo_fill (cr);
+  cairo_destroy (cr);
+
+  return surface;
+}
 
-          /* add (x >> 3) to x */
-          hi = _mm_adds_pu16 (hi, _mm_srli_pi16 (hi, 3));
-          lo = _mm_adds_pu16 (lo, _mm_srli_pi16 (lo, 3));
 
-          /* prefetch next value */
-          __builtin_prefetch (++pixsrc, 0, 1);
 
-          /* combine the two pixels again */
-          src = _mm_packs_pu16 (lo, hi);
+/**
+ * blxo_gdk_pixbuf_create_surface:
+ * @pixbuf : a #GdkPixbuf.
+ *
+ * Converts @pixbuf to a premultiplied cairo image surface, that
+ * can be passed to the blxo_cairo_surface functions and painted
+ * without further conversions.
+ *
+ * The caller is responsible to free the returned surface using
+ * cairo_surface_destroy() when no longer needed.
+ *
+ * Returns: a new image surface, in %CAIRO_FORMAT_ARGB32 if @pixbuf
+ *          has an alpha channel, or %CAIRO_FORMAT_RGB24 otherwise.
+ *
+ * Since: 0.13.0
+ **/
+cairo_surface_t*
+blxo_gdk_pixbuf_create_surface (const GdkPixbuf *pixbuf)
+{
+  cairo_surface_t *surface;
+  cairo_t         *cr;
 
-          /* add 24 (with saturation) */
-          src = _mm_adds_pu8 (src, twentyfour);
+  g_return_val_if_fail (GDK_IS_PIXBUF (pixbuf), NULL);
 
-          /* drop the alpha channel from the temp color */
-          src = _mm_andnot_si64 (alpha_mask, src);
+  surface = cairo_image_surface_create (gdk_pixbuf_get_has_alpha (pixbuf) ? CAIRO_FORMAT_ARGB32 : CAIRO_FORMAT_RGB24,
+                                        gdk_pixbuf_get_width (pixbuf),
+                                        gdk_pixbuf_get_height (pixbuf));
+  cr = cairo_create (surface);
+  gdk_cairo_set_source_pixbuf (cr, pixbuf, 0, 0);
+  cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
+  cairo_paint (cr);
+  cairo_destroy (cr);
 
-          /* write back the calculated color */
-          *pixdst = _mm_or_si64 (alpha, src);
+  return surface;
+}
 
-          /* advance the dest pointer */
-          ++pixdst;
-        }
 
-      _mm_empty ();
-    }
-  else
-#endif
-    {
-      guchar *dst_pixels = gdk_pixbuf_get_pixels (dst);
-      guchar *src_pixels = gdk_pixbuf_get_pixels (source);
-      guchar *pixdst;
-      guchar *pixsrc;
-      gint    j;
 
-      for (i = height; --i >= 0; )
-        {
-          pixdst = dst_pixels + i * dst_row_stride;
-          pixsrc = src_pixels + i * src_row_stride;
+static gboolean
+blxo_cairo_surface_is_image (cairo_surface_t *surface)
+{
+  cairo_format_t format;
 
-          for (j = width; j > 0; --j)
-            {
-              *pixdst++ = lighten_channel (*pixsrc++);
-              *pixdst++ = lighten_channel (*pixsrc++);
-              *pixdst++ = lighten_channel (*pixsrc++);
+  if (cairo_surface_get_type (surface) != CAIRO_SURFACE_TYPE_IMAGE)
+    return FALSE;
 
-              if (G_LIKELY (has_alpha))
-                *pixdst++ = *pixsrc++;
-            }
-        }
-    }
+  format = cairo_image_surface_get_format (surface);
+  return (format == CAIRO_FORMAT_ARGB32 || format == CAIRO_FORMAT_RGB24);
+}
 
-  return dst;
+
+
+/* the byte index of the alpha channel in the native-endian ARGB32 pixels */
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+#define BLXO_CAIRO_ALPHA (3)
+#else
+#define BLXO_CAIRO_ALPHA (0)
+#endif
+
+/* runs @kernel on all rows of @surface with @table */
+static void
+blxo_cairo_surface_run (cairo_surface_t *surface,
+                        void           (*kernel) (guchar *, const guchar *, gint, const guint16 *),
+                        const guint16   *table)
+{
+  guchar *pixels;
+  gint    stride;
+  gint    width;
+  gint    height;
+  gint    y;
+
+  cairo_surface_flush (surface);
+
+  pixels = cairo_image_surface_get_data (surface);
+  stride = cairo_image_surface_get_stride (surface);
+  width = cairo_image_surface_get_width (surface);
+  height = cairo_image_surface_get_height (surface);
+  for (y = 0; y < height; ++y, pixels += stride)
+    (*kernel) (pixels, pixels, width * 4, table);
+
+  cairo_surface_mark_dirty (surface);
 }
 
 
 
 /**
- * blxo_gdk_pixbuf_scale_down:
- * @source                : the source #GdkPixbuf.
+ * blxo_cairo_surface_scale_down:
+ * @source                : the source image surface.
  * @preserve_aspect_ratio : %TRUE to preserve aspect ratio.
  * @dest_width            : the max width for the result.
  * @dest_height           : the max height for the result.
  *
- * Scales down the @source to fit into the given @width and
- * @height. If @aspect_ratio is %TRUE then the aspect ratio
- * of @source will be preserved.
- *
- * If @width is larger than the width of @source and @height
- * is larger than the height of @source, a reference to
- * @source will be returned, as it's unneccesary then to
- * scale down.
+ * Scales down the image surface @source to fit into @dest_width and
+ * @dest_height, like blxo_gdk_pixbuf_scale_down() does for pixbufs.
  *
- * The caller is responsible to free the returned #GdkPixbuf
- * using g_object_unref() when no longer needed.
+ * The caller is responsible to free the returned surface using
+ * cairo_surface_destroy() when no longer needed.
  *
- * Returns: the resulting #GdkPixbuf.
+ * Returns: the resulting image surface, which is a new reference to
+ *          @source if it already fits.
  *
- * Since: 0.3.1.1
+ * Since: 0.13.0
  **/
-GdkPixbuf*
-blxo_gdk_pixbuf_scale_down (GdkPixbuf *source,
-                           gboolean   preserve_aspect_ratio,
-                           gint       dest_width,
-                           gint       dest_height)
+cairo_surface_t*
+blxo_cairo_surface_scale_down (cairo_surface_t *source,
+                               gboolean         preserve_aspect_ratio,
+                               gint             dest_width,
+                               gint             dest_height)
 {
-  gdouble wratio;
-  gdouble hratio;
+  cairo_surface_t *surface;
+  cairo_t         *cr;
+  gdouble          wratio;
+  gdouble          hratio;
+  gint             source_width;
+  gint             source_height;
+
+  g_return_val_if_fail (blxo_cairo_surface_is_image (source), NULL);
+  g_return_val_if_fail (dest_width > 0, NULL);
+  g_return_val_if_fail (dest_height > 0, NULL);
+
+  source_width = cairo_image_surface_get_width (source);
+  source_height = cairo_image_surface_get_height (source);
+
+  /* check if we need to scale */
+  if (G_UNLIKELY (source_width <= dest_width && source_height <= dest_height))
+    return cairo_surface_reference (source);
+
+  /* check if aspect ratio should be preserved */
+  if (G_LIKELY (preserve_aspect_ratio))
+    {
+      /* calculate the new dimensions */
+      wratio = (gdouble) source_width  / (gdouble) dest_width;
+      hratio = (gdouble) source_height / (gdouble) dest_height;
+
+      if (hratio > wratio)
+        dest_width  = rint (source_width / hratio);
+      else
+        dest_height = rint (source_height / wratio);
+    }
+
+  dest_width = MAX (dest_width, 1);
+  dest_height = MAX (dest_height, 1);
+
+  /* let pixman filter the image down */
+  surface = cairo_image_surface_create (cairo_image_surface_get_format (source), dest_width, dest_height);
+  cr = cairo_create (surface);
+  cairo_scale (cr, (gdouble) dest_width / source_width, (gdouble) dest_height / source_height);
+  cairo_set_source_surface (cr, source, 0, 0);
+  cairo_pattern_set_filter (cairo_get_source (cr), CAIRO_FILTER_GOOD);
+
+  /* repeat the edge pixels, instead of filtering in transparent black there */
+  cairo_pattern_set_extend (cairo_get_source (cr), CAIRO_EXTEND_PAD);
+  cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
+  cairo_paint (cr);
+  cairo_destroy (cr);
+
+  return surface;
+}
+
+
+
+/**
+ * blxo_cairo_surface_colorize:
+ * @surface : an image surface.
+ * @color   : the new color.
+ *
+ * Colorizes the premultiplied @surface to @color in place, like
+ * blxo_gdk_pixbuf_colorize() does for pixbufs.
+ *
+ * Since: 0.13.0
+ **/
+void
+blxo_cairo_surface_colorize (cairo_surface_t *surface,
+                             const GdkColor  *color)
+{
+  guint16 factors[BLXO_PIXBUF_KERNEL_TABLE_SIZE];
+  gint    i;
+
+  g_return_if_fail (blxo_cairo_surface_is_image (surface));
+  g_return_if_fail (color != NULL);
+
+  /* colorizing is linear, so it works on premultiplied pixels as well */
+  for (i = 0; i < BLXO_PIXBUF_KERNEL_TABLE_SIZE; ++i)
+    {
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+      switch (i % 4)
+        {
+        case 0:  factors[i] = color->blue / 255.0;  break;
+        case 1:  factors[i] = color->green / 255.0; break;
+        case 2:  factors[i] = color->red / 255.0;   break;
+        default: factors[i] = 256;                  break;
+        }
+#else
+      switch (i % 4)
+        {
+        case 1:  factors[i] = color->red / 255.0;   break;
+        case 2:  factors[i] = color->green / 255.0; break;
+        case 3:  factors[i] = color->blue / 255.0;  break;
+        default: factors[i] = 256;                  break;
+        }
+#endif
+    }
+
+  blxo_cairo_surface_run (surface, _blxo_pixbuf_kernels_get ()->colorize, factors);
+}
+
+
+
+/**
+ * blxo_cairo_surface_spotlight:
+ * @surface : an image surface.
+ *
+ * Lightens the premultiplied @surface in place, like
+ * blxo_gdk_pixbuf_spotlight() does for pixbufs.
+ *
+ * Since: 0.13.0
+ **/
+void
+blxo_cairo_surface_spotlight (cairo_surface_t *surface)
+{
+  const BlxoPixbufKernels *kernels;
+  gboolean                 opaque;
+  guint16                  mask[BLXO_PIXBUF_KERNEL_TABLE_SIZE];
+  guchar                  *pixels;
+  guchar                  *p;
+  guint                    alpha;
+  guint                    value;
+  gint                     stride;
+  gint                     width;
+  gint                     height;
+  gint                     x, y, i;
+
+  g_return_if_fail (blxo_cairo_surface_is_image (surface));
+
+  /* lighten the color channels, but not the alpha channel */
+  for (i = 0; i < BLXO_PIXBUF_KERNEL_TABLE_SIZE; ++i)
+    mask[i] = (i % 4 != BLXO_CAIRO_ALPHA) ? 0xffff : 0;
+
+  cairo_surface_flush (surface);
+
+  kernels = _blxo_pixbuf_kernels_get ();
+  opaque = (cairo_image_surface_get_format (surface) == CAIRO_FORMAT_RGB24);
+  pixels = cairo_image_surface_get_data (surface);
+  stride = cairo_image_surface_get_stride (surface);
+  width = cairo_image_surface_get_width (surface);
+  height = cairo_image_surface_get_height (surface);
+  for (y = 0; y < height; ++y, pixels += stride)
+    {
+      /* opaque rows are lightened like straight alpha rows */
+      for (x = 0; !opaque && x < width && pixels[x * 4 + BLXO_CAIRO_ALPHA] == 255; ++x)
+        ;
+      if (opaque || x == width)
+        {
+          kernels->spotlight (pixels, pixels, width * 4, mask);
+          continue;
+        }
+
+      /* others need to be unpremultiplied for the lightening */
+      for (x = 0, p = pixels; x < width; ++x, p += 4)
+        {
+          alpha = p[BLXO_CAIRO_ALPHA];
+          if (alpha == 0)
+            continue;
+
+          for (i = 0; i < 4; ++i)
+            {
+              if (i == BLXO_CAIRO_ALPHA)
+                continue;
+
+              /* like the spotlight kernels */
+              value = (p[i] * 255 + alpha / 2) / alpha;
+              value += 24 + (value >> 3);
+              p[i] = (MIN (value, 255) * alpha + 127) / 255;
+            }
+        }
+    }
+
+  cairo_surface_mark_dirty (surface);
+}
+
+
+
+/**
+ * blxo_cairo_surface_lucent:
+ * @surface : an image surface in %CAIRO_FORMAT_ARGB32.
+ * @percent : the percentage of translucency.
+ *
+ * Makes the premultiplied @surface translucent in place, like
+ * blxo_gdk_pixbuf_lucent() does for pixbufs.
+ *
+ * Since: 0.13.0
+ **/
+void
+blxo_cairo_surface_lucent (cairo_surface_t *surface,
+                           guint            percent)
+{
+  guint16 factors[BLXO_PIXBUF_KERNEL_TABLE_SIZE];
+  gint    i;
+
+  g_return_if_fail (cairo_surface_get_type (surface) == CAIRO_SURFACE_TYPE_IMAGE);
+  g_return_if_fail (cairo_image_surface_get_format (surface) == CAIRO_FORMAT_ARGB32);
+  g_return_if_fail ((gint) percent >= 0 && percent <= 100);
+
+  /* premultiplied pixels scale all channels with the alpha channel */
+  for (i = 0; i < BLXO_PIXBUF_KERNEL_TABLE_SIZE; ++i)
+    factors[i] = (percent * 256 + 50) / 100;
+
+  blxo_cairo_surface_run (surface, _blxo_pixbuf_kernels_get ()->colorize, factors);
+}
+
+
+
+/**
+ * blxo_gdk_pixbuf_lucent:
+ * @source  : the source #GdkPixbuf.
+ * @percent : the percentage of translucency.
+ *
+ * Returns a version of @source, whose pixels translucency is
+ * @percent of the original @source pixels.
+ *
+ * The caller is responsible to free the returned object
+ * using g_object_unref() when no longer needed.
+ *
+ * Returns: a translucent version of @source.
+ *
+ * Since: 0.3.1.3
+ **/
+GdkPixbuf*
+blxo_gdk_pixbuf_lucent (const GdkPixbuf *source,
+                       guint            percent)
+{
+  GdkPixbuf *dst;
+
+  g_return_val_if_fail (GDK_IS_PIXBUF (source), NULL);
+  g_return_val_if_fail ((gint) percent >= 0 && percent <= 100, NULL);
+
+  /* allocate the destination pixbuf */
+  dst = gdk_pixbuf_new (gdk_pixbuf_get_colorspace (source), TRUE, gdk_pixbuf_get_bits_per_sample (source),
+                        gdk_pixbuf_get_width (source), gdk_pixbuf_get_height (source));
+
+  blxo_gdk_pixbuf_lucent_into (source, percent, dst);
+
+  return dst;
+}
+
+
+
+/**
+ * blxo_gdk_pixbuf_lucent_into:
+ * @source  : the source #GdkPixbuf.
+ * @percent : the percentage of translucency.
+ * @dest    : the destination #GdkPixbuf.
+ *
+ * Writes the version of @source, whose pixels translucency is
+ * @percent of the original @source pixels, to @dest. The @dest
+ * must have the same dimensions as @source and an alpha channel.
+ * It may also be @source itself, if @source has an alpha channel.
+ *
+ * Since: 0.13.0
+ **/
+void
+blxo_gdk_pixbuf_lucent_into (const GdkPixbuf *source,
+                            guint            percent,
+                            GdkPixbuf       *dest)
+{
+  const BlxoPixbufKernels *kernels;
+  gboolean                has_alpha;
+  guchar                 *dst_pixels;
+  guchar                 *src_pixels;
+  gint                    dst_row_stride;
+  gint                    src_row_stride;
+  gint                    width;
+  gint                    height;
+  gint                    i;
+
+  g_return_if_fail (GDK_IS_PIXBUF (source));
+  g_return_if_fail (GDK_IS_PIXBUF (dest));
+  g_return_if_fail ((gint) percent >= 0 && percent <= 100);
+  g_return_if_fail (gdk_pixbuf_get_width (dest) == gdk_pixbuf_get_width (source));
+  g_return_if_fail (gdk_pixbuf_get_height (dest) == gdk_pixbuf_get_height (source));
+  g_return_if_fail (gdk_pixbuf_get_has_alpha (dest));
+
+  /* determine source parameters */
+  width = gdk_pixbuf_get_width (source);
+  height = gdk_pixbuf_get_height (source);
+  has_alpha = gdk_pixbuf_get_has_alpha (source);
+
+  /* determine row strides on src/dst */
+  dst_row_stride = gdk_pixbuf_get_rowstride (dest);
+  src_row_stride = gdk_pixbuf_get_rowstride (source);
+
+  /* determine pixels on src/dst */
+  dst_pixels = gdk_pixbuf_get_pixels (dest);
+  src_pixels = gdk_pixbuf_get_pixels (source);
+
+  /* scale the alpha of the rows using the best kernel for this CPU */
+  kernels = _blxo_pixbuf_kernels_get ();
+  for (i = 0; i < height; ++i)
+    kernels->lucent (dst_pixels + i * dst_row_stride, src_pixels + i * src_row_stride, width, has_alpha, percent);
+}
+
+
+
+/**
+ * blxo_gdk_pixbuf_lucent_inplace:
+ * @pixbuf  : a #GdkPixbuf with an alpha channel.
+ * @percent : the percentage of translucency.
+ *
+ * Scales the translucency of the pixels of @pixbuf to @percent, without
+ * allocating a new #GdkPixbuf. The @pixbuf must be owned by the caller
+ * only, i.e. it must not be shared with a cache, like the #GtkIconTheme.
+ *
+ * Since: 0.13.0
+ **/
+void
+blxo_gdk_pixbuf_lucent_inplace (GdkPixbuf *pixbuf,
+                               guint      percent)
+{
+  blxo_gdk_pixbuf_lucent_into (pixbuf, percent, pixbuf);
+}
+
+
+
+/**
+ * blxo_gdk_pixbuf_spotlight:
+ * @source : the source #GdkPixbuf.
+ *
+ * Creates a lightened version of @source, suitable for
+ * prelit state display of icons.
+ *
+ * The caller is responsible to free the returned
+ * pixbuf using #g_object_unref().
+ *
+ * Returns: the lightened version of @source.
+ *
+ * Since: 0.3.1.3
+ **/
+GdkPixbuf*
+blxo_gdk_pixbuf_spotlight (const GdkPixbuf *source)
+{
+  GdkPixbuf *dst;
+
+  /* allocate the destination pixbuf */
+  dst = gdk_pixbuf_new (gdk_pixbuf_get_colorspace (source), gdk_pixbuf_get_has_alpha (source),
+                        gdk_pixbuf_get_bits_per_sample (source), gdk_pixbuf_get_width (source),
+                        gdk_pixbuf_get_height (source));
+
+  blxo_gdk_pixbuf_spotlight_into (source, dst);
+
+  return dst;
+}
+
+
+
+/**
+ * blxo_gdk_pixbuf_spotlight_into:
+ * @source : the source #GdkPixbuf.
+ * @dest   : the destination #GdkPixbuf.
+ *
+ * Writes the lightened version of @source to @dest. The @dest must
+ * have the same dimensions and channels as @source, and may also be
+ * @source itself.
+ *
+ * Since: 0.13.0
+ **/
+void
+blxo_gdk_pixbuf_spotlight_into (const GdkPixbuf *source,
+                               GdkPixbuf       *dest)
+{
+  const BlxoPixbufKernels *kernels;
+  guint16                 mask[BLXO_PIXBUF_KERNEL_TABLE_SIZE];
+  guchar                 *dst_pixels;
+  guchar                 *src_pixels;
+  gint                    dst_row_stride;
+  gint                    src_row_stride;
+  gint                    n_channels;
+  gint                    width;
+  gint                    height;
+  gint                    i;
+
+  g_return_if_fail (GDK_IS_PIXBUF (source));
+  g_return_if_fail (GDK_IS_PIXBUF (dest));
+  g_return_if_fail (gdk_pixbuf_get_width (dest) == gdk_pixbuf_get_width (source));
+  g_return_if_fail (gdk_pixbuf_get_height (dest) == gdk_pixbuf_get_height (source));
+  g_return_if_fail (gdk_pixbuf_get_n_channels (dest) == gdk_pixbuf_get_n_channels (source));
+
+  /* determine source parameters */
+  width = gdk_pixbuf_get_width (source);
+  height = gdk_pixbuf_get_height (source);
+  n_channels = gdk_pixbuf_get_n_channels (source);
+
+  /* determine src/dst row strides */
+  dst_row_stride = gdk_pixbuf_get_rowstride (dest);
+  src_row_stride = gdk_pixbuf_get_rowstride (source);
+
+  /* lighten the color channels, but not the alpha channel */
+  for (i = 0; i < BLXO_PIXBUF_KERNEL_TABLE_SIZE; ++i)
+    mask[i] = (i % n_channels < 3) ? 0xffff : 0;
+
+  /* lighten the rows using the best kernel for this CPU */
+  kernels = _blxo_pixbuf_kernels_get ();
+  dst_pixels = gdk_pixbuf_get_pixels (dest);
+  src_pixels = gdk_pixbuf_get_pixels (source);
+  for (i = 0; i < height; ++i)
+    kernels->spotlight (dst_pixels + i * dst_row_stride, src_pixels + i * src_row_stride, width * n_channels, mask);
+}
+
+
+
+/**
+ * blxo_gdk_pixbuf_spotlight_inplace:
+ * @pixbuf : a #GdkPixbuf.
+ *
+ * Lightens @pixbuf, without allocating a new #GdkPixbuf. The @pixbuf
+ * must be owned by the caller only, i.e. it must not be shared with
+ * a cache, like the #GtkIconTheme.
+ *
+ * Since: 0.13.0
+ **/
+void
+blxo_gdk_pixbuf_spotlight_inplace (GdkPixbuf *pixbuf)
+{
+  blxo_gdk_pixbuf_spotlight_into (pixbuf, pixbuf);
+}
+
+
+
+/**
+ * blxo_gdk_pixbuf_scale_down:
+ * @source                : the source #GdkPixbuf.
+ * @preserve_aspect_ratio : %TRUE to preserve aspect ratio.
+ * @dest_width            : the max width for the result.
+ * @dest_height           : the max height for the result.
+ *
+ * Scales down the @source to fit into the given @width and
+ * @height. If @aspect_ratio is %TRUE then the aspect ratio
+ * of @source will be preserved.
+ *
+ * If @width is larger than the width of @source and @height
+ * is larger than the height of @source, a reference to
+ * @source will be returned, as it's unneccesary then to
+ * scale down.
+ *
+ * The caller is responsible to free the returned #GdkPixbuf
+ * using g_object_unref() when no longer needed.
+ *
+ * Returns: the resulting #GdkPixbuf.
+ *
+ * Since: 0.3.1.1
+ **/
+GdkPixbuf*
+blxo_gdk_pixbuf_scale_down (GdkPixbuf *source,
+                           gboolean   preserve_aspect_ratio,
+                           gint       dest_width,
+                           gint       dest_height)
+{
+  gdouble wratio;
+  gdouble hratio;
   gint    source_width;
   gint    source_height;
 
@@ -611,7 +1256,200 @@ blxo_gdk_pixbuf_scale_down (GdkPixbuf *source,
         dest_height = rint (source_height / wratio);
     }
 
-  return gdk_pixbuf_scale_simple (source, MAX (dest_width, 1), MAX (dest_height, 1), GDK_INTERP_BILINEAR);
+  return _blxo_pixbuf_scale (source, MAX (dest_width, 1), MAX (dest_height, 1));
+}
+
+
+
+/**
+ * blxo_gdk_pixbuf_apply_effects:
+ * @source  : the source #GdkPixbuf.
+ * @effects : the #BlxoGdkPixbufEffects to apply.
+ *
+ * Applies all @effects to @source in a single pass, instead of calling
+ * blxo_gdk_pixbuf_scale_down(), blxo_gdk_pixbuf_colorize(),
+ * blxo_gdk_pixbuf_spotlight() and blxo_gdk_pixbuf_lucent() one after
+ * another. The result is the same as calling these functions in that
+ * order, but every row of the result is produced while it is still in
+ * the CPU cache, and no intermediate images are allocated.
+ *
+ * The caller is responsible to free the returned object
+ * using g_object_unref() when no longer needed.
+ *
+ * Returns: the #GdkPixbuf with the @effects applied, which may be
+ *          @source itself, with a new reference, if there is
+ *          nothing to do.
+ *
+ * Since: 0.13.0
+ **/
+GdkPixbuf*
+blxo_gdk_pixbuf_apply_effects (const GdkPixbuf            *source,
+                              const BlxoGdkPixbufEffects *effects)
+{
+  const BlxoPixbufKernels *kernels;
+  BlxoGdkPixbufEffects    unscaled;
+  GdkPixbuf              *dst;
+  GdkPixbuf              *strip = NULL;
+  gboolean                has_alpha;
+  guint16                 factors[BLXO_PIXBUF_KERNEL_TABLE_SIZE];
+  guint16                 mask[BLXO_PIXBUF_KERNEL_TABLE_SIZE];
+  gdouble                 wratio;
+  gdouble                 hratio;
+  guchar                 *row = NULL;
+  guchar                 *dst_pixels;
+  guchar                 *src_pixels;
+  guchar                 *dst_row;
+  guchar                 *src_row;
+  guchar                 *target;
+  gint                    dst_row_stride;
+  gint                    src_row_stride;
+  gint                    n_channels;
+  gint                    source_width;
+  gint                    source_height;
+  gint                    width;
+  gint                    height;
+  gint                    n_rows;
+  gint                    i, y;
+
+  g_return_val_if_fail (GDK_IS_PIXBUF (source), NULL);
+  g_return_val_if_fail (effects != NULL, NULL);
+  g_return_val_if_fail (effects->max_width >= 0 && effects->max_height >= 0, NULL);
+  g_return_val_if_fail (!effects->lucent || effects->lucent_percent <= 100, NULL);
+
+  source_width = width = gdk_pixbuf_get_width (source);
+  source_height = height = gdk_pixbuf_get_height (source);
+  has_alpha = gdk_pixbuf_get_has_alpha (source);
+  n_channels = gdk_pixbuf_get_n_channels (source);
+
+  /* determine the scaled size, like blxo_gdk_pixbuf_scale_down() */
+  if (effects->max_width > 0 && effects->max_height > 0
+      && (source_width > effects->max_width || source_height > effects->max_height))
+    {
+      wratio = (gdouble) source_width  / (gdouble) effects->max_width;
+      hratio = (gdouble) source_height / (gdouble) effects->max_height;
+
+      width = effects->max_width;
+      height = effects->max_height;
+      if (hratio > wratio)
+        width = rint (source_width / hratio);
+      else
+        height = rint (source_height / wratio);
+
+      width = MAX (width, 1);
+      height = MAX (height, 1);
+    }
+
+  /* check if there's anything to do */
+  if (width == source_width && height == source_height
+      && effects->tint == NULL && !effects->lighten && !effects->lucent)
+    return GDK_PIXBUF (g_object_ref (G_OBJECT (source)));
+
+  /* large images are scaled down in parallel first */
+  if ((width != source_width || height != source_height)
+      && (gint64) source_width * source_height >= BLXO_PIXBUF_SCALER_MIN_PIXELS)
+    {
+      strip = _blxo_pixbuf_scale (source, width, height);
+      unscaled = *effects;
+      unscaled.max_width = unscaled.max_height = 0;
+      dst = blxo_gdk_pixbuf_apply_effects (strip, &unscaled);
+      g_object_unref (G_OBJECT (strip));
+      return dst;
+    }
+
+  /* allocate the destination pixbuf */
+  dst = _blxo_gdk_pixbuf_new_recycled (has_alpha || effects->lucent, width, height);
+  dst_row_stride = gdk_pixbuf_get_rowstride (dst);
+  dst_pixels = gdk_pixbuf_get_pixels (dst);
+
+  /* setup the kernel tables */
+  if (effects->tint != NULL)
+    {
+      for (i = 0; i < BLXO_PIXBUF_KERNEL_TABLE_SIZE; ++i)
+        {
+          switch (i % n_channels)
+            {
+            case 0:  factors[i] = effects->tint->red / 255.0;   break;
+            case 1:  factors[i] = effects->tint->green / 255.0; break;
+            case 2:  factors[i] = effects->tint->blue / 255.0;  break;
+            default: factors[i] = 256;                          break;
+            }
+        }
+    }
+
+  if (effects->lighten)
+    {
+      for (i = 0; i < BLXO_PIXBUF_KERNEL_TABLE_SIZE; ++i)
+        mask[i] = (i % n_channels < 3) ? 0xffff : 0;
+    }
+
+  /* scaled rows are produced in strips, which stay in the cache until the
+   * other effects are applied; gdk-pixbuf computes every pixel the same,
+   * regardless of the region being rendered */
+  if (width != source_width || height != source_height)
+    {
+      strip = _blxo_gdk_pixbuf_new_recycled (has_alpha, width, MIN (height, BLXO_GDK_PIXBUF_EFFECTS_STRIP));
+      src_row_stride = gdk_pixbuf_get_rowstride (strip);
+      src_pixels = gdk_pixbuf_get_pixels (strip);
+    }
+  else
+    {
+      src_row_stride = gdk_pixbuf_get_rowstride (source);
+      src_pixels = gdk_pixbuf_get_pixels (source);
+
+      /* the color effects of unscaled RGB rows need a scratch row, if the result has an alpha channel */
+      if (!has_alpha && effects->lucent && (effects->tint != NULL || effects->lighten))
+        row = g_malloc (width * n_channels);
+    }
+
+  kernels = _blxo_pixbuf_kernels_get ();
+  for (y = 0; y < height; y += n_rows)
+    {
+      n_rows = MIN (height - y, BLXO_GDK_PIXBUF_EFFECTS_STRIP);
+
+      if (strip != NULL)
+        {
+          gdk_pixbuf_scale (source, strip, 0, 0, width, n_rows, 0.0, -y,
+                            (gdouble) width / source_width, (gdouble) height / source_height,
+                            GDK_INTERP_BILINEAR);
+        }
+
+      for (i = 0; i < n_rows; ++i)
+        {
+          src_row = (strip != NULL) ? src_pixels + i * src_row_stride : src_pixels + (y + i) * src_row_stride;
+          dst_row = dst_pixels + (y + i) * dst_row_stride;
+
+          /* the color effects work on the layout of the source */
+          if (has_alpha || !effects->lucent)
+            target = dst_row;
+          else if (strip != NULL)
+            target = src_row;
+          else
+            target = row;
+
+          if (effects->tint != NULL)
+            {
+              kernels->colorize (target, src_row, width * n_channels, factors);
+              src_row = target;
+            }
+
+          if (effects->lighten)
+            {
+              kernels->spotlight (target, src_row, width * n_channels, mask);
+              src_row = target;
+            }
+
+          if (effects->lucent)
+            kernels->lucent (dst_row, src_row, width, has_alpha, effects->lucent_percent);
+          else if (src_row != dst_row)
+            memcpy (dst_row, src_row, width * n_channels);
+        }
+    }
+
+  if (strip != NULL)
+    g_object_unref (G_OBJECT (strip));
+  g_free (row);
+
+  return dst;
 }
 
 
@@ -657,7 +1495,7 @@ blxo_gdk_pixbuf_scale_ratio (GdkPixbuf *source,
       dest_height = rint (source_height / wratio);
     }
 
-  return gdk_pixbuf_scale_simple (source, MAX (dest_width, 1), MAX (dest_height, 1), GDK_INTERP_BILINEAR);
+  return _blxo_pixbuf_scale (source, MAX (dest_width, 1), MAX (dest_height, 1));
 }
 
 
@@ -714,63 +1552,89 @@ size_prepared (GdkPixbufLoader  *loader,
         }
     }
 
-  /* apply the new dimensions */
-  gdk_pixbuf_loader_set_size (loader, MAX (width, 1), MAX (height, 1));
+  /* apply the new dimensions */
+  gdk_pixbuf_loader_set_size (loader, MAX (width, 1), MAX (height, 1));
+}
+
+
+
+static gboolean
+blxo_gdk_pixbuf_previews_disabled (void)
+{
+  static gsize disabled = 0;
+
+  /* BLXO_EMBEDDED_PREVIEWS=0 in the environment overrides all callers */
+  if (g_once_init_enter (&disabled))
+    g_once_init_leave (&disabled, (g_strcmp0 (g_getenv ("BLXO_EMBEDDED_PREVIEWS"), "0") == 0) ? 2 : 1);
+
+  return (disabled == 2);
+}
+
+
+
+static GdkPixbuf*
+blxo_gdk_pixbuf_load_preview (const guchar     *data,
+                              gsize             length,
+                              guint             orientation,
+                              SizePreparedInfo *info)
+{
+  GdkPixbufLoader *loader;
+  GdkPixbuf       *pixbuf = NULL;
+  gchar            value[4];
+
+  loader = gdk_pixbuf_loader_new_with_type ("jpeg", NULL);
+  if (G_UNLIKELY (loader == NULL))
+    return NULL;
+
+  g_signal_connect (G_OBJECT (loader), "size-prepared", G_CALLBACK (size_prepared), info);
+
+  /* any error makes the caller decode the image itself */
+  if (!gdk_pixbuf_loader_write (loader, data, length, NULL))
+    {
+      gdk_pixbuf_loader_close (loader, NULL);
+    }
+  else if (gdk_pixbuf_loader_close (loader, NULL))
+    {
+      pixbuf = gdk_pixbuf_loader_get_pixbuf (loader);
+      if (G_LIKELY (pixbuf != NULL))
+        g_object_ref (G_OBJECT (pixbuf));
+    }
+
+  g_object_unref (G_OBJECT (loader));
+
+  /* the preview is stored unrotated, so pass on the orientation of the
+   * image, unless the preview has EXIF data of its own */
+  if (G_LIKELY (pixbuf != NULL) && orientation > 1)
+    {
+      g_snprintf (value, sizeof (value), "%u", orientation);
+      gdk_pixbuf_set_option (pixbuf, "orientation", value);
+    }
+
+  return pixbuf;
 }
 
 
 
-/**
- * blxo_gdk_pixbuf_new_from_file_at_max_size:
- * @filename              : name of the file to load, in the GLib file
- *                          name encoding.
- * @max_width             : the maximum width of the loaded image.
- * @max_height            : the maximum height of the loaded image.
- * @preserve_aspect_ratio : %TRUE to preserve the image's aspect ratio
- *                          while scaling to fit into @max_width and @max_height.
- * @error                 : return location for errors or %NULL.
- *
- * Creates a new #GdkPixbuf by loading an image from the file at
- * @filename. The file format is detected automatically. If %NULL is
- * returned, then @error will be set. Possible errors are in the
- * #GDK_PIXBUF_ERROR and #G_FILE_ERROR domains. If the image dimensions
- * exceed @max_width or @max_height, the image will be scaled down to
- * fit into the dimensions, optionally preservingthe image's aspect
- * ratio. The image may still be larger, depending on the loader.
- *
- * The advantage of using this function over
- * gdk_pixbuf_new_from_file_at_scale() is that images will never be
- * scaled up, whichwould otherwise result in ugly images.
- *
- * Returns: a newly created #GdkPixbuf with a reference count or 1, or
- *          %NULL if any of several error conditions occurred: the file
- *          could not be opened, there was no loader for the file's format,
- *          there was not enough memory to allocate the buffer for the
- *          image, or the image file contained invalid data.
- *
- * Since: 0.3.1.9
- **/
-GdkPixbuf*
-blxo_gdk_pixbuf_new_from_file_at_max_size (const gchar *filename,
-                                          gint         max_width,
-                                          gint         max_height,
-                                          gboolean     preserve_aspect_ratio,
-                                          GError     **error)
+static GdkPixbuf*
+blxo_gdk_pixbuf_load_at_max_size (const gchar  *filename,
+                                  gint          max_width,
+                                  gint          max_height,
+                                  gboolean      preserve_aspect_ratio,
+                                  gboolean      use_previews,
+                                  GCancellable *cancellable,
+                                  GError      **error)
 {
   SizePreparedInfo info;
   GdkPixbufLoader *loader;
   struct stat      statb;
   GdkPixbuf       *pixbuf;
-  guchar          *buffer;
   gchar           *display_name;
   gint             sverrno;
   gint             fd;
-  gint             n;
-
-  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
-  g_return_val_if_fail (filename != NULL, NULL);
-  g_return_val_if_fail (max_height > 0, NULL);
-  g_return_val_if_fail (max_width > 0, NULL);
+#ifdef HAVE_MMAP
+  BlxoExifPreview  preview;
+  guchar          *buffer;
+#endif
 
   /* try to open the file for reading */
   fd = g_open (filename, _O_BINARY | O_RDONLY, 0000);
@@ -811,66 +1675,40 @@ err1: /* initialize the library's i18n support */
   info.max_height = max_height;
   info.preserve_aspect_ratio = preserve_aspect_ratio;
 
-  /* allocate a new pixbuf loader */
-  loader = gdk_pixbuf_loader_new ();
-  g_signal_connect (G_OBJECT (loader), "size-prepared", G_CALLBACK (size_prepared), &info);
-
 #ifdef HAVE_MMAP
-  /* try to mmap() the file it's not too large */
-  buffer = mmap (NULL, statb.st_size, PROT_READ, MAP_SHARED, fd, 0);
-  if (G_LIKELY (buffer != MAP_FAILED))
+  /* decode an embedded preview instead, if it's large enough; only
+   * the pages of the headers and the preview are read from the file */
+  if (use_previews && statb.st_size > 0 && !blxo_gdk_pixbuf_previews_disabled ())
     {
-      /* feed the data into the loader */
-      if (!gdk_pixbuf_loader_write (loader, buffer, statb.st_size, error))
+      buffer = mmap (NULL, statb.st_size, PROT_READ, MAP_SHARED, fd, 0);
+      if (G_LIKELY (buffer != MAP_FAILED))
         {
-          /* something went wrong */
+          pixbuf = NULL;
+          if (_blxo_exif_find_preview (buffer, statb.st_size, max_width, max_height, preserve_aspect_ratio, &preview))
+            pixbuf = blxo_gdk_pixbuf_load_preview (buffer + preview.offset, preview.length, preview.orientation, &info);
           munmap (buffer, statb.st_size);
-          goto err2;
-        }
-
-      /* unmap the file */
-      munmap (buffer, statb.st_size);
-    }
-  else
-#endif
-    {
-      /* allocate the read buffer */
-      buffer = g_newa (guchar, 8192);
 
-      /* read the file content */
-      for (;;)
-        {
-          /* read the next chunk */
-          n = read (fd, buffer, 8192);
-          if (G_UNLIKELY (n < 0))
+          if (G_LIKELY (pixbuf != NULL))
             {
-              /* remember the errno value */
-              sverrno = errno;
-
-              /* initialize the library's i18n support */
-              _blxo_i18n_init ();
-
-              /* generate a useful error message */
-              display_name = g_filename_display_name (filename);
-              g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (sverrno), _("Failed to read file \"%s\": %s"), display_name, g_strerror (sverrno));
-              g_free (display_name);
-
-              /* close the loader and the file */
-err2:         gdk_pixbuf_loader_close (loader, NULL);
               close (fd);
-              goto err3;
-            }
-          else if (n == 0)
-            {
-              /* file read completely */
-              break;
+              return pixbuf;
             }
-
-          /* feed the data into the loader */
-          if (!gdk_pixbuf_loader_write (loader, buffer, n, error))
-            goto err2;
         }
     }
+#endif
+
+  /* allocate a new pixbuf loader */
+  loader = gdk_pixbuf_loader_new ();
+  g_signal_connect (G_OBJECT (loader), "size-prepared", G_CALLBACK (size_prepared), &info);
+
+  /* feed the file into the loader */
+  if (!_blxo_pixbuf_feed (loader, filename, fd, statb.st_size, cancellable, error))
+    {
+      /* close the loader and the file */
+      gdk_pixbuf_loader_close (loader, NULL);
+      close (fd);
+      goto err3;
+    }
 
   /* close the file */
   close (fd);
@@ -911,5 +1749,368 @@ err3: /* we failed for some reason */
 
 
 
+/**
+ * blxo_gdk_pixbuf_new_from_file_at_max_size:
+ * @filename              : name of the file to load, in the GLib file
+ *                          name encoding.
+ * @max_width             : the maximum width of the loaded image.
+ * @max_height            : the maximum height of the loaded image.
+ * @preserve_aspect_ratio : %TRUE to preserve the image's aspect ratio
+ *                          while scaling to fit into @max_width and @max_height.
+ * @error                 : return location for errors or %NULL.
+ *
+ * Creates a new #GdkPixbuf by loading an image from the file at
+ * @filename. The file format is detected automatically. If %NULL is
+ * returned, then @error will be set. Possible errors are in the
+ * #GDK_PIXBUF_ERROR and #G_FILE_ERROR domains. If the image dimensions
+ * exceed @max_width or @max_height, the image will be scaled down to
+ * fit into the dimensions, optionally preservingthe image's aspect
+ * ratio. The image may still be larger, depending on the loader.
+ *
+ * The advantage of using this function over
+ * gdk_pixbuf_new_from_file_at_scale() is that images will never be
+ * scaled up, whichwould otherwise result in ugly images.
+ *
+ * Camera images and RAW files usually embed JPEG previews. If one of
+ * them is large enough for @max_width and @max_height, it is decoded
+ * instead of the image itself, with the image's orientation in the
+ * "orientation" option. Set BLXO_EMBEDDED_PREVIEWS=0 in the environment
+ * to always decode the image itself.
+ *
+ * Returns: a newly created #GdkPixbuf with a reference count or 1, or
+ *          %NULL if any of several error conditions occurred: the file
+ *          could not be opened, there was no loader for the file's format,
+ *          there was not enough memory to allocate the buffer for the
+ *          image, or the image file contained invalid data.
+ *
+ * Since: 0.3.1.9
+ **/
+GdkPixbuf*
+blxo_gdk_pixbuf_new_from_file_at_max_size (const gchar *filename,
+                                          gint         max_width,
+                                          gint         max_height,
+                                          gboolean     preserve_aspect_ratio,
+                                          GError     **error)
+{
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+  g_return_val_if_fail (filename != NULL, NULL);
+  g_return_val_if_fail (max_height > 0, NULL);
+  g_return_val_if_fail (max_width > 0, NULL);
+
+  return blxo_gdk_pixbuf_load_at_max_size (filename, max_width, max_height, preserve_aspect_ratio, TRUE, NULL, error);
+}
+
+
+
+/**
+ * _blxo_gdk_pixbuf_new_from_file_at_max_size_full:
+ * @filename              : name of the file to load, in the GLib file
+ *                          name encoding.
+ * @max_width             : the maximum width of the loaded image.
+ * @max_height            : the maximum height of the loaded image.
+ * @preserve_aspect_ratio : %TRUE to preserve the image's aspect ratio.
+ * @use_previews          : %FALSE to always decode the image itself.
+ * @error                 : return location for errors or %NULL.
+ *
+ * Like blxo_gdk_pixbuf_new_from_file_at_max_size(), but lets the caller
+ * decide whether embedded previews may be decoded instead of the image.
+ * BLXO_EMBEDDED_PREVIEWS=0 in the environment still disables them.
+ *
+ * Returns: a newly created #GdkPixbuf or %NULL.
+ **/
+GdkPixbuf*
+_blxo_gdk_pixbuf_new_from_file_at_max_size_full (const gchar *filename,
+                                                 gint         max_width,
+                                                 gint         max_height,
+                                                 gboolean     preserve_aspect_ratio,
+                                                 gboolean     use_previews,
+                                                 GError     **error)
+{
+  _blxo_return_val_if_fail (error == NULL || *error == NULL, NULL);
+  _blxo_return_val_if_fail (filename != NULL, NULL);
+  _blxo_return_val_if_fail (max_height > 0, NULL);
+  _blxo_return_val_if_fail (max_width > 0, NULL);
+
+  return blxo_gdk_pixbuf_load_at_max_size (filename, max_width, max_height, preserve_aspect_ratio, use_previews, NULL, error);
+}
+
+
+
+typedef struct
+{
+  gchar   *filename;
+  gint     max_width;
+  gint     max_height;
+  gboolean preserve_aspect_ratio;
+  gint     io_priority;
+  guint    sequence;
+} BlxoGdkPixbufLoadData;
+
+
+
+static void
+blxo_gdk_pixbuf_load_data_free (gpointer data)
+{
+  BlxoGdkPixbufLoadData *load_data = data;
+
+  g_free (load_data->filename);
+  g_slice_free (BlxoGdkPixbufLoadData, load_data);
+}
+
+
+
+static void
+blxo_gdk_pixbuf_load_worker (gpointer data,
+                             gpointer user_data)
+{
+  BlxoGdkPixbufLoadData *load_data;
+  GdkPixbuf             *pixbuf;
+  GError                *error = NULL;
+  GTask                 *task = G_TASK (data);
+
+  /* don't even open the file if the image is no longer needed */
+  if (!g_task_return_error_if_cancelled (task))
+    {
+      load_data = g_task_get_task_data (task);
+      pixbuf = blxo_gdk_pixbuf_load_at_max_size (load_data->filename, load_data->max_width, load_data->max_height,
+                                                 load_data->preserve_aspect_ratio, TRUE, g_task_get_cancellable (task), &error);
+      if (G_LIKELY (pixbuf != NULL))
+        g_task_return_pointer (task, pixbuf, g_object_unref);
+      else
+        g_task_return_error (task, error);
+    }
+
+  g_object_unref (G_OBJECT (task));
+}
+
+
+
+static gint
+blxo_gdk_pixbuf_load_compare (gconstpointer a,
+                              gconstpointer b,
+                              gpointer      user_data)
+{
+  const BlxoGdkPixbufLoadData *data_a = g_task_get_task_data (G_TASK (a));
+  const BlxoGdkPixbufLoadData *data_b = g_task_get_task_data (G_TASK (b));
+
+  /* lower values come first, the order of requests otherwise */
+  if (data_a->io_priority != data_b->io_priority)
+    return (data_a->io_priority < data_b->io_priority) ? -1 : 1;
+  return (gint) (data_a->sequence - data_b->sequence);
+}
+
+
+
+/**
+ * blxo_gdk_pixbuf_new_from_file_at_max_size_async:
+ * @filename              : name of the file to load, in the GLib file
+ *                          name encoding.
+ * @max_width             : the maximum width of the loaded image.
+ * @max_height            : the maximum height of the loaded image.
+ * @preserve_aspect_ratio : %TRUE to preserve the image's aspect ratio
+ *                          while scaling to fit into @max_width and @max_height.
+ * @io_priority           : the I/O priority of the request, lower values
+ *                          are loaded first, e.g. %G_PRIORITY_DEFAULT for
+ *                          visible images and %G_PRIORITY_LOW for others.
+ * @cancellable           : optional #GCancellable object, %NULL to ignore.
+ * @callback              : a #GAsyncReadyCallback to call when the image is loaded.
+ * @user_data             : the data to pass to @callback.
+ *
+ * Asynchronously loads the image at @filename, like
+ * blxo_gdk_pixbuf_new_from_file_at_max_size() does, on a pool of
+ * worker threads. Pending requests are processed in the order of
+ * their @io_priority.
+ *
+ * The file is read in chunks, and loading stops as soon as
+ * @cancellable is cancelled, in which case the request fails
+ * with %G_IO_ERROR_CANCELLED.
+ *
+ * When the operation is finished, @callback will be called in the
+ * thread-default main context of the thread you called this function
+ * from. You can then call blxo_gdk_pixbuf_new_from_file_at_max_size_finish()
+ * to get the result of the operation.
+ *
+ * Since: 0.13.0
+ **/
+void
+blxo_gdk_pixbuf_new_from_file_at_max_size_async (const gchar         *filename,
+                                                gint                 max_width,
+                                                gint                 max_height,
+                                                gboolean             preserve_aspect_ratio,
+                                                gint                 io_priority,
+                                                GCancellable        *cancellable,
+                                                GAsyncReadyCallback  callback,
+                                                gpointer             user_data)
+{
+  static GThreadPool    *pool = NULL;
+  static gsize           pool_initialized = 0;
+  static gint            sequence = 0;
+  BlxoGdkPixbufLoadData *load_data;
+  GTask                 *task;
+
+  g_return_if_fail (filename != NULL);
+  g_return_if_fail (max_height > 0);
+  g_return_if_fail (max_width > 0);
+  g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+  if (g_once_init_enter (&pool_initialized))
+    {
+      pool = g_thread_pool_new (blxo_gdk_pixbuf_load_worker, NULL, g_get_num_processors (), FALSE, NULL);
+      g_thread_pool_set_sort_function (pool, blxo_gdk_pixbuf_load_compare, NULL);
+      g_once_init_leave (&pool_initialized, 1);
+    }
+
+  load_data = g_slice_new (BlxoGdkPixbufLoadData);
+  load_data->filename = g_strdup (filename);
+  load_data->max_width = max_width;
+  load_data->max_height = max_height;
+  load_data->preserve_aspect_ratio = preserve_aspect_ratio;
+  load_data->io_priority = io_priority;
+  load_data->sequence = g_atomic_int_add (&sequence, 1);
+
+  task = g_task_new (NULL, cancellable, callback, user_data);
+  g_task_set_source_tag (task, blxo_gdk_pixbuf_new_from_file_at_max_size_async);
+  g_task_set_priority (task, io_priority);
+  g_task_set_task_data (task, load_data, blxo_gdk_pixbuf_load_data_free);
+
+  /* the worker releases the task */
+  g_thread_pool_push (pool, task, NULL);
+}
+
+
+
+/**
+ * blxo_gdk_pixbuf_new_from_file_at_max_size_finish:
+ * @result : the #GAsyncResult passed to the callback.
+ * @error  : return location for errors or %NULL.
+ *
+ * Finishes an operation started with
+ * blxo_gdk_pixbuf_new_from_file_at_max_size_async().
+ *
+ * The caller is responsible to free the returned object
+ * using g_object_unref() when no longer needed.
+ *
+ * Returns: the loaded #GdkPixbuf or %NULL on error, in which
+ *          case @error will be set.
+ *
+ * Since: 0.13.0
+ **/
+GdkPixbuf*
+blxo_gdk_pixbuf_new_from_file_at_max_size_finish (GAsyncResult *result,
+                                                 GError      **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, NULL), NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  return g_task_propagate_pointer (G_TASK (result), error);
+}
+
+
+
+static void
+blxo_gdk_pixbuf_buffer_free (BlxoGdkPixbufBuffer *buffer)
+{
+  g_free (buffer->pixels);
+  g_slice_free (BlxoGdkPixbufBuffer, buffer);
+}
+
+
+
+static void
+blxo_gdk_pixbuf_buffer_release (guchar  *pixels,
+                               gpointer user_data)
+{
+  BlxoGdkPixbufBuffer *buffer = user_data;
+  GSList             *evicted = NULL;
+  gsize               n_bytes;
+
+  n_bytes = (gsize) buffer->rowstride * buffer->height;
+  if (G_UNLIKELY (n_bytes > BLXO_GDK_PIXBUF_POOL_MAX_BYTES))
+    {
+      blxo_gdk_pixbuf_buffer_free (buffer);
+      return;
+    }
+
+  /* the last reference may be dropped on any thread */
+  G_LOCK (pixbuf_pool);
+  g_queue_push_head (&pixbuf_pool, buffer);
+  pixbuf_pool_n_bytes += n_bytes;
+
+  /* drop the oldest buffers, whose size is least likely to be needed again */
+  while (pixbuf_pool.length > BLXO_GDK_PIXBUF_POOL_MAX_BUFFERS || pixbuf_pool_n_bytes > BLXO_GDK_PIXBUF_POOL_MAX_BYTES)
+    {
+      buffer = g_queue_pop_tail (&pixbuf_pool);
+      pixbuf_pool_n_bytes -= (gsize) buffer->rowstride * buffer->height;
+      evicted = g_slist_prepend (evicted, buffer);
+    }
+  G_UNLOCK (pixbuf_pool);
+
+  g_slist_free_full (evicted, (GDestroyNotify) blxo_gdk_pixbuf_buffer_free);
+}
+
+
+
+/**
+ * _blxo_gdk_pixbuf_new_recycled:
+ * @has_alpha : whether the pixbuf has an alpha channel.
+ * @width     : the width of the pixbuf.
+ * @height    : the height of the pixbuf.
+ *
+ * Like gdk_pixbuf_new() for 8 bit RGB pixbufs, but the pixel data is
+ * taken from a small pool of buffers, to which it is returned once the
+ * pixbuf is finalized. The pool is limited in number and total size of
+ * the buffers, and evicts the least recently released buffers first. This avoids allocating and clearing the pixels of
+ * short-living pixbufs with the same dimensions over and over again.
+ *
+ * The contents of the returned pixbuf are undefined.
+ *
+ * The caller is responsible to free the returned object
+ * using g_object_unref() when no longer needed.
+ *
+ * Returns: the newly allocated #GdkPixbuf.
+ **/
+GdkPixbuf*
+_blxo_gdk_pixbuf_new_recycled (gboolean has_alpha,
+                              gint     width,
+                              gint     height)
+{
+  BlxoGdkPixbufBuffer *buffer = NULL;
+  GList              *lp;
+  gint                rowstride;
+
+  _blxo_return_val_if_fail (width > 0 && height > 0, NULL);
+
+  /* rows are aligned to 4 bytes, like gdk_pixbuf_new() does */
+  rowstride = ((has_alpha ? 4 : 3) * width + 3) & ~3;
+
+  /* look for a released buffer of the same size */
+  G_LOCK (pixbuf_pool);
+  for (lp = pixbuf_pool.head; lp != NULL; lp = lp->next)
+    {
+      buffer = lp->data;
+      if (buffer->rowstride == rowstride && buffer->height == height)
+        {
+          g_queue_delete_link (&pixbuf_pool, lp);
+          pixbuf_pool_n_bytes -= (gsize) rowstride * height;
+          break;
+        }
+      buffer = NULL;
+    }
+  G_UNLOCK (pixbuf_pool);
+
+  if (G_UNLIKELY (buffer == NULL))
+    {
+      buffer = g_slice_new (BlxoGdkPixbufBuffer);
+      buffer->rowstride = rowstride;
+      buffer->height = height;
+      buffer->pixels = g_malloc ((gsize) rowstride * height);
+    }
+
+  return gdk_pixbuf_new_from_data (buffer->pixels, GDK_COLORSPACE_RGB, has_alpha, 8, width, height,
+                                   rowstride, blxo_gdk_pixbuf_buffer_release, buffer);
+}
+
+
+
 #define __BLXO_GDK_PIXBUF_EXTENSIONS_C__
 #include <blxo/blxo-aliasdef.c>
@@ -29,11 +29,55 @@
 #include <blxo/blxo-config.h>
 
 #include <gdk/gdk.h>
+#include <gio/gio.h>
 
 G_BEGIN_DECLS
 
+typedef struct _BlxoGdkPixbufEffects BlxoGdkPixbufEffects;
+typedef struct _BlxoPixbufFrame      BlxoPixbufFrame;
+
+/**
+ * BlxoPixbufFrame:
+ *
+ * An opaque, reference counted frame, that embeds images in a frame
+ * image, see blxo_pixbuf_frame_new().
+ *
+ * Since: 0.13.0
+ **/
+#define BLXO_TYPE_PIXBUF_FRAME (blxo_pixbuf_frame_get_type ())
+
+/**
+ * BlxoGdkPixbufEffects:
+ * @max_width      : the maximum width of the result, or 0 to not scale.
+ * @max_height     : the maximum height of the result, or 0 to not scale.
+ * @tint           : the color to colorize to, or %NULL.
+ * @lighten        : %TRUE to lighten the image for the prelit state.
+ * @lucent         : %TRUE to make the image translucent.
+ * @lucent_percent : the percentage of translucency if @lucent is %TRUE.
+ *
+ * Describes the effects applied by blxo_gdk_pixbuf_apply_effects(). The
+ * image is scaled down to fit @max_width and @max_height, preserving its
+ * aspect ratio, then colorized, lightened and made translucent.
+ *
+ * Since: 0.13.0
+ **/
+struct _BlxoGdkPixbufEffects
+{
+  gint            max_width;
+  gint            max_height;
+  const GdkColor *tint;
+  gboolean        lighten;
+  gboolean        lucent;
+  guint           lucent_percent;
+};
+
 GdkPixbuf *blxo_gdk_pixbuf_colorize                  (const GdkPixbuf *source,
                                                      const GdkColor  *color) G_GNUC_MALLOC G_GNUC_WARN_UNUSED_RESULT;
+void       blxo_gdk_pixbuf_colorize_into             (const GdkPixbuf *source,
+                                                     const GdkColor  *color,
+                                                     GdkPixbuf       *dest);
+void       blxo_gdk_pixbuf_colorize_inplace          (GdkPixbuf       *pixbuf,
+                                                     const GdkColor  *color);
 
 GdkPixbuf *blxo_gdk_pixbuf_frame                     (const GdkPixbuf *source,
                                                      const GdkPixbuf *frame,
@@ -42,16 +86,45 @@ GdkPixbuf *blxo_gdk_pixbuf_frame                     (const GdkPixbuf *source,
                                                      gint             right_offset,
                                                      gint             bottom_offset) G_GNUC_MALLOC G_GNUC_WARN_UNUSED_RESULT;
 
+GType            blxo_pixbuf_frame_get_type         (void) G_GNUC_CONST;
+BlxoPixbufFrame *blxo_pixbuf_frame_new              (const GdkPixbuf *image,
+                                                     gint             left_offset,
+                                                     gint             top_offset,
+                                                     gint             right_offset,
+                                                     gint             bottom_offset) G_GNUC_MALLOC G_GNUC_WARN_UNUSED_RESULT;
+BlxoPixbufFrame *blxo_pixbuf_frame_ref              (BlxoPixbufFrame *frame);
+void             blxo_pixbuf_frame_unref            (BlxoPixbufFrame *frame);
+GdkPixbuf       *blxo_pixbuf_frame_apply            (BlxoPixbufFrame *frame,
+                                                     const GdkPixbuf *source) G_GNUC_MALLOC G_GNUC_WARN_UNUSED_RESULT;
+void             blxo_pixbuf_frame_paint            (BlxoPixbufFrame *frame,
+                                                     cairo_t         *cr,
+                                                     const GdkPixbuf *source,
+                                                     gdouble          x,
+                                                     gdouble          y);
+cairo_surface_t *blxo_pixbuf_frame_create_surface   (BlxoPixbufFrame *frame,
+                                                     cairo_surface_t *source) G_GNUC_MALLOC G_GNUC_WARN_UNUSED_RESULT;
+
 GdkPixbuf *blxo_gdk_pixbuf_lucent                    (const GdkPixbuf *source,
                                                      guint            percent) G_GNUC_MALLOC G_GNUC_WARN_UNUSED_RESULT;
+void       blxo_gdk_pixbuf_lucent_into               (const GdkPixbuf *source,
+                                                     guint            percent,
+                                                     GdkPixbuf       *dest);
+void       blxo_gdk_pixbuf_lucent_inplace            (GdkPixbuf       *pixbuf,
+                                                     guint            percent);
 
 GdkPixbuf *blxo_gdk_pixbuf_spotlight                 (const GdkPixbuf *source) G_GNUC_MALLOC G_GNUC_WARN_UNUSED_RESULT;
+void       blxo_gdk_pixbuf_spotlight_into            (const GdkPixbuf *source,
+                                                     GdkPixbuf       *dest);
+void       blxo_gdk_pixbuf_spotlight_inplace         (GdkPixbuf       *pixbuf);
 
 GdkPixbuf *blxo_gdk_pixbuf_scale_down                (GdkPixbuf       *source,
                                                      gboolean         preserve_aspect_ratio,
                                                      gint             dest_width,
                                                      gint             dest_height) G_GNUC_WARN_UNUSED_RESULT;
 
+GdkPixbuf *blxo_gdk_pixbuf_apply_effects             (const GdkPixbuf            *source,
+                                                     const BlxoGdkPixbufEffects *effects) G_GNUC_WARN_UNUSED_RESULT;
+
 GdkPixbuf *blxo_gdk_pixbuf_scale_ratio               (GdkPixbuf       *source,
                                                      gint             dest_size) G_GNUC_WARN_UNUSED_RESULT;
 
@@ -60,6 +133,28 @@ GdkPixbuf *blxo_gdk_pixbuf_new_from_file_at_max_size (const gchar     *filename,
                                                      gint             max_height,
                                                      gboolean         preserve_aspect_ratio,
                                                      GError         **error) G_GNUC_MALLOC G_GNUC_WARN_UNUSED_RESULT;
+void       blxo_gdk_pixbuf_new_from_file_at_max_size_async  (const gchar         *filename,
+                                                            gint                 max_width,
+                                                            gint                 max_height,
+                                                            gboolean             preserve_aspect_ratio,
+                                                            gint                 io_priority,
+                                                            GCancellable        *cancellable,
+                                                            GAsyncReadyCallback  callback,
+                                                            gpointer             user_data);
+GdkPixbuf *blxo_gdk_pixbuf_new_from_file_at_max_size_finish (GAsyncResult        *result,
+                                                            GError             **error) G_GNUC_MALLOC G_GNUC_WARN_UNUSED_RESULT;
+
+cairo_surface_t *blxo_gdk_pixbuf_create_surface  (const GdkPixbuf *pixbuf) G_GNUC_MALLOC G_GNUC_WARN_UNUSED_RESULT;
+
+cairo_surface_t *blxo_cairo_surface_scale_down   (cairo_surface_t *source,
+                                                  gboolean         preserve_aspect_ratio,
+                                                  gint             dest_width,
+                                                  gint             dest_height) G_GNUC_WARN_UNUSED_RESULT;
+void             blxo_cairo_surface_colorize     (cairo_surface_t *surface,
+                                                  const GdkColor  *color);
+void             blxo_cairo_surface_spotlight    (cairo_surface_t *surface);
+void             blxo_cairo_surface_lucent       (cairo_surface_t *surface,
+                                                  guint            percent);
 
 G_END_DECLS
 
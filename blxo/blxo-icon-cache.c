@@ -0,0 +1,1191 @@
+/*-
+ * Copyright (c) 2026 Xfce Development Team <xfce4-dev@xfce.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include <gio/gio.h>
+
+#include <blxo/blxo-cache-monitor.h>
+#include <blxo/blxo-icon-cache.h>
+#include <blxo/blxo-private.h>
+#include <blxo/blxo-thumbnail.h>
+#include <blxo/blxo-alias.h>
+
+/* The icon cache keeps the images loaded by the BlxoCellRendererIcon around,
+ * so repeated paints of the same icon become a hash table lookup. All cache
+ * state is owned by the main thread; the worker threads only load pixbufs
+ * for queued requests and hand them back to the main loop, where they are
+ * inserted into the cache and the waiting cells are redrawn. Images that
+ * are likely to be painted soon can be prefetched by the same workers, so
+ * expensive images, like SVG icons, are rasterized on all cores. The image
+ * files are watched by the cache monitor, which evicts the entries of files
+ * that change; results of requests for files that changed while they were
+ * loaded are not cached.
+ */
+
+/* the maximum number of bytes of pixel data kept in the cache */
+#define BLXO_ICON_CACHE_MAX_BYTES (32u * 1024u * 1024u)
+
+/* the maximum number of derived versions kept per image */
+#define BLXO_ICON_CACHE_MAX_VARIANTS (8)
+
+/* the maximum number of queued prefetch requests */
+#define BLXO_ICON_CACHE_MAX_PREFETCHES (256)
+
+/* interval in which scrolled widgets are checked for requests that went out of view */
+#define BLXO_ICON_CACHE_SWEEP_INTERVAL (100)
+
+
+
+typedef struct _BlxoIconCacheKey     BlxoIconCacheKey;
+typedef struct _BlxoIconCacheEntry   BlxoIconCacheEntry;
+typedef struct _BlxoIconCacheDerived BlxoIconCacheDerived;
+typedef struct _BlxoIconCacheRequest BlxoIconCacheRequest;
+typedef struct _BlxoIconCacheWaiter  BlxoIconCacheWaiter;
+typedef struct _BlxoIconCacheTracker BlxoIconCacheTracker;
+
+
+
+static guint    blxo_icon_cache_key_hash     (gconstpointer         data);
+static gboolean blxo_icon_cache_key_equal    (gconstpointer         a,
+                                             gconstpointer         b);
+static void     blxo_icon_cache_entry_free   (gpointer              data);
+static void     blxo_icon_cache_request_free (BlxoIconCacheRequest *request);
+static void     blxo_icon_cache_worker       (gpointer              data,
+                                             gpointer              user_data);
+
+
+
+struct _BlxoIconCacheKey
+{
+  gchar *filename;
+  gint   size;
+};
+
+struct _BlxoIconCacheEntry
+{
+  BlxoIconCacheKey key;
+  GdkPixbuf      *pixbuf;
+  cairo_surface_t *surface;
+  gint            surface_scale;
+  GSList         *variants;
+  gsize           n_bytes;
+  GList           lru_link;
+};
+
+struct _BlxoIconCacheDerived
+{
+  BlxoIconCacheVariant variant;
+  GdkPixbuf          *pixbuf;
+  cairo_surface_t    *surface;
+  gint                surface_scale;
+};
+
+enum
+{
+  REQUEST_QUEUED,
+  REQUEST_RUNNING,
+  REQUEST_TAKEN,
+};
+
+struct _BlxoIconCacheRequest
+{
+  BlxoIconCacheKey key;
+  GCancellable   *cancellable;
+  GSList         *waiters;
+  gboolean        prefetch;
+
+  /* the size at scale 1, loaded along the key size on HiDPI displays */
+  BlxoThumbnailSize base_size;
+
+  /* the cache monitor stamp taken when the request was queued */
+  guint           stamp;
+
+  /* REQUEST_QUEUED until claimed by a worker or the main thread */
+  volatile gint   state;
+
+  /* set by the worker thread */
+  GdkPixbuf      *pixbuf;
+  GdkPixbuf      *base_pixbuf;
+  GError         *error;
+};
+
+struct _BlxoIconCacheWaiter
+{
+  GtkWidget   *widget;
+#if !GTK_CHECK_VERSION (3, 0, 0)
+  GdkWindow   *window;
+#endif
+  GdkRectangle area;
+  guint        serial;
+};
+
+struct _BlxoIconCacheTracker
+{
+  GtkWidget *widget;
+  guint      serial;
+  guint      painted_serial;
+  guint      sweep_id;
+};
+
+
+
+static GHashTable  *cache_entries = NULL;
+static GQueue       cache_lru = G_QUEUE_INIT;
+static gsize        cache_n_bytes = 0;
+static GHashTable  *cache_requests = NULL;
+static GThreadPool *cache_pool = NULL;
+static guint        cache_n_prefetches = 0;
+static GQuark       cache_tracker_quark = 0;
+
+
+
+static guint
+blxo_icon_cache_key_hash (gconstpointer data)
+{
+  const BlxoIconCacheKey *key = data;
+
+  return g_str_hash (key->filename) ^ (guint) key->size;
+}
+
+
+
+static gboolean
+blxo_icon_cache_key_equal (gconstpointer a,
+                          gconstpointer b)
+{
+  const BlxoIconCacheKey *key_a = a;
+  const BlxoIconCacheKey *key_b = b;
+
+  return (key_a->size == key_b->size && strcmp (key_a->filename, key_b->filename) == 0);
+}
+
+
+
+static inline gsize
+blxo_icon_cache_pixbuf_size (const GdkPixbuf *pixbuf)
+{
+  return (gsize) gdk_pixbuf_get_rowstride (pixbuf) * gdk_pixbuf_get_height (pixbuf);
+}
+
+
+
+static inline gsize
+blxo_icon_cache_surface_size (const GdkPixbuf *pixbuf)
+{
+  /* the surface holds 32 bits per pixel, whether it lives in client or server memory */
+  return (gsize) gdk_pixbuf_get_width (pixbuf) * gdk_pixbuf_get_height (pixbuf) * 4;
+}
+
+
+
+static inline gsize
+blxo_icon_cache_derived_size (const BlxoIconCacheDerived *derived)
+{
+  gsize n_bytes;
+
+  n_bytes = blxo_icon_cache_pixbuf_size (derived->pixbuf);
+  if (derived->surface != NULL)
+    n_bytes += blxo_icon_cache_surface_size (derived->pixbuf);
+
+  return n_bytes;
+}
+
+
+
+static void
+blxo_icon_cache_derived_free (BlxoIconCacheDerived *derived)
+{
+  if (derived->surface != NULL)
+    cairo_surface_destroy (derived->surface);
+  g_object_unref (G_OBJECT (derived->pixbuf));
+  g_slice_free (BlxoIconCacheDerived, derived);
+}
+
+
+
+static void
+blxo_icon_cache_entry_free (gpointer data)
+{
+  BlxoIconCacheEntry *entry = data;
+
+  /* drop the entry from the LRU list */
+  g_queue_unlink (&cache_lru, &entry->lru_link);
+  cache_n_bytes -= entry->n_bytes;
+
+  g_slist_free_full (entry->variants, (GDestroyNotify) blxo_icon_cache_derived_free);
+  if (entry->surface != NULL)
+    cairo_surface_destroy (entry->surface);
+  if (G_LIKELY (entry->pixbuf != NULL))
+    g_object_unref (G_OBJECT (entry->pixbuf));
+  _blxo_cache_monitor_unwatch (entry->key.filename);
+  g_free (entry->key.filename);
+  g_slice_free (BlxoIconCacheEntry, entry);
+}
+
+
+
+static void
+blxo_icon_cache_invalidate (GHashTable *filenames)
+{
+  BlxoIconCacheEntry *entry;
+  GHashTableIter      iter;
+
+  /* drop the images of the files that changed, with all their variants */
+  g_hash_table_iter_init (&iter, cache_entries);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &entry))
+    if (g_hash_table_contains (filenames, entry->key.filename))
+      g_hash_table_iter_remove (&iter);
+}
+
+
+
+static void
+blxo_icon_cache_waiter_free (BlxoIconCacheWaiter *waiter)
+{
+  if (G_LIKELY (waiter->widget != NULL))
+    g_object_remove_weak_pointer (G_OBJECT (waiter->widget), (gpointer) &waiter->widget);
+#if !GTK_CHECK_VERSION (3, 0, 0)
+  if (G_LIKELY (waiter->window != NULL))
+    g_object_remove_weak_pointer (G_OBJECT (waiter->window), (gpointer) &waiter->window);
+#endif
+  g_slice_free (BlxoIconCacheWaiter, waiter);
+}
+
+
+
+static void
+blxo_icon_cache_request_free (BlxoIconCacheRequest *request)
+{
+  g_slist_free_full (request->waiters, (GDestroyNotify) blxo_icon_cache_waiter_free);
+
+  if (G_UNLIKELY (request->error != NULL))
+    g_error_free (request->error);
+  if (G_LIKELY (request->pixbuf != NULL))
+    g_object_unref (G_OBJECT (request->pixbuf));
+  if (request->base_pixbuf != NULL)
+    g_object_unref (G_OBJECT (request->base_pixbuf));
+  g_object_unref (G_OBJECT (request->cancellable));
+  _blxo_cache_monitor_unwatch (request->key.filename);
+  g_free (request->key.filename);
+  g_slice_free (BlxoIconCacheRequest, request);
+}
+
+
+
+static void
+blxo_icon_cache_trim (void)
+{
+  BlxoIconCacheEntry *entry;
+
+  /* drop least recently used entries until we are below the budget */
+  while (cache_n_bytes > BLXO_ICON_CACHE_MAX_BYTES && cache_lru.tail != NULL)
+    {
+      entry = cache_lru.tail->data;
+      g_hash_table_remove (cache_entries, &entry->key);
+    }
+}
+
+
+
+static gboolean
+blxo_icon_cache_has_image (const BlxoIconCacheKey *key)
+{
+  BlxoIconCacheEntry *entry;
+
+  if (G_UNLIKELY (cache_entries == NULL))
+    return FALSE;
+
+  entry = g_hash_table_lookup (cache_entries, key);
+  return (entry != NULL && entry->pixbuf != NULL);
+}
+
+
+
+static GdkPixbuf*
+blxo_icon_cache_load_thumbnails (const gchar      *filename,
+                                BlxoThumbnailSize  size,
+                                BlxoThumbnailSize  base_size,
+                                GdkPixbuf        **base_pixbuf_return,
+                                GError           **error)
+{
+  BlxoThumbnailSize sizes[2];
+  GdkPixbuf       *thumbnails[2];
+  GError          *err = NULL;
+
+  *base_pixbuf_return = NULL;
+
+  if (G_LIKELY (base_size == size))
+    return _blxo_thumbnail_get_for_file (filename, size, error);
+
+  /* HiDPI views need the image at scale 1 as well, for example when the
+   * window is moved to another monitor, so decode the file once for both */
+  sizes[0] = size;
+  sizes[1] = base_size;
+  _blxo_thumbnail_get_for_file_at_sizes (filename, sizes, 2, thumbnails, &err);
+
+  /* only failures of the requested size are reported */
+  if (G_LIKELY (thumbnails[0] != NULL))
+    g_clear_error (&err);
+  else if (err != NULL)
+    g_propagate_error (error, err);
+
+  *base_pixbuf_return = thumbnails[1];
+
+  return thumbnails[0];
+}
+
+
+
+static gboolean
+blxo_icon_cache_request_finished (gpointer user_data)
+{
+  BlxoIconCacheRequest *request = user_data;
+  BlxoIconCacheWaiter  *waiter;
+  BlxoIconCacheKey      key;
+  GSList               *lp;
+
+  /* the request is done, unless it was cancelled and replaced by a new request */
+  if (g_hash_table_lookup (cache_requests, &request->key) == request)
+    g_hash_table_steal (cache_requests, &request->key);
+
+  if (request->prefetch)
+    cache_n_prefetches--;
+
+  /* remember the result, even for cancelled requests that we loaded anyway,
+   * unless the image was loaded on the main thread in the meantime, or the
+   * file changed while it was loaded, in which case the redraw loads it again */
+  if (request->state != REQUEST_TAKEN
+      && (request->pixbuf != NULL || !g_cancellable_is_cancelled (request->cancellable))
+      && !blxo_icon_cache_has_image (&request->key)
+      && !_blxo_cache_monitor_has_changed (request->key.filename, request->stamp))
+    {
+      if (G_UNLIKELY (request->pixbuf == NULL && request->error != NULL))
+        g_warning ("Failed to load \"%s\": %s", request->key.filename, request->error->message);
+
+      _blxo_icon_cache_insert (request->key.filename, request->key.size, request->pixbuf);
+    }
+
+  /* remember the image at scale 1 under the same conditions */
+  if (request->base_pixbuf != NULL && request->state != REQUEST_TAKEN
+      && !_blxo_cache_monitor_has_changed (request->key.filename, request->stamp))
+    {
+      key.filename = request->key.filename;
+      key.size = request->base_size;
+      if (!blxo_icon_cache_has_image (&key))
+        _blxo_icon_cache_insert (request->key.filename, request->base_size, request->base_pixbuf);
+    }
+
+  /* redraw the cells that are waiting for the image */
+  if (!g_cancellable_is_cancelled (request->cancellable))
+    {
+      for (lp = request->waiters; lp != NULL; lp = lp->next)
+        {
+          waiter = lp->data;
+#if GTK_CHECK_VERSION (3, 0, 0)
+          /* the cell area is relative to the cairo context passed to the
+           * renderer, which is not necessarily the widget, so we redraw
+           * the widget and let gdk coalesce the invalidations */
+          if (G_LIKELY (waiter->widget != NULL))
+            gtk_widget_queue_draw (waiter->widget);
+#else
+          if (G_LIKELY (waiter->window != NULL))
+            gdk_window_invalidate_rect (waiter->window, &waiter->area, FALSE);
+#endif
+        }
+    }
+
+  blxo_icon_cache_request_free (request);
+
+  return FALSE;
+}
+
+
+
+static void
+blxo_icon_cache_worker (gpointer data,
+                       gpointer user_data)
+{
+  BlxoIconCacheRequest *request = data;
+
+  /* skip requests that went out of view while they were queued, or
+   * that were taken over by the main thread */
+  if (!g_cancellable_is_cancelled (request->cancellable)
+      && g_atomic_int_compare_and_exchange (&request->state, REQUEST_QUEUED, REQUEST_RUNNING))
+    {
+      request->pixbuf = blxo_icon_cache_load_thumbnails (request->key.filename, request->key.size,
+                                                         request->base_size, &request->base_pixbuf,
+                                                         &request->error);
+    }
+
+  /* hand the request back to the main loop */
+  g_idle_add_full (G_PRIORITY_HIGH_IDLE, blxo_icon_cache_request_finished, request, NULL);
+}
+
+
+
+static gint
+blxo_icon_cache_request_compare (gconstpointer a,
+                                gconstpointer b,
+                                gpointer      user_data)
+{
+  const BlxoIconCacheRequest *request_a = a;
+  const BlxoIconCacheRequest *request_b = b;
+
+  /* load images for visible cells before prefetched images */
+  return request_a->prefetch - request_b->prefetch;
+}
+
+
+
+static void
+blxo_icon_cache_requests_init (void)
+{
+  if (G_LIKELY (cache_requests != NULL))
+    return;
+
+  cache_requests = g_hash_table_new (blxo_icon_cache_key_hash, blxo_icon_cache_key_equal);
+  cache_pool = g_thread_pool_new (blxo_icon_cache_worker, NULL, g_get_num_processors (), FALSE, NULL);
+  g_thread_pool_set_sort_function (cache_pool, blxo_icon_cache_request_compare, NULL);
+}
+
+
+
+static void
+blxo_icon_cache_tracker_free (gpointer data)
+{
+  BlxoIconCacheTracker *tracker = data;
+
+  if (G_UNLIKELY (tracker->sweep_id != 0))
+    g_source_remove (tracker->sweep_id);
+  g_slice_free (BlxoIconCacheTracker, tracker);
+}
+
+
+
+static gboolean
+blxo_icon_cache_tracker_sweep (gpointer user_data)
+{
+  BlxoIconCacheTracker *tracker = user_data;
+  BlxoIconCacheRequest *request;
+  BlxoIconCacheWaiter  *waiter;
+  GHashTableIter        iter;
+  GSList               *lp, *lnext;
+
+  /* cells that were not painted again after the widget was
+   * scrolled and redrawn are no longer visible */
+  g_hash_table_iter_init (&iter, cache_requests);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &request))
+    {
+      for (lp = request->waiters; lp != NULL; lp = lnext)
+        {
+          lnext = lp->next;
+          waiter = lp->data;
+
+          if (waiter->widget == NULL
+              || (waiter->widget == tracker->widget && waiter->serial < tracker->painted_serial))
+            {
+              request->waiters = g_slist_delete_link (request->waiters, lp);
+              blxo_icon_cache_waiter_free (waiter);
+            }
+        }
+
+      /* nobody is interested in the image anymore */
+      if (request->waiters == NULL && !request->prefetch)
+        {
+          g_hash_table_iter_steal (&iter);
+          g_cancellable_cancel (request->cancellable);
+        }
+    }
+
+  /* check again if the widget was not redrawn since the last scroll */
+  if (tracker->painted_serial < tracker->serial)
+    return TRUE;
+
+  tracker->sweep_id = 0;
+  return FALSE;
+}
+
+
+
+static void
+blxo_icon_cache_tracker_scrolled (GtkWidget *widget)
+{
+  BlxoIconCacheTracker *tracker;
+
+  tracker = g_object_get_qdata (G_OBJECT (widget), cache_tracker_quark);
+  if (G_UNLIKELY (tracker == NULL))
+    return;
+
+  /* redraw the whole widget, so all cells that are still visible
+   * renew their requests, and sweep the others afterwards */
+  tracker->serial++;
+  gtk_widget_queue_draw (widget);
+
+  if (tracker->sweep_id == 0)
+    tracker->sweep_id = g_timeout_add (BLXO_ICON_CACHE_SWEEP_INTERVAL, blxo_icon_cache_tracker_sweep, tracker);
+}
+
+
+
+static BlxoIconCacheTracker*
+blxo_icon_cache_tracker_get (GtkWidget *widget)
+{
+  BlxoIconCacheTracker *tracker;
+  GtkWidget            *parent;
+
+  if (G_UNLIKELY (cache_tracker_quark == 0))
+    cache_tracker_quark = g_quark_from_static_string ("blxo-icon-cache-tracker");
+
+  tracker = g_object_get_qdata (G_OBJECT (widget), cache_tracker_quark);
+  if (G_UNLIKELY (tracker == NULL))
+    {
+      tracker = g_slice_new0 (BlxoIconCacheTracker);
+      tracker->widget = widget;
+      g_object_set_qdata_full (G_OBJECT (widget), cache_tracker_quark, tracker, blxo_icon_cache_tracker_free);
+
+      /* views are usually scrolled by their parent scrolled window */
+      parent = gtk_widget_get_parent (widget);
+      if (GTK_IS_SCROLLED_WINDOW (parent))
+        {
+          g_signal_connect_object (gtk_scrolled_window_get_hadjustment (GTK_SCROLLED_WINDOW (parent)), "value-changed",
+                                   G_CALLBACK (blxo_icon_cache_tracker_scrolled), widget, G_CONNECT_SWAPPED);
+          g_signal_connect_object (gtk_scrolled_window_get_vadjustment (GTK_SCROLLED_WINDOW (parent)), "value-changed",
+                                   G_CALLBACK (blxo_icon_cache_tracker_scrolled), widget, G_CONNECT_SWAPPED);
+        }
+
+      /* nothing is visible once the widget is unmapped */
+      g_signal_connect (G_OBJECT (widget), "unmap", G_CALLBACK (_blxo_icon_cache_cancel_for_widget), NULL);
+    }
+
+  return tracker;
+}
+
+
+
+static BlxoIconCacheEntry*
+blxo_icon_cache_find (const gchar *filename,
+                     gint         size)
+{
+  BlxoIconCacheEntry *entry;
+  BlxoIconCacheKey    key;
+
+  if (G_UNLIKELY (cache_entries == NULL))
+    return NULL;
+
+  key.filename = (gchar *) filename;
+  key.size = size;
+  entry = g_hash_table_lookup (cache_entries, &key);
+  if (G_LIKELY (entry != NULL))
+    {
+      /* move the entry to the head of the LRU list */
+      g_queue_unlink (&cache_lru, &entry->lru_link);
+      g_queue_push_head_link (&cache_lru, &entry->lru_link);
+    }
+
+  return entry;
+}
+
+
+
+static BlxoIconCacheDerived*
+blxo_icon_cache_find_derived (BlxoIconCacheEntry         *entry,
+                             const BlxoIconCacheVariant *variant)
+{
+  BlxoIconCacheDerived *derived;
+  GSList               *lp;
+
+  for (lp = entry->variants; lp != NULL; lp = lp->next)
+    {
+      derived = lp->data;
+      if (derived->variant.width == variant->width
+          && derived->variant.height == variant->height
+          && derived->variant.flags == variant->flags
+          && derived->variant.selected_color == variant->selected_color
+          && derived->variant.insensitive_color == variant->insensitive_color
+          && derived->variant.insensitive_bg == variant->insensitive_bg
+          && derived->variant.style_type == variant->style_type)
+        return derived;
+    }
+
+  return NULL;
+}
+
+
+
+/**
+ * _blxo_icon_cache_lookup:
+ * @filename : the absolute path to the image file.
+ * @size     : the size at which the image was loaded.
+ * @failed   : return location for the negative cache flag or %NULL.
+ *
+ * Looks up the image for @filename at @size in the icon cache. If the
+ * image is not cached, %NULL is returned and @failed is set to %TRUE
+ * if an earlier attempt to load the image failed.
+ *
+ * The caller is responsible to free the returned pixbuf using
+ * g_object_unref() when no longer needed.
+ *
+ * Returns: the cached #GdkPixbuf or %NULL.
+ **/
+GdkPixbuf*
+_blxo_icon_cache_lookup (const gchar *filename,
+                        gint         size,
+                        gboolean    *failed)
+{
+  BlxoIconCacheEntry *entry;
+
+  _blxo_return_val_if_fail (filename != NULL, NULL);
+
+  entry = blxo_icon_cache_find (filename, size);
+
+  if (failed != NULL)
+    *failed = (entry != NULL && entry->pixbuf == NULL);
+
+  if (G_UNLIKELY (entry == NULL || entry->pixbuf == NULL))
+    return NULL;
+
+  return g_object_ref (G_OBJECT (entry->pixbuf));
+}
+
+
+
+/**
+ * _blxo_icon_cache_insert:
+ * @filename : the absolute path to the image file.
+ * @size     : the size at which the image was loaded.
+ * @pixbuf   : the loaded #GdkPixbuf or %NULL if loading failed.
+ *
+ * Stores the @pixbuf for @filename at @size in the icon cache, replacing
+ * any previous entry. If @pixbuf is %NULL, the failure is remembered, so
+ * the image is not loaded again on every paint.
+ **/
+void
+_blxo_icon_cache_insert (const gchar *filename,
+                        gint         size,
+                        GdkPixbuf   *pixbuf)
+{
+  BlxoIconCacheEntry *entry;
+
+  _blxo_return_if_fail (filename != NULL);
+  _blxo_return_if_fail (pixbuf == NULL || GDK_IS_PIXBUF (pixbuf));
+
+  if (G_UNLIKELY (cache_entries == NULL))
+    {
+      cache_entries = g_hash_table_new_full (blxo_icon_cache_key_hash, blxo_icon_cache_key_equal, NULL, blxo_icon_cache_entry_free);
+      _blxo_cache_monitor_connect (blxo_icon_cache_invalidate);
+    }
+
+  /* the entry is evicted when the file changes */
+  _blxo_cache_monitor_watch (filename, NULL);
+
+  entry = g_slice_new0 (BlxoIconCacheEntry);
+  entry->key.filename = g_strdup (filename);
+  entry->key.size = size;
+  entry->lru_link.data = entry;
+
+  if (G_LIKELY (pixbuf != NULL))
+    {
+      entry->pixbuf = g_object_ref (G_OBJECT (pixbuf));
+      entry->n_bytes = blxo_icon_cache_pixbuf_size (pixbuf);
+    }
+
+  /* the hash table owns the entry, the key is part of the entry */
+  g_hash_table_replace (cache_entries, &entry->key, entry);
+  g_queue_push_head_link (&cache_lru, &entry->lru_link);
+  cache_n_bytes += entry->n_bytes;
+
+  blxo_icon_cache_trim ();
+}
+
+
+
+/**
+ * _blxo_icon_cache_lookup_variant:
+ * @filename : the absolute path to the image file.
+ * @size     : the size at which the image was loaded.
+ * @variant  : the #BlxoIconCacheVariant to look up.
+ *
+ * Looks up the version of the cached image for @filename at @size,
+ * that was derived for the cell state described by @variant.
+ *
+ * The caller is responsible to free the returned pixbuf using
+ * g_object_unref() when no longer needed.
+ *
+ * Returns: the cached #GdkPixbuf or %NULL.
+ **/
+GdkPixbuf*
+_blxo_icon_cache_lookup_variant (const gchar                *filename,
+                                gint                        size,
+                                const BlxoIconCacheVariant *variant)
+{
+  BlxoIconCacheDerived *derived;
+  BlxoIconCacheEntry   *entry;
+
+  _blxo_return_val_if_fail (filename != NULL, NULL);
+  _blxo_return_val_if_fail (variant != NULL, NULL);
+
+  entry = blxo_icon_cache_find (filename, size);
+  if (G_UNLIKELY (entry == NULL))
+    return NULL;
+
+  derived = blxo_icon_cache_find_derived (entry, variant);
+  if (G_UNLIKELY (derived == NULL))
+    return NULL;
+
+  return g_object_ref (G_OBJECT (derived->pixbuf));
+}
+
+
+
+/**
+ * _blxo_icon_cache_insert_variant:
+ * @filename : the absolute path to the image file.
+ * @size     : the size at which the image was loaded.
+ * @variant  : the #BlxoIconCacheVariant of @pixbuf.
+ * @pixbuf   : the derived #GdkPixbuf.
+ *
+ * Stores the @pixbuf derived from the cached image for @filename at
+ * @size alongside the image. If the image itself is not cached, the
+ * @pixbuf is not stored either.
+ **/
+void
+_blxo_icon_cache_insert_variant (const gchar                *filename,
+                                gint                        size,
+                                const BlxoIconCacheVariant *variant,
+                                GdkPixbuf                  *pixbuf)
+{
+  BlxoIconCacheDerived *derived;
+  BlxoIconCacheEntry   *entry;
+  GSList               *lp;
+  guint                 n;
+
+  _blxo_return_if_fail (filename != NULL);
+  _blxo_return_if_fail (variant != NULL);
+  _blxo_return_if_fail (GDK_IS_PIXBUF (pixbuf));
+
+  entry = blxo_icon_cache_find (filename, size);
+  if (G_UNLIKELY (entry == NULL || entry->pixbuf == NULL))
+    return;
+
+  derived = g_slice_new0 (BlxoIconCacheDerived);
+  derived->variant = *variant;
+  derived->pixbuf = g_object_ref (G_OBJECT (pixbuf));
+  entry->variants = g_slist_prepend (entry->variants, derived);
+  entry->n_bytes += blxo_icon_cache_pixbuf_size (pixbuf);
+  cache_n_bytes += blxo_icon_cache_pixbuf_size (pixbuf);
+
+  /* drop the oldest variants if there are too many */
+  for (lp = entry->variants, n = 1; lp->next != NULL; lp = lp->next, ++n)
+    if (n == BLXO_ICON_CACHE_MAX_VARIANTS)
+      {
+        derived = lp->next->data;
+        entry->n_bytes -= blxo_icon_cache_derived_size (derived);
+        cache_n_bytes -= blxo_icon_cache_derived_size (derived);
+        blxo_icon_cache_derived_free (derived);
+        lp->next = g_slist_delete_link (lp->next, lp->next);
+        break;
+      }
+
+  blxo_icon_cache_trim ();
+}
+
+
+
+/**
+ * _blxo_icon_cache_lookup_surface:
+ * @filename : the absolute path to the image file.
+ * @size     : the size at which the image was loaded.
+ * @variant  : the #BlxoIconCacheVariant or %NULL for the image itself.
+ * @scale    : the device scale of the surface.
+ *
+ * Looks up the ready-to-paint surface for the cached image for @filename
+ * at @size, or the version of it described by @variant.
+ *
+ * The caller is responsible to free the returned surface using
+ * cairo_surface_destroy() when no longer needed.
+ *
+ * Returns: the cached #cairo_surface_t or %NULL.
+ **/
+cairo_surface_t*
+_blxo_icon_cache_lookup_surface (const gchar                *filename,
+                                gint                        size,
+                                const BlxoIconCacheVariant *variant,
+                                gint                        scale)
+{
+  BlxoIconCacheDerived *derived;
+  BlxoIconCacheEntry   *entry;
+
+  _blxo_return_val_if_fail (filename != NULL, NULL);
+
+  entry = blxo_icon_cache_find (filename, size);
+  if (G_UNLIKELY (entry == NULL))
+    return NULL;
+
+  if (variant == NULL)
+    {
+      if (entry->surface != NULL && entry->surface_scale == scale)
+        return cairo_surface_reference (entry->surface);
+    }
+  else
+    {
+      derived = blxo_icon_cache_find_derived (entry, variant);
+      if (derived != NULL && derived->surface != NULL && derived->surface_scale == scale)
+        return cairo_surface_reference (derived->surface);
+    }
+
+  return NULL;
+}
+
+
+
+/**
+ * _blxo_icon_cache_insert_surface:
+ * @filename : the absolute path to the image file.
+ * @size     : the size at which the image was loaded.
+ * @variant  : the #BlxoIconCacheVariant or %NULL for the image itself.
+ * @scale    : the device scale of the @surface.
+ * @surface  : the #cairo_surface_t created from the cached pixbuf.
+ *
+ * Stores the @surface for the cached image for @filename at @size, or
+ * for the version of it described by @variant, replacing the surface
+ * for any other scale. If the image is not cached, the @surface is not
+ * stored either.
+ **/
+void
+_blxo_icon_cache_insert_surface (const gchar                *filename,
+                                gint                        size,
+                                const BlxoIconCacheVariant *variant,
+                                gint                        scale,
+                                cairo_surface_t            *surface)
+{
+  BlxoIconCacheDerived *derived;
+  BlxoIconCacheEntry   *entry;
+  cairo_surface_t     **surface_slot;
+  GdkPixbuf            *pixbuf;
+  gint                 *scale_slot;
+
+  _blxo_return_if_fail (filename != NULL);
+  _blxo_return_if_fail (surface != NULL);
+
+  entry = blxo_icon_cache_find (filename, size);
+  if (G_UNLIKELY (entry == NULL || entry->pixbuf == NULL))
+    return;
+
+  if (variant == NULL)
+    {
+      pixbuf = entry->pixbuf;
+      surface_slot = &entry->surface;
+      scale_slot = &entry->surface_scale;
+    }
+  else
+    {
+      derived = blxo_icon_cache_find_derived (entry, variant);
+      if (G_UNLIKELY (derived == NULL))
+        return;
+
+      pixbuf = derived->pixbuf;
+      surface_slot = &derived->surface;
+      scale_slot = &derived->surface_scale;
+    }
+
+  /* replace the surface for a previous scale */
+  if (*surface_slot != NULL)
+    {
+      cairo_surface_destroy (*surface_slot);
+      entry->n_bytes -= blxo_icon_cache_surface_size (pixbuf);
+      cache_n_bytes -= blxo_icon_cache_surface_size (pixbuf);
+    }
+
+  *surface_slot = cairo_surface_reference (surface);
+  *scale_slot = scale;
+  entry->n_bytes += blxo_icon_cache_surface_size (pixbuf);
+  cache_n_bytes += blxo_icon_cache_surface_size (pixbuf);
+
+  blxo_icon_cache_trim ();
+}
+
+
+
+/**
+ * _blxo_icon_cache_load_async:
+ * @filename  : the absolute path to the image file.
+ * @size      : the thumbnail size to load.
+ * @base_size : the thumbnail size for scale 1.
+ * @widget    : the #GtkWidget in which the image is displayed.
+ * @window    : the #GdkWindow the cell was rendered to or %NULL.
+ * @area      : the area of the cell in @window.
+ *
+ * Queues loading the thumbnail for @filename at @size on a worker thread.
+ * If @base_size differs from @size, the thumbnail at @base_size is derived
+ * from the same decode. Once the image is loaded, it is inserted into the
+ * icon cache and the @area is redrawn. Requests for the same image are merged, and requests are
+ * cancelled when the @widget is scrolled and the cell is not painted again.
+ **/
+void
+_blxo_icon_cache_load_async (const gchar        *filename,
+                            BlxoThumbnailSize    size,
+                            BlxoThumbnailSize    base_size,
+                            GtkWidget          *widget,
+                            GdkWindow          *window,
+                            const GdkRectangle *area)
+{
+  BlxoIconCacheRequest *request;
+  BlxoIconCacheTracker *tracker;
+  BlxoIconCacheWaiter  *waiter;
+  BlxoIconCacheKey      key;
+  GSList               *lp;
+
+  _blxo_return_if_fail (filename != NULL);
+  _blxo_return_if_fail (GTK_IS_WIDGET (widget));
+  _blxo_return_if_fail (area != NULL);
+
+  blxo_icon_cache_requests_init ();
+
+  tracker = blxo_icon_cache_tracker_get (widget);
+
+  /* check if the image is already being loaded */
+  key.filename = (gchar *) filename;
+  key.size = size;
+  request = g_hash_table_lookup (cache_requests, &key);
+  if (G_LIKELY (request == NULL))
+    {
+      request = g_slice_new0 (BlxoIconCacheRequest);
+      request->key.filename = g_strdup (filename);
+      request->key.size = size;
+      request->base_size = base_size;
+      request->cancellable = g_cancellable_new ();
+      _blxo_cache_monitor_watch (filename, &request->stamp);
+      g_hash_table_insert (cache_requests, &request->key, request);
+      g_thread_pool_push (cache_pool, request, NULL);
+    }
+
+  /* check if this cell is already waiting for the image */
+  for (lp = request->waiters; lp != NULL; lp = lp->next)
+    {
+      waiter = lp->data;
+      if (waiter->widget == widget
+          && waiter->area.x == area->x && waiter->area.y == area->y
+          && waiter->area.width == area->width && waiter->area.height == area->height)
+        {
+          waiter->serial = tracker->serial;
+          return;
+        }
+    }
+
+  waiter = g_slice_new0 (BlxoIconCacheWaiter);
+  waiter->widget = widget;
+  waiter->area = *area;
+  waiter->serial = tracker->serial;
+  g_object_add_weak_pointer (G_OBJECT (widget), (gpointer) &waiter->widget);
+#if !GTK_CHECK_VERSION (3, 0, 0)
+  if (G_LIKELY (window != NULL))
+    {
+      waiter->window = window;
+      g_object_add_weak_pointer (G_OBJECT (window), (gpointer) &waiter->window);
+    }
+#endif
+  request->waiters = g_slist_prepend (request->waiters, waiter);
+}
+
+
+
+/**
+ * _blxo_icon_cache_load:
+ * @filename  : the absolute path to the image file.
+ * @size      : the thumbnail size to load.
+ * @base_size : the thumbnail size for scale 1.
+ * @error     : return location for errors or %NULL.
+ *
+ * Loads the thumbnail for @filename at @size, and at @base_size if that
+ * differs, right away and stores them in the icon cache. If the image was queued for loading on a worker thread,
+ * but the worker did not start yet, the request is taken over, so the image
+ * is not rasterized twice; the cells waiting for it are redrawn as usual.
+ *
+ * The caller is responsible to free the returned pixbuf using
+ * g_object_unref() when no longer needed.
+ *
+ * Returns: the loaded #GdkPixbuf or %NULL on error.
+ **/
+GdkPixbuf*
+_blxo_icon_cache_load (const gchar      *filename,
+                      BlxoThumbnailSize  size,
+                      BlxoThumbnailSize  base_size,
+                      GError          **error)
+{
+  BlxoIconCacheRequest *request = NULL;
+  BlxoIconCacheKey      key;
+  GdkPixbuf            *base_pixbuf;
+  GdkPixbuf            *pixbuf;
+
+  _blxo_return_val_if_fail (filename != NULL, NULL);
+  _blxo_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  /* claim a queued request for the image */
+  if (cache_requests != NULL)
+    {
+      key.filename = (gchar *) filename;
+      key.size = size;
+      request = g_hash_table_lookup (cache_requests, &key);
+      if (request != NULL)
+        g_atomic_int_compare_and_exchange (&request->state, REQUEST_QUEUED, REQUEST_TAKEN);
+    }
+
+  pixbuf = blxo_icon_cache_load_thumbnails (filename, size, base_size, &base_pixbuf, error);
+  _blxo_icon_cache_insert (filename, size, pixbuf);
+
+  if (base_pixbuf != NULL)
+    {
+      key.filename = (gchar *) filename;
+      key.size = base_size;
+      if (!blxo_icon_cache_has_image (&key))
+        _blxo_icon_cache_insert (filename, base_size, base_pixbuf);
+      g_object_unref (G_OBJECT (base_pixbuf));
+    }
+
+  return pixbuf;
+}
+
+
+
+/**
+ * _blxo_icon_cache_prefetch:
+ * @filename  : the absolute path to the image file.
+ * @size      : the thumbnail size to load.
+ * @base_size : the thumbnail size for scale 1.
+ *
+ * Queues loading the thumbnail for @filename at @size, and at @base_size
+ * if that differs, on a worker thread, because it is likely to be painted
+ * soon. Prefetches are loaded after the
+ * images of visible cells, are not cancelled when scrolling, and are
+ * silently dropped if too many of them are queued already.
+ **/
+void
+_blxo_icon_cache_prefetch (const gchar      *filename,
+                          BlxoThumbnailSize  size,
+                          BlxoThumbnailSize  base_size)
+{
+  BlxoIconCacheRequest *request;
+  BlxoIconCacheKey      key;
+
+  _blxo_return_if_fail (filename != NULL);
+
+  if (cache_n_prefetches >= BLXO_ICON_CACHE_MAX_PREFETCHES)
+    return;
+
+  /* check if the image is cached or being loaded already */
+  key.filename = (gchar *) filename;
+  key.size = size;
+  if (cache_entries != NULL && g_hash_table_contains (cache_entries, &key))
+    return;
+
+  blxo_icon_cache_requests_init ();
+  if (g_hash_table_contains (cache_requests, &key))
+    return;
+
+  request = g_slice_new0 (BlxoIconCacheRequest);
+  request->key.filename = g_strdup (filename);
+  request->key.size = size;
+  request->base_size = base_size;
+  request->cancellable = g_cancellable_new ();
+  request->prefetch = TRUE;
+  _blxo_cache_monitor_watch (filename, &request->stamp);
+  g_hash_table_insert (cache_requests, &request->key, request);
+  g_thread_pool_push (cache_pool, request, NULL);
+  cache_n_prefetches++;
+}
+
+
+
+/**
+ * _blxo_icon_cache_widget_painted:
+ * @widget : a #GtkWidget.
+ *
+ * Tells the icon cache that cells of @widget were painted, so requests of
+ * cells that were not painted again since the last scroll can be cancelled.
+ **/
+void
+_blxo_icon_cache_widget_painted (GtkWidget *widget)
+{
+  BlxoIconCacheTracker *tracker;
+
+  /* only widgets with pending requests are tracked */
+  if (G_LIKELY (cache_tracker_quark == 0))
+    return;
+
+  tracker = g_object_get_qdata (G_OBJECT (widget), cache_tracker_quark);
+  if (tracker != NULL)
+    tracker->painted_serial = tracker->serial;
+}
+
+
+
+/**
+ * _blxo_icon_cache_cancel_for_widget:
+ * @widget : a #GtkWidget.
+ *
+ * Cancels all pending requests of cells in @widget, that are not
+ * also requested by other widgets.
+ **/
+void
+_blxo_icon_cache_cancel_for_widget (GtkWidget *widget)
+{
+  BlxoIconCacheRequest *request;
+  BlxoIconCacheWaiter  *waiter;
+  GHashTableIter        iter;
+  GSList               *lp, *lnext;
+
+  _blxo_return_if_fail (GTK_IS_WIDGET (widget));
+
+  if (G_UNLIKELY (cache_requests == NULL))
+    return;
+
+  g_hash_table_iter_init (&iter, cache_requests);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &request))
+    {
+      for (lp = request->waiters; lp != NULL; lp = lnext)
+        {
+          lnext = lp->next;
+          waiter = lp->data;
+
+          if (waiter->widget == widget || waiter->widget == NULL)
+            {
+              request->waiters = g_slist_delete_link (request->waiters, lp);
+              blxo_icon_cache_waiter_free (waiter);
+            }
+        }
+
+      if (request->waiters == NULL && !request->prefetch)
+        {
+          g_hash_table_iter_steal (&iter);
+          g_cancellable_cancel (request->cancellable);
+        }
+    }
+}
+
+
+
+#define __BLXO_ICON_CACHE_C__
+#include <blxo/blxo-aliasdef.c>
@@ -0,0 +1,104 @@
+/*-
+ * Copyright (c) 2026 Xfce Development Team <xfce4-dev@xfce.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#if !defined (BLXO_COMPILATION)
+#error "Only <blxo/blxo.h> can be included directly, this file is not part of the public API."
+#endif
+
+#ifndef __BLXO_ICON_CACHE_H__
+#define __BLXO_ICON_CACHE_H__
+
+#include <blxo/blxo-config.h>
+#include <blxo/blxo-thumbnail.h>
+
+#include <gtk/gtk.h>
+
+G_BEGIN_DECLS
+
+typedef struct _BlxoIconCacheVariant BlxoIconCacheVariant;
+
+/**
+ * BlxoIconCacheVariant:
+ * @width             : the maximum width the image was scaled to, or 0.
+ * @height            : the maximum height the image was scaled to, or 0.
+ * @flags             : the #GtkCellRendererState flags the image was rendered for.
+ * @selected_color    : the colour used for the selected state.
+ * @insensitive_color : the colour used for the insensitive state.
+ * @insensitive_bg    : the background colour of the insensitive state, if
+ *                      the image was rendered by the style, or 0.
+ * @style_type        : the #GType of the #GtkStyle that rendered the image, or 0.
+ *
+ * Identifies a version of a cached image, that was derived from the
+ * image for a certain cell state.
+ **/
+struct _BlxoIconCacheVariant
+{
+  gint    width;
+  gint    height;
+  guint   flags;
+  guint64 selected_color;
+  guint64 insensitive_color;
+  guint64 insensitive_bg;
+  GType   style_type;
+};
+
+G_GNUC_INTERNAL GdkPixbuf *_blxo_icon_cache_lookup            (const gchar        *filename,
+                                                              gint                size,
+                                                              gboolean           *failed) G_GNUC_WARN_UNUSED_RESULT;
+G_GNUC_INTERNAL void       _blxo_icon_cache_insert            (const gchar        *filename,
+                                                              gint                size,
+                                                              GdkPixbuf          *pixbuf);
+
+G_GNUC_INTERNAL GdkPixbuf *_blxo_icon_cache_lookup_variant    (const gchar                *filename,
+                                                              gint                        size,
+                                                              const BlxoIconCacheVariant *variant) G_GNUC_WARN_UNUSED_RESULT;
+G_GNUC_INTERNAL void       _blxo_icon_cache_insert_variant    (const gchar                *filename,
+                                                              gint                        size,
+                                                              const BlxoIconCacheVariant *variant,
+                                                              GdkPixbuf                  *pixbuf);
+
+G_GNUC_INTERNAL cairo_surface_t *_blxo_icon_cache_lookup_surface (const gchar                *filename,
+                                                                  gint                        size,
+                                                                  const BlxoIconCacheVariant *variant,
+                                                                  gint                        scale) G_GNUC_WARN_UNUSED_RESULT;
+G_GNUC_INTERNAL void             _blxo_icon_cache_insert_surface (const gchar                *filename,
+                                                                  gint                        size,
+                                                                  const BlxoIconCacheVariant *variant,
+                                                                  gint                        scale,
+                                                                  cairo_surface_t            *surface);
+
+G_GNUC_INTERNAL void       _blxo_icon_cache_load_async        (const gchar        *filename,
+                                                              BlxoThumbnailSize    size,
+                                                              BlxoThumbnailSize    base_size,
+                                                              GtkWidget          *widget,
+                                                              GdkWindow          *window,
+                                                              const GdkRectangle *area);
+G_GNUC_INTERNAL GdkPixbuf *_blxo_icon_cache_load              (const gchar        *filename,
+                                                              BlxoThumbnailSize    size,
+                                                              BlxoThumbnailSize    base_size,
+                                                              GError            **error) G_GNUC_WARN_UNUSED_RESULT;
+G_GNUC_INTERNAL void       _blxo_icon_cache_prefetch          (const gchar        *filename,
+                                                              BlxoThumbnailSize    size,
+                                                              BlxoThumbnailSize    base_size);
+G_GNUC_INTERNAL void       _blxo_icon_cache_widget_painted    (GtkWidget          *widget);
+G_GNUC_INTERNAL void       _blxo_icon_cache_cancel_for_widget (GtkWidget          *widget);
+
+G_END_DECLS
+
+#endif /* !__BLXO_ICON_CACHE_H__ */
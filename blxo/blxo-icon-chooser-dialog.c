@@ -274,6 +274,7 @@ blxo_icon_chooser_dialog_init (BlxoIconChooserDialog *icon_chooser_dialog)
 
   /* setup the icon renderer */
   renderer = blxo_cell_renderer_icon_new ();
+  g_object_set (G_OBJECT (renderer), "async", TRUE, NULL);
   gtk_cell_layout_pack_start (GTK_CELL_LAYOUT (priv->icon_chooser), renderer, TRUE);
   gtk_cell_layout_set_attributes (GTK_CELL_LAYOUT (priv->icon_chooser), renderer, "icon", BLXO_ICON_CHOOSER_MODEL_COLUMN_ICON_NAME, NULL);
 
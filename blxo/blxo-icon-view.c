@@ -258,6 +258,7 @@ static void                 blxo_icon_view_paint_item                     (BlxoI
 static void                 blxo_icon_view_queue_draw_item                (BlxoIconView            *icon_view,
                                                                           BlxoIconViewItem        *item);
 static void                 blxo_icon_view_queue_layout                   (BlxoIconView            *icon_view);
+static void                 blxo_icon_view_queue_prefetch                 (BlxoIconView            *icon_view);
 static void                 blxo_icon_view_set_cursor_item                (BlxoIconView            *icon_view,
                                                                           BlxoIconViewItem        *item,
                                                                           gint                    cursor_cell);
@@ -523,6 +524,7 @@ struct _BlxoIconViewPrivate
 #endif
 
   guint layout_idle_id;
+  guint prefetch_idle_id;
 
   gboolean doing_rubberband;
   gint rubberband_x_1, rubberband_y_1;
@@ -1450,6 +1452,10 @@ blxo_icon_view_finalize (GObject *object)
   if (G_UNLIKELY (icon_view->priv->single_click_timeout_id != 0))
     g_source_remove (icon_view->priv->single_click_timeout_id);
 
+  /* stop prefetching the images of the items */
+  if (G_UNLIKELY (icon_view->priv->prefetch_idle_id != 0))
+    g_source_remove (icon_view->priv->prefetch_idle_id);
+
   /* kill the layout idle source (it's important to have this last!) */
   if (G_UNLIKELY (icon_view->priv->layout_idle_id != 0))
     g_source_remove (icon_view->priv->layout_idle_id);
@@ -1746,6 +1752,10 @@ blxo_icon_view_unrealize (GtkWidget *widget)
 {
   BlxoIconViewPrivate *priv = BLXO_ICON_VIEW (widget)->priv;
 
+  /* the items of unrealized views are not going to be painted soon */
+  if (G_UNLIKELY (priv->prefetch_idle_id != 0))
+    g_source_remove (priv->prefetch_idle_id);
+
   /* drop the icons window */
   gdk_window_set_user_data (priv->bin_window, NULL);
   gdk_window_destroy (priv->bin_window);
@@ -3421,6 +3431,9 @@ blxo_icon_view_adjustment_changed (GtkAdjustment *adjustment,
 #if !GTK_CHECK_VERSION (3, 22, 0)
       gdk_window_process_updates (icon_view->priv->bin_window, TRUE);
 #endif
+
+      /* prefetch the images of the items scrolled next to the visible area */
+      blxo_icon_view_queue_prefetch (icon_view);
     }
 }
 
@@ -3841,6 +3854,10 @@ blxo_icon_view_layout (BlxoIconView *icon_view)
   if (priv->layout_idle_id != 0)
     g_source_remove (priv->layout_idle_id);
 
+  /* prefetch the images of the items in and around the visible area */
+  if (gtk_widget_get_realized (GTK_WIDGET (icon_view)))
+    blxo_icon_view_queue_prefetch (icon_view);
+
   gtk_widget_queue_draw (GTK_WIDGET (icon_view));
 }
 
@@ -4328,6 +4345,96 @@ blxo_icon_view_queue_layout (BlxoIconView *icon_view)
 
 
 
+static inline gboolean
+blxo_icon_view_item_in_area (const BlxoIconViewItem *item,
+                             const GdkRectangle     *area)
+{
+  return (item->area.x + item->area.width >= area->x && item->area.x <= area->x + area->width
+       && item->area.y + item->area.height >= area->y && item->area.y <= area->y + area->height);
+}
+
+
+
+static void
+blxo_icon_view_prefetch_item (BlxoIconView     *icon_view,
+                              BlxoIconViewItem *item)
+{
+  BlxoIconViewCellInfo *info;
+  GList                *lp;
+
+  blxo_icon_view_set_cell_data (icon_view, item);
+
+  for (lp = icon_view->priv->cell_list; lp != NULL; lp = lp->next)
+    {
+      info = BLXO_ICON_VIEW_CELL_INFO (lp->data);
+      if (BLXO_IS_CELL_RENDERER_ICON (info->cell) && gtk_cell_renderer_get_visible (info->cell))
+        _blxo_cell_renderer_icon_prefetch (info->cell, GTK_WIDGET (icon_view));
+    }
+}
+
+
+
+static gboolean
+prefetch_callback (gpointer user_data)
+{
+  BlxoIconView        *icon_view = BLXO_ICON_VIEW (user_data);
+  BlxoIconViewPrivate *priv = icon_view->priv;
+  BlxoIconViewItem    *item;
+  GdkRectangle         visible;
+  GdkRectangle         around;
+  GList               *lp;
+
+  if (priv->hadjustment == NULL || priv->vadjustment == NULL || priv->layout_idle_id != 0)
+    return FALSE;
+
+  visible.x = gtk_adjustment_get_value (priv->hadjustment);
+  visible.y = gtk_adjustment_get_value (priv->vadjustment);
+  visible.width = gtk_adjustment_get_page_size (priv->hadjustment);
+  visible.height = gtk_adjustment_get_page_size (priv->vadjustment);
+
+  /* the visible items first, they are likely being painted already */
+  for (lp = priv->items; lp != NULL; lp = lp->next)
+    {
+      item = lp->data;
+      if (blxo_icon_view_item_in_area (item, &visible))
+        blxo_icon_view_prefetch_item (icon_view, item);
+    }
+
+  /* then the items a page away, in every direction the view may be scrolled */
+  around.x = visible.x - visible.width;
+  around.y = visible.y - visible.height;
+  around.width = 3 * visible.width;
+  around.height = 3 * visible.height;
+  for (lp = priv->items; lp != NULL; lp = lp->next)
+    {
+      item = lp->data;
+      if (blxo_icon_view_item_in_area (item, &around) && !blxo_icon_view_item_in_area (item, &visible))
+        blxo_icon_view_prefetch_item (icon_view, item);
+    }
+
+  return FALSE;
+}
+
+
+
+static void
+prefetch_destroy (gpointer user_data)
+{
+  BLXO_ICON_VIEW (user_data)->priv->prefetch_idle_id = 0;
+}
+
+
+
+static void
+blxo_icon_view_queue_prefetch (BlxoIconView *icon_view)
+{
+  /* prefetch once the pending redraw is done, so painting comes first */
+  if (icon_view->priv->prefetch_idle_id == 0)
+    icon_view->priv->prefetch_idle_id = gdk_threads_add_idle_full (G_PRIORITY_LOW, prefetch_callback, icon_view, prefetch_destroy);
+}
+
+
+
 static void
 blxo_icon_view_set_cursor_item (BlxoIconView     *icon_view,
                                BlxoIconViewItem *item,
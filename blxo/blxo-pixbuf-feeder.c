@@ -0,0 +1,417 @@
+/*-
+ * Copyright (c) 2026 Xfce Development Team <xfce4-dev@xfce.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#ifdef HAVE_SYS_TYPES_H
+#include <sys/types.h>
+#endif
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+
+#ifdef HAVE_ERRNO_H
+#include <errno.h>
+#endif
+#ifdef HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#include <blxo/blxo-pixbuf-feeder.h>
+#include <blxo/blxo-private.h>
+#include <blxo/blxo-alias.h>
+
+/* Files are fed into the loader through mmap()ed windows, that the kernel
+ * is told to read ahead sequentially, or with large read() calls if the
+ * file cannot be mapped, e.g. on some network file systems. Feeding stops
+ * at the end of the image data of JPEG and PNG files, so data appended to
+ * the image, like the video of motion photos, is never read.
+ */
+
+/* the size of the mmap() windows, a multiple of the page size */
+#define BLXO_PIXBUF_FEEDER_WINDOW (4 * 1024 * 1024)
+
+/* the size of the read() calls if mmap() fails */
+#define BLXO_PIXBUF_FEEDER_READ_SIZE (256 * 1024)
+
+/* the number of bytes fed into the loader between cancellation checks */
+#define BLXO_PIXBUF_FEEDER_CHUNK (64 * 1024)
+
+
+
+typedef enum
+{
+  SCANNER_START,
+  SCANNER_UNKNOWN,
+  SCANNER_DONE,
+
+  /* JPEG markers and segments */
+  SCANNER_JPEG_MARKER,
+  SCANNER_JPEG_CODE,
+  SCANNER_JPEG_LENGTH,
+  SCANNER_JPEG_SEGMENT,
+  SCANNER_JPEG_ENTROPY,
+  SCANNER_JPEG_ENTROPY_FF,
+
+  /* PNG chunks */
+  SCANNER_PNG_HEADER,
+  SCANNER_PNG_CHUNK,
+} BlxoPixbufScannerState;
+
+typedef struct
+{
+  BlxoPixbufScannerState state;
+
+  /* the bytes of a header being collected */
+  guchar                 header[8];
+  guint                  n_header;
+
+  /* the bytes left in the current segment or chunk */
+  guint64                skip;
+
+  /* the JPEG marker of the current segment */
+  guchar                 code;
+
+  /* whether the current PNG chunk is the last one */
+  gboolean               last;
+} BlxoPixbufScanner;
+
+
+
+static const guchar png_signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+
+
+
+static gboolean
+blxo_pixbuf_scanner_collect (BlxoPixbufScanner *scanner,
+                             const guchar     **data,
+                             const guchar      *end,
+                             guint              n_bytes)
+{
+  for (; scanner->n_header < n_bytes && *data < end; ++(*data))
+    scanner->header[scanner->n_header++] = **data;
+
+  return (scanner->n_header == n_bytes);
+}
+
+
+
+/* returns the number of bytes of @data, that belong to the image */
+static gsize
+blxo_pixbuf_scanner_scan (BlxoPixbufScanner *scanner,
+                          const guchar      *data,
+                          gsize              length)
+{
+  const guchar *start = data;
+  const guchar *end = data + length;
+  const guchar *p;
+  gsize         n;
+
+  while (data < end)
+    {
+      switch (scanner->state)
+        {
+        case SCANNER_START:
+          /* detect the format from the first bytes */
+          if (!blxo_pixbuf_scanner_collect (scanner, &data, end, 2))
+            break;
+          if (scanner->header[0] == 0xff && scanner->header[1] == 0xd8)
+            {
+              scanner->state = SCANNER_JPEG_MARKER;
+            }
+          else if (scanner->header[0] == png_signature[0] && scanner->header[1] == png_signature[1])
+            {
+              scanner->state = SCANNER_PNG_HEADER;
+              scanner->skip = 6;
+            }
+          else
+            {
+              scanner->state = SCANNER_UNKNOWN;
+            }
+          scanner->n_header = 0;
+          break;
+
+        case SCANNER_UNKNOWN:
+          return length;
+
+        case SCANNER_DONE:
+          return data - start;
+
+        case SCANNER_JPEG_MARKER:
+          /* anything but a marker is left to the loader to complain about */
+          scanner->state = (*data++ == 0xff) ? SCANNER_JPEG_CODE : SCANNER_UNKNOWN;
+          break;
+
+        case SCANNER_JPEG_CODE:
+        case SCANNER_JPEG_ENTROPY_FF:
+          scanner->code = *data++;
+          if (scanner->code == 0xff)
+            {
+              /* fill byte */
+            }
+          else if (scanner->code == 0xd9)
+            {
+              /* end of image */
+              scanner->state = SCANNER_DONE;
+            }
+          else if (scanner->state == SCANNER_JPEG_ENTROPY_FF
+                   && (scanner->code == 0x00 || (scanner->code >= 0xd0 && scanner->code <= 0xd7)))
+            {
+              /* stuffed byte or restart marker in the image data */
+              scanner->state = SCANNER_JPEG_ENTROPY;
+            }
+          else if (scanner->code == 0x01 || (scanner->code >= 0xd0 && scanner->code <= 0xd8))
+            {
+              /* markers without a segment */
+              scanner->state = SCANNER_JPEG_MARKER;
+            }
+          else
+            {
+              scanner->state = SCANNER_JPEG_LENGTH;
+            }
+          break;
+
+        case SCANNER_JPEG_LENGTH:
+          if (!blxo_pixbuf_scanner_collect (scanner, &data, end, 2))
+            break;
+          scanner->skip = (scanner->header[0] << 8) | scanner->header[1];
+          scanner->state = (scanner->skip >= 2) ? SCANNER_JPEG_SEGMENT : SCANNER_UNKNOWN;
+          scanner->skip -= 2;
+          scanner->n_header = 0;
+          break;
+
+        case SCANNER_JPEG_SEGMENT:
+          n = MIN (scanner->skip, (guint64) (end - data));
+          scanner->skip -= n;
+          data += n;
+
+          /* the image data follows the start of scan segments */
+          if (scanner->skip == 0)
+            scanner->state = (scanner->code == 0xda) ? SCANNER_JPEG_ENTROPY : SCANNER_JPEG_MARKER;
+          break;
+
+        case SCANNER_JPEG_ENTROPY:
+          p = memchr (data, 0xff, end - data);
+          if (p == NULL)
+            {
+              data = end;
+            }
+          else
+            {
+              data = p + 1;
+              scanner->state = SCANNER_JPEG_ENTROPY_FF;
+            }
+          break;
+
+        case SCANNER_PNG_HEADER:
+          /* skip the rest of the signature and the chunk data and CRC */
+          if (scanner->skip > 0)
+            {
+              n = MIN (scanner->skip, (guint64) (end - data));
+              scanner->skip -= n;
+              data += n;
+            }
+          else if (scanner->last)
+            {
+              scanner->state = SCANNER_DONE;
+            }
+          else
+            {
+              scanner->state = SCANNER_PNG_CHUNK;
+            }
+          break;
+
+        case SCANNER_PNG_CHUNK:
+          /* the chunk length and type */
+          if (!blxo_pixbuf_scanner_collect (scanner, &data, end, 8))
+            break;
+          scanner->skip = (((guint64) scanner->header[0] << 24) | (scanner->header[1] << 16)
+                           | (scanner->header[2] << 8) | scanner->header[3]) + 4;
+          scanner->last = (memcmp (scanner->header + 4, "IEND", 4) == 0);
+          scanner->state = SCANNER_PNG_HEADER;
+          scanner->n_header = 0;
+          break;
+        }
+    }
+
+  /* a PNG file ends after the CRC of its last chunk */
+  if (scanner->state == SCANNER_PNG_HEADER && scanner->last && scanner->skip == 0)
+    scanner->state = SCANNER_DONE;
+
+  return length;
+}
+
+
+
+static gboolean
+blxo_pixbuf_feed_data (GdkPixbufLoader   *loader,
+                       BlxoPixbufScanner *scanner,
+                       const guchar      *data,
+                       gsize              length,
+                       GCancellable      *cancellable,
+                       GError           **error)
+{
+  gsize n;
+
+  /* feed in chunks, so we can be cancelled */
+  for (; length > 0 && scanner->state != SCANNER_DONE; data += n, length -= n)
+    {
+      if (g_cancellable_set_error_if_cancelled (cancellable, error))
+        return FALSE;
+
+      n = blxo_pixbuf_scanner_scan (scanner, data, MIN (length, BLXO_PIXBUF_FEEDER_CHUNK));
+      if (!gdk_pixbuf_loader_write (loader, data, n, error))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+
+
+/**
+ * _blxo_pixbuf_feed:
+ * @loader      : a #GdkPixbufLoader.
+ * @filename    : the name of the file, for error messages.
+ * @fd          : the file descriptor to read from.
+ * @size        : the size of the file.
+ * @cancellable : a #GCancellable or %NULL.
+ * @error       : return location for errors or %NULL.
+ *
+ * Feeds the contents of the file at @fd into @loader, until the end
+ * of the file or the end of the image data, if it can be determined.
+ * The @loader is not closed.
+ *
+ * Returns: %TRUE on success, %FALSE if reading or loading failed, or
+ *          the operation was cancelled.
+ **/
+gboolean
+_blxo_pixbuf_feed (GdkPixbufLoader *loader,
+                   const gchar     *filename,
+                   gint             fd,
+                   goffset          size,
+                   GCancellable    *cancellable,
+                   GError         **error)
+{
+  BlxoPixbufScanner scanner;
+  gboolean          succeed = TRUE;
+  guchar           *buffer;
+  gchar            *display_name;
+  gint              sverrno;
+  gint              n;
+#ifdef HAVE_MMAP
+  goffset           offset;
+  gsize             length;
+#endif
+
+  memset (&scanner, 0, sizeof (scanner));
+
+#ifdef HAVE_MMAP
+  /* map one window of the file after the other */
+  for (offset = 0; offset < size && scanner.state != SCANNER_DONE; offset += length)
+    {
+      length = MIN (size - offset, BLXO_PIXBUF_FEEDER_WINDOW);
+      buffer = mmap (NULL, length, PROT_READ, MAP_SHARED, fd, offset);
+      if (G_UNLIKELY (buffer == MAP_FAILED))
+        break;
+
+#ifdef HAVE_MADVISE
+      /* start reading the whole window, and drop pages behind us */
+      madvise (buffer, length, MADV_SEQUENTIAL);
+      madvise (buffer, length, MADV_WILLNEED);
+#endif
+
+      succeed = blxo_pixbuf_feed_data (loader, &scanner, buffer, length, cancellable, error);
+      munmap (buffer, length);
+      if (G_UNLIKELY (!succeed))
+        return FALSE;
+    }
+
+  if (offset >= size || scanner.state == SCANNER_DONE)
+    return TRUE;
+
+  /* continue with read() where mapping failed */
+  if (lseek (fd, offset, SEEK_SET) < 0)
+    goto err;
+#endif
+
+  /* allocate the read buffer */
+  buffer = g_malloc (BLXO_PIXBUF_FEEDER_READ_SIZE);
+
+  /* read the file content */
+  while (succeed && scanner.state != SCANNER_DONE)
+    {
+      /* check if we were cancelled */
+      if (g_cancellable_set_error_if_cancelled (cancellable, error))
+        {
+          succeed = FALSE;
+          break;
+        }
+
+      /* read the next chunk */
+      n = read (fd, buffer, BLXO_PIXBUF_FEEDER_READ_SIZE);
+      if (G_UNLIKELY (n < 0))
+        {
+          if (errno == EINTR)
+            continue;
+
+          g_free (buffer);
+          goto err;
+        }
+      else if (n == 0)
+        {
+          /* file read completely */
+          break;
+        }
+
+      /* feed the data into the loader */
+      succeed = blxo_pixbuf_feed_data (loader, &scanner, buffer, n, cancellable, error);
+    }
+
+  g_free (buffer);
+
+  return succeed;
+
+err:
+  /* remember the errno value */
+  sverrno = errno;
+
+  /* initialize the library's i18n support */
+  _blxo_i18n_init ();
+
+  /* generate a useful error message */
+  display_name = g_filename_display_name (filename);
+  g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (sverrno), _("Failed to read file \"%s\": %s"), display_name, g_strerror (sverrno));
+  g_free (display_name);
+
+  return FALSE;
+}
+
+
+
+#define __BLXO_PIXBUF_FEEDER_C__
+#include <blxo/blxo-aliasdef.c>
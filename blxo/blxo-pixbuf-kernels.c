@@ -0,0 +1,479 @@
+/*-
+ * Copyright (c) 2026 Xfce Development Team <xfce4-dev@xfce.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include <blxo/blxo-pixbuf-kernels.h>
+#include <blxo/blxo-private.h>
+#include <blxo/blxo-alias.h>
+
+/* The SIMD kernels are compiled with per-function target attributes, so
+ * they are available regardless of the compiler flags of the build, and
+ * the best kernels supported by the CPU are picked at runtime. Setting
+ * BLXO_PIXBUF_KERNELS to "scalar", "sse2" or "avx2" in the environment
+ * limits the kernels to the given instruction set.
+ */
+#if defined(HAVE_IMMINTRIN_H) && (defined(__x86_64__) || defined(__i386__)) \
+  && (G_GNUC_CHECK_VERSION (4, 9) || defined(__clang__))
+#define BLXO_PIXBUF_KERNELS_X86 1
+#include <immintrin.h>
+#endif
+
+
+
+static inline guchar
+lighten_channel (guchar cur_value)
+{
+  gint new_value = cur_value;
+
+  new_value += 24 + (new_value >> 3);
+  if (G_UNLIKELY (new_value > 255))
+    new_value = 255;
+
+  return (guchar) new_value;
+}
+
+
+
+static void
+blxo_pixbuf_colorize_scalar (guchar        *dst,
+                             const guchar  *src,
+                             gint           n_bytes,
+                             const guint16 *factors)
+{
+  gint i, k;
+
+  for (i = 0, k = 0; i < n_bytes; ++i)
+    {
+      dst[i] = (src[i] * factors[k]) >> 8;
+      if (++k == BLXO_PIXBUF_KERNEL_TABLE_SIZE)
+        k = 0;
+    }
+}
+
+
+
+static void
+blxo_pixbuf_spotlight_scalar (guchar        *dst,
+                              const guchar  *src,
+                              gint           n_bytes,
+                              const guint16 *mask)
+{
+  gint i, k;
+
+  for (i = 0, k = 0; i < n_bytes; ++i)
+    {
+      dst[i] = (mask[k] != 0) ? lighten_channel (src[i]) : src[i];
+      if (++k == BLXO_PIXBUF_KERNEL_TABLE_SIZE)
+        k = 0;
+    }
+}
+
+
+
+static void
+blxo_pixbuf_lucent_scalar (guchar       *dst,
+                           const guchar *src,
+                           gint          width,
+                           gboolean      has_alpha,
+                           guint         percent)
+{
+  guchar alpha;
+  gint   j;
+
+  if (G_LIKELY (has_alpha))
+    {
+      for (j = width; --j >= 0; )
+        {
+          *dst++ = *src++;
+          *dst++ = *src++;
+          *dst++ = *src++;
+          *dst++ = ((guint) *src++ * percent) / 100u;
+        }
+    }
+  else
+    {
+      /* pre-calculate the alpha value */
+      alpha = (255u * percent) / 100u;
+
+      for (j = width; --j >= 0; )
+        {
+          *dst++ = *src++;
+          *dst++ = *src++;
+          *dst++ = *src++;
+          *dst++ = alpha;
+        }
+    }
+}
+
+
+
+#ifdef BLXO_PIXBUF_KERNELS_X86
+/* x / 100 for 0 <= x <= 255 * 100, as ((x * 41944) >> 16) >> 6 */
+#define DIV100_FACTOR (41944)
+#define DIV100_SHIFT  (6)
+
+
+
+__attribute__((target ("sse2"))) static void
+blxo_pixbuf_colorize_sse2 (guchar        *dst,
+                           const guchar  *src,
+                           gint           n_bytes,
+                           const guint16 *factors)
+{
+  const __m128i zero = _mm_setzero_si128 ();
+  __m128i       f[6];
+  __m128i       s, lo, hi;
+  gint          i, k;
+
+  for (k = 0; k < 6; ++k)
+    f[k] = _mm_loadu_si128 ((const __m128i *) (factors + 8 * k));
+
+  /* the factor table repeats every 48 bytes */
+  for (i = 0; i + BLXO_PIXBUF_KERNEL_TABLE_SIZE <= n_bytes; i += BLXO_PIXBUF_KERNEL_TABLE_SIZE)
+    for (k = 0; k < 3; ++k)
+      {
+        s = _mm_loadu_si128 ((const __m128i *) (src + i + 16 * k));
+
+        /* (x * factor) >> 8 fits into 16 bits for factors up to 257 */
+        lo = _mm_srli_epi16 (_mm_mullo_epi16 (_mm_unpacklo_epi8 (s, zero), f[2 * k]), 8);
+        hi = _mm_srli_epi16 (_mm_mullo_epi16 (_mm_unpackhi_epi8 (s, zero), f[2 * k + 1]), 8);
+
+        _mm_storeu_si128 ((__m128i *) (dst + i + 16 * k), _mm_packus_epi16 (lo, hi));
+      }
+
+  /* the tail starts at the beginning of the table again */
+  blxo_pixbuf_colorize_scalar (dst + i, src + i, n_bytes - i, factors);
+}
+
+
+
+__attribute__((target ("sse2"))) static void
+blxo_pixbuf_spotlight_sse2 (guchar        *dst,
+                            const guchar  *src,
+                            gint           n_bytes,
+                            const guint16 *mask)
+{
+  const __m128i zero = _mm_setzero_si128 ();
+  const __m128i twentyfour = _mm_set1_epi16 (24);
+  __m128i       m[6];
+  __m128i       s, lo, hi;
+  gint          i, k;
+
+  for (k = 0; k < 6; ++k)
+    m[k] = _mm_loadu_si128 ((const __m128i *) (mask + 8 * k));
+
+  for (i = 0; i + BLXO_PIXBUF_KERNEL_TABLE_SIZE <= n_bytes; i += BLXO_PIXBUF_KERNEL_TABLE_SIZE)
+    for (k = 0; k < 3; ++k)
+      {
+        s = _mm_loadu_si128 ((const __m128i *) (src + i + 16 * k));
+        lo = _mm_unpacklo_epi8 (s, zero);
+        hi = _mm_unpackhi_epi8 (s, zero);
+
+        /* add 24 + (x >> 3) to the masked channels */
+        lo = _mm_add_epi16 (lo, _mm_and_si128 (_mm_add_epi16 (_mm_srli_epi16 (lo, 3), twentyfour), m[2 * k]));
+        hi = _mm_add_epi16 (hi, _mm_and_si128 (_mm_add_epi16 (_mm_srli_epi16 (hi, 3), twentyfour), m[2 * k + 1]));
+
+        /* packing saturates to 255 */
+        _mm_storeu_si128 ((__m128i *) (dst + i + 16 * k), _mm_packus_epi16 (lo, hi));
+      }
+
+  blxo_pixbuf_spotlight_scalar (dst + i, src + i, n_bytes - i, mask);
+}
+
+
+
+__attribute__((target ("sse2"))) static void
+blxo_pixbuf_lucent_sse2 (guchar       *dst,
+                         const guchar *src,
+                         gint          width,
+                         gboolean      has_alpha,
+                         guint         percent)
+{
+  const __m128i rgb_mask = _mm_set1_epi32 (0x00ffffff);
+  __m128i       s, a;
+  guint32       p[4];
+  gint          j = 0;
+
+  if (G_LIKELY (has_alpha))
+    {
+      const __m128i factor = _mm_set1_epi32 (percent);
+      const __m128i div100 = _mm_set1_epi32 (DIV100_FACTOR);
+
+      for (; j + 4 <= width; j += 4, src += 16, dst += 16)
+        {
+          s = _mm_loadu_si128 ((const __m128i *) src);
+
+          /* the alpha values in the low 16 bits of each pixel, scaled to percent */
+          a = _mm_srli_epi32 (s, 24);
+          a = _mm_mullo_epi16 (a, factor);
+          a = _mm_srli_epi32 (_mm_mulhi_epu16 (a, div100), DIV100_SHIFT);
+
+          _mm_storeu_si128 ((__m128i *) dst, _mm_or_si128 (_mm_and_si128 (s, rgb_mask), _mm_slli_epi32 (a, 24)));
+        }
+    }
+  else
+    {
+      const __m128i alpha = _mm_set1_epi32 ((gint32) (((255u * percent) / 100u) << 24));
+
+      /* read each RGB pixel as 4 bytes, stopping before the last pixel of the row */
+      for (; j + 5 <= width; j += 4, src += 12, dst += 16)
+        {
+          memcpy (p, src, 4);
+          memcpy (p + 1, src + 3, 4);
+          memcpy (p + 2, src + 6, 4);
+          memcpy (p + 3, src + 9, 4);
+          s = _mm_loadu_si128 ((const __m128i *) p);
+
+          _mm_storeu_si128 ((__m128i *) dst, _mm_or_si128 (_mm_and_si128 (s, rgb_mask), alpha));
+        }
+    }
+
+  blxo_pixbuf_lucent_scalar (dst, src, width - j, has_alpha, percent);
+}
+
+
+
+__attribute__((target ("avx2"))) static void
+blxo_pixbuf_colorize_avx2 (guchar        *dst,
+                           const guchar  *src,
+                           gint           n_bytes,
+                           const guint16 *factors)
+{
+  __m256i f[3];
+  __m256i w;
+  gint    i, k;
+
+  for (k = 0; k < 3; ++k)
+    f[k] = _mm256_loadu_si256 ((const __m256i *) (factors + 16 * k));
+
+  for (i = 0; i + BLXO_PIXBUF_KERNEL_TABLE_SIZE <= n_bytes; i += BLXO_PIXBUF_KERNEL_TABLE_SIZE)
+    for (k = 0; k < 3; ++k)
+      {
+        /* widen 16 bytes at once, so the lanes stay in memory order */
+        w = _mm256_cvtepu8_epi16 (_mm_loadu_si128 ((const __m128i *) (src + i + 16 * k)));
+        w = _mm256_srli_epi16 (_mm256_mullo_epi16 (w, f[k]), 8);
+
+        _mm_storeu_si128 ((__m128i *) (dst + i + 16 * k),
+                          _mm_packus_epi16 (_mm256_castsi256_si128 (w), _mm256_extracti128_si256 (w, 1)));
+      }
+
+  blxo_pixbuf_colorize_scalar (dst + i, src + i, n_bytes - i, factors);
+}
+
+
+
+__attribute__((target ("avx2"))) static void
+blxo_pixbuf_spotlight_avx2 (guchar        *dst,
+                            const guchar  *src,
+                            gint           n_bytes,
+                            const guint16 *mask)
+{
+  const __m256i twentyfour = _mm256_set1_epi16 (24);
+  __m256i       m[3];
+  __m256i       w;
+  gint          i, k;
+
+  for (k = 0; k < 3; ++k)
+    m[k] = _mm256_loadu_si256 ((const __m256i *) (mask + 16 * k));
+
+  for (i = 0; i + BLXO_PIXBUF_KERNEL_TABLE_SIZE <= n_bytes; i += BLXO_PIXBUF_KERNEL_TABLE_SIZE)
+    for (k = 0; k < 3; ++k)
+      {
+        w = _mm256_cvtepu8_epi16 (_mm_loadu_si128 ((const __m128i *) (src + i + 16 * k)));
+        w = _mm256_add_epi16 (w, _mm256_and_si256 (_mm256_add_epi16 (_mm256_srli_epi16 (w, 3), twentyfour), m[k]));
+
+        _mm_storeu_si128 ((__m128i *) (dst + i + 16 * k),
+                          _mm_packus_epi16 (_mm256_castsi256_si128 (w), _mm256_extracti128_si256 (w, 1)));
+      }
+
+  blxo_pixbuf_spotlight_scalar (dst + i, src + i, n_bytes - i, mask);
+}
+
+
+
+__attribute__((target ("avx2"))) static void
+blxo_pixbuf_lucent_avx2 (guchar       *dst,
+                         const guchar *src,
+                         gint          width,
+                         gboolean      has_alpha,
+                         guint         percent)
+{
+  const __m256i rgb_mask = _mm256_set1_epi32 (0x00ffffff);
+  __m256i       s, a;
+  __m128i       lo, hi;
+  gint          j = 0;
+
+  if (G_LIKELY (has_alpha))
+    {
+      const __m256i factor = _mm256_set1_epi32 (percent);
+      const __m256i div100 = _mm256_set1_epi32 (DIV100_FACTOR);
+
+      for (; j + 8 <= width; j += 8, src += 32, dst += 32)
+        {
+          s = _mm256_loadu_si256 ((const __m256i *) src);
+
+          a = _mm256_srli_epi32 (s, 24);
+          a = _mm256_mullo_epi16 (a, factor);
+          a = _mm256_srli_epi32 (_mm256_mulhi_epu16 (a, div100), DIV100_SHIFT);
+
+          _mm256_storeu_si256 ((__m256i *) dst, _mm256_or_si256 (_mm256_and_si256 (s, rgb_mask), _mm256_slli_epi32 (a, 24)));
+        }
+    }
+  else
+    {
+      const __m128i spread = _mm_setr_epi8 (0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+      const __m256i alpha = _mm256_set1_epi32 ((gint32) (((255u * percent) / 100u) << 24));
+
+      /* each 16 byte load holds 4 RGB pixels, don't read past the end of the row */
+      for (; j + 10 <= width; j += 8, src += 24, dst += 32)
+        {
+          lo = _mm_shuffle_epi8 (_mm_loadu_si128 ((const __m128i *) src), spread);
+          hi = _mm_shuffle_epi8 (_mm_loadu_si128 ((const __m128i *) (src + 12)), spread);
+          s = _mm256_inserti128_si256 (_mm256_castsi128_si256 (lo), hi, 1);
+
+          _mm256_storeu_si256 ((__m256i *) dst, _mm256_or_si256 (s, alpha));
+        }
+    }
+
+  blxo_pixbuf_lucent_scalar (dst, src, width - j, has_alpha, percent);
+}
+#endif /* !BLXO_PIXBUF_KERNELS_X86 */
+
+
+
+static const BlxoPixbufKernels kernels_scalar =
+{
+  BLXO_PIXBUF_KERNELS_SCALAR,
+  blxo_pixbuf_colorize_scalar,
+  blxo_pixbuf_spotlight_scalar,
+  blxo_pixbuf_lucent_scalar,
+};
+
+#ifdef BLXO_PIXBUF_KERNELS_X86
+static const BlxoPixbufKernels kernels_sse2 =
+{
+  BLXO_PIXBUF_KERNELS_SSE2,
+  blxo_pixbuf_colorize_sse2,
+  blxo_pixbuf_spotlight_sse2,
+  blxo_pixbuf_lucent_sse2,
+};
+
+static const BlxoPixbufKernels kernels_avx2 =
+{
+  BLXO_PIXBUF_KERNELS_AVX2,
+  blxo_pixbuf_colorize_avx2,
+  blxo_pixbuf_spotlight_avx2,
+  blxo_pixbuf_lucent_avx2,
+};
+#endif
+
+
+
+/**
+ * _blxo_pixbuf_kernels_get_for_level:
+ * @level : a #BlxoPixbufKernelsLevel.
+ *
+ * Returns the kernels for @level, if they are supported by the
+ * compiler and the CPU, %NULL otherwise.
+ *
+ * Returns: the #BlxoPixbufKernels for @level or %NULL.
+ **/
+const BlxoPixbufKernels*
+_blxo_pixbuf_kernels_get_for_level (BlxoPixbufKernelsLevel level)
+{
+#ifdef BLXO_PIXBUF_KERNELS_X86
+  __builtin_cpu_init ();
+#endif
+
+  switch (level)
+    {
+    case BLXO_PIXBUF_KERNELS_SCALAR:
+      return &kernels_scalar;
+
+#ifdef BLXO_PIXBUF_KERNELS_X86
+    case BLXO_PIXBUF_KERNELS_SSE2:
+      return __builtin_cpu_supports ("sse2") ? &kernels_sse2 : NULL;
+
+    case BLXO_PIXBUF_KERNELS_AVX2:
+      return __builtin_cpu_supports ("avx2") ? &kernels_avx2 : NULL;
+#endif
+
+    default:
+      return NULL;
+    }
+}
+
+
+
+/**
+ * _blxo_pixbuf_kernels_get:
+ *
+ * Returns the fastest kernels supported by the CPU, within
+ * the limit set by the BLXO_PIXBUF_KERNELS environment variable.
+ *
+ * Returns: the #BlxoPixbufKernels to use.
+ **/
+const BlxoPixbufKernels*
+_blxo_pixbuf_kernels_get (void)
+{
+  static const BlxoPixbufKernels *kernels = NULL;
+  static gsize                    kernels_initialized = 0;
+  const BlxoPixbufKernels        *candidate;
+  BlxoPixbufKernelsLevel          level = BLXO_PIXBUF_KERNELS_AVX2;
+  const gchar                    *limit;
+
+  if (g_once_init_enter (&kernels_initialized))
+    {
+      limit = g_getenv ("BLXO_PIXBUF_KERNELS");
+      if (G_UNLIKELY (limit != NULL))
+        {
+          if (strcmp (limit, "scalar") == 0)
+            level = BLXO_PIXBUF_KERNELS_SCALAR;
+          else if (strcmp (limit, "sse2") == 0)
+            level = BLXO_PIXBUF_KERNELS_SSE2;
+        }
+
+      /* pick the best supported kernels up to the limit */
+      for (kernels = &kernels_scalar; (gint) level > BLXO_PIXBUF_KERNELS_SCALAR; --level)
+        {
+          candidate = _blxo_pixbuf_kernels_get_for_level (level);
+          if (candidate != NULL)
+            {
+              kernels = candidate;
+              break;
+            }
+        }
+
+      g_once_init_leave (&kernels_initialized, 1);
+    }
+
+  return kernels;
+}
+
+
+
+#define __BLXO_PIXBUF_KERNELS_C__
+#include <blxo/blxo-aliasdef.c>
@@ -0,0 +1,89 @@
+/*-
+ * Copyright (c) 2026 Xfce Development Team <xfce4-dev@xfce.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#if !defined (BLXO_COMPILATION)
+#error "Only <blxo/blxo.h> can be included directly, this file is not part of the public API."
+#endif
+
+#ifndef __BLXO_PIXBUF_KERNELS_H__
+#define __BLXO_PIXBUF_KERNELS_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* number of channel entries in a kernel table, a multiple of 3, 4 and 16 */
+#define BLXO_PIXBUF_KERNEL_TABLE_SIZE (48)
+
+typedef struct _BlxoPixbufKernels BlxoPixbufKernels;
+
+/**
+ * BlxoPixbufKernelsLevel:
+ * @BLXO_PIXBUF_KERNELS_SCALAR : portable C kernels.
+ * @BLXO_PIXBUF_KERNELS_SSE2   : SSE2 kernels.
+ * @BLXO_PIXBUF_KERNELS_AVX2   : AVX2 kernels.
+ *
+ * The instruction set used by a #BlxoPixbufKernels table.
+ **/
+typedef enum
+{
+  BLXO_PIXBUF_KERNELS_SCALAR,
+  BLXO_PIXBUF_KERNELS_SSE2,
+  BLXO_PIXBUF_KERNELS_AVX2,
+} BlxoPixbufKernelsLevel;
+
+/**
+ * BlxoPixbufKernels:
+ * @level     : the #BlxoPixbufKernelsLevel of the kernels.
+ * @colorize  : sets every byte of a row to (byte * factor) >> 8, where the
+ *              factor is taken from a table of %BLXO_PIXBUF_KERNEL_TABLE_SIZE
+ *              entries, repeating from the start of the row.
+ * @spotlight : lightens every byte of a row, for which the mask table entry,
+ *              repeating from the start of the row, is 0xffff.
+ * @lucent    : writes @width RGBA pixels with their alpha scaled to percent,
+ *              reading either RGBA or RGB pixels.
+ *
+ * Row kernels for the pixbuf effects. Source and destination rows may be
+ * the same, but must not overlap otherwise.
+ **/
+struct _BlxoPixbufKernels
+{
+  BlxoPixbufKernelsLevel level;
+
+  void (*colorize)  (guchar        *dst,
+                     const guchar  *src,
+                     gint           n_bytes,
+                     const guint16 *factors);
+  void (*spotlight) (guchar        *dst,
+                     const guchar  *src,
+                     gint           n_bytes,
+                     const guint16 *mask);
+  void (*lucent)    (guchar        *dst,
+                     const guchar  *src,
+                     gint           width,
+                     gboolean       has_alpha,
+                     guint          percent);
+};
+
+G_GNUC_INTERNAL const BlxoPixbufKernels *_blxo_pixbuf_kernels_get          (void);
+G_GNUC_INTERNAL const BlxoPixbufKernels *_blxo_pixbuf_kernels_get_for_level (BlxoPixbufKernelsLevel level);
+
+G_END_DECLS
+
+#endif /* !__BLXO_PIXBUF_KERNELS_H__ */
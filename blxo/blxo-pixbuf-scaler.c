@@ -0,0 +1,343 @@
+/*-
+ * Copyright (c) 2026 Xfce Development Team <xfce4-dev@xfce.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include <blxo/blxo-pixbuf-scaler.h>
+#include <blxo/blxo-private.h>
+#include <blxo/blxo-alias.h>
+
+/* Large images are scaled down in two steps: an integer box filter first
+ * reduces the image to about twice the requested size, which is cheap and
+ * reads every source pixel only once, and the bilinear filter of gdk-pixbuf
+ * then produces the requested size from the reduced image. Both steps are
+ * split into horizontal stripes, which are processed in parallel.
+ */
+
+/* the minimum number of rows in a stripe */
+#define BLXO_PIXBUF_SCALER_MIN_STRIPE (32)
+
+/* the maximum box size, which keeps the sums in 32 bits */
+#define BLXO_PIXBUF_SCALER_MAX_BOX (64)
+
+
+
+typedef struct _BlxoPixbufScaleTask   BlxoPixbufScaleTask;
+typedef struct _BlxoPixbufScaleStripe BlxoPixbufScaleStripe;
+
+typedef void (*BlxoPixbufScaleFunc) (BlxoPixbufScaleTask *task,
+                                     gint                 y0,
+                                     gint                 y1);
+
+struct _BlxoPixbufScaleTask
+{
+  GMutex           mutex;
+  GCond            cond;
+  gint             n_pending;
+
+  const GdkPixbuf *source;
+  GdkPixbuf       *reduced;
+  GdkPixbuf       *dest;
+
+  /* the box size of the pre-reduction */
+  gint             box_width;
+  gint             box_height;
+};
+
+struct _BlxoPixbufScaleStripe
+{
+  BlxoPixbufScaleTask *task;
+  BlxoPixbufScaleFunc  func;
+  gint                 y0;
+  gint                 y1;
+};
+
+
+
+static void
+blxo_pixbuf_scale_worker (gpointer data,
+                          gpointer user_data)
+{
+  BlxoPixbufScaleStripe *stripe = data;
+  BlxoPixbufScaleTask   *task = stripe->task;
+
+  (*stripe->func) (task, stripe->y0, stripe->y1);
+
+  g_mutex_lock (&task->mutex);
+  if (--task->n_pending == 0)
+    g_cond_signal (&task->cond);
+  g_mutex_unlock (&task->mutex);
+}
+
+
+
+static GThreadPool*
+blxo_pixbuf_scale_get_pool (void)
+{
+  static GThreadPool *pool = NULL;
+  static gsize        pool_initialized = 0;
+
+  if (g_once_init_enter (&pool_initialized))
+    {
+      pool = g_thread_pool_new (blxo_pixbuf_scale_worker, NULL, g_get_num_processors (), FALSE, NULL);
+      g_once_init_leave (&pool_initialized, 1);
+    }
+
+  return pool;
+}
+
+
+
+static void
+blxo_pixbuf_scale_run (BlxoPixbufScaleTask *task,
+                       BlxoPixbufScaleFunc  func,
+                       gint                 height)
+{
+  BlxoPixbufScaleStripe *stripes;
+  GThreadPool           *pool;
+  gint                   n_stripes;
+  gint                   n;
+
+  /* one stripe per processor, the calling thread takes the first one */
+  n_stripes = CLAMP (height / BLXO_PIXBUF_SCALER_MIN_STRIPE, 1, (gint) g_get_num_processors ());
+  stripes = g_new (BlxoPixbufScaleStripe, n_stripes);
+  for (n = 0; n < n_stripes; ++n)
+    {
+      stripes[n].task = task;
+      stripes[n].func = func;
+      stripes[n].y0 = (gint64) height * n / n_stripes;
+      stripes[n].y1 = (gint64) height * (n + 1) / n_stripes;
+    }
+
+  task->n_pending = n_stripes - 1;
+  if (n_stripes > 1)
+    {
+      pool = blxo_pixbuf_scale_get_pool ();
+      for (n = 1; n < n_stripes; ++n)
+        g_thread_pool_push (pool, &stripes[n], NULL);
+    }
+
+  (*func) (task, stripes[0].y0, stripes[0].y1);
+
+  /* wait for the other stripes */
+  g_mutex_lock (&task->mutex);
+  while (task->n_pending > 0)
+    g_cond_wait (&task->cond, &task->mutex);
+  g_mutex_unlock (&task->mutex);
+
+  g_free (stripes);
+}
+
+
+
+static void
+blxo_pixbuf_scale_reduce (BlxoPixbufScaleTask *task,
+                          gint                 y0,
+                          gint                 y1)
+{
+  const guchar *src_pixels;
+  const guchar *s;
+  gboolean      has_alpha;
+  guint32      *sums;
+  guint32      *a;
+  guint32       count;
+  guchar       *dst_pixels;
+  guchar       *d;
+  gint          src_row_stride;
+  gint          dst_row_stride;
+  gint          n_channels;
+  gint          source_width;
+  gint          source_height;
+  gint          width;
+  gint          box_rows;
+  gint          sx, sy, sx1, sy0, sy1;
+  gint          x, y;
+
+  source_width = gdk_pixbuf_get_width (task->source);
+  source_height = gdk_pixbuf_get_height (task->source);
+  src_row_stride = gdk_pixbuf_get_rowstride (task->source);
+  src_pixels = gdk_pixbuf_get_pixels (task->source);
+  n_channels = gdk_pixbuf_get_n_channels (task->source);
+  has_alpha = gdk_pixbuf_get_has_alpha (task->source);
+
+  width = gdk_pixbuf_get_width (task->reduced);
+  dst_row_stride = gdk_pixbuf_get_rowstride (task->reduced);
+  dst_pixels = gdk_pixbuf_get_pixels (task->reduced);
+
+  /* the sums of the color channels, weighted by alpha, and the alpha channel */
+  sums = g_new (guint32, width * 4);
+
+  for (y = y0; y < y1; ++y)
+    {
+      memset (sums, 0, width * 4 * sizeof (*sums));
+
+      /* add up the source rows of the boxes */
+      sy0 = y * task->box_height;
+      sy1 = MIN (sy0 + task->box_height, source_height);
+      for (sy = sy0; sy < sy1; ++sy)
+        {
+          s = src_pixels + sy * src_row_stride;
+          for (a = sums, sx = 0; sx < source_width; a += 4)
+            {
+              sx1 = MIN (sx + task->box_width, source_width);
+              if (G_LIKELY (has_alpha))
+                {
+                  for (; sx < sx1; ++sx, s += n_channels)
+                    {
+                      a[0] += s[0] * s[3];
+                      a[1] += s[1] * s[3];
+                      a[2] += s[2] * s[3];
+                      a[3] += s[3];
+                    }
+                }
+              else
+                {
+                  for (; sx < sx1; ++sx, s += n_channels)
+                    {
+                      a[0] += s[0];
+                      a[1] += s[1];
+                      a[2] += s[2];
+                    }
+                }
+            }
+        }
+
+      /* average the boxes, the last ones in a row or column may be smaller */
+      box_rows = sy1 - sy0;
+      d = dst_pixels + y * dst_row_stride;
+      for (a = sums, x = 0; x < width; ++x, a += 4, d += n_channels)
+        {
+          count = (MIN ((x + 1) * task->box_width, source_width) - x * task->box_width) * box_rows;
+          if (G_LIKELY (has_alpha))
+            {
+              if (G_LIKELY (a[3] > 0))
+                {
+                  d[0] = (a[0] + a[3] / 2) / a[3];
+                  d[1] = (a[1] + a[3] / 2) / a[3];
+                  d[2] = (a[2] + a[3] / 2) / a[3];
+                  d[3] = (a[3] + count / 2) / count;
+                }
+              else
+                {
+                  d[0] = d[1] = d[2] = d[3] = 0;
+                }
+            }
+          else
+            {
+              d[0] = (a[0] + count / 2) / count;
+              d[1] = (a[1] + count / 2) / count;
+              d[2] = (a[2] + count / 2) / count;
+            }
+        }
+    }
+
+  g_free (sums);
+}
+
+
+
+static void
+blxo_pixbuf_scale_bilinear (BlxoPixbufScaleTask *task,
+                            gint                 y0,
+                            gint                 y1)
+{
+  gint dest_width = gdk_pixbuf_get_width (task->dest);
+  gint dest_height = gdk_pixbuf_get_height (task->dest);
+
+  /* gdk-pixbuf computes every pixel the same, regardless of the region being rendered */
+  gdk_pixbuf_scale (task->reduced, task->dest, 0, y0, dest_width, y1 - y0, 0.0, 0.0,
+                    (gdouble) dest_width / gdk_pixbuf_get_width (task->reduced),
+                    (gdouble) dest_height / gdk_pixbuf_get_height (task->reduced),
+                    GDK_INTERP_BILINEAR);
+}
+
+
+
+/**
+ * _blxo_pixbuf_scale:
+ * @source      : the source #GdkPixbuf.
+ * @dest_width  : the width of the result.
+ * @dest_height : the height of the result.
+ *
+ * Scales @source to @dest_width and @dest_height, like gdk_pixbuf_scale_simple()
+ * with %GDK_INTERP_BILINEAR, but scales down large images using all processors,
+ * with a box filter pre-reduction for large reduction ratios.
+ *
+ * Returns: the scaled #GdkPixbuf.
+ **/
+GdkPixbuf*
+_blxo_pixbuf_scale (const GdkPixbuf *source,
+                    gint             dest_width,
+                    gint             dest_height)
+{
+  BlxoPixbufScaleTask task;
+  gint                source_width;
+  gint                source_height;
+
+  g_return_val_if_fail (GDK_IS_PIXBUF (source), NULL);
+  g_return_val_if_fail (dest_width > 0 && dest_height > 0, NULL);
+
+  source_width = gdk_pixbuf_get_width (source);
+  source_height = gdk_pixbuf_get_height (source);
+
+  /* small images and upscaling are left to gdk-pixbuf */
+  if ((gint64) source_width * source_height < BLXO_PIXBUF_SCALER_MIN_PIXELS
+      || dest_width >= source_width || dest_height >= source_height)
+    return gdk_pixbuf_scale_simple (source, dest_width, dest_height, GDK_INTERP_BILINEAR);
+
+  memset (&task, 0, sizeof (task));
+  g_mutex_init (&task.mutex);
+  g_cond_init (&task.cond);
+  task.source = source;
+
+  /* reduce to about twice the requested size, bilinear handles the rest */
+  task.box_width = CLAMP (source_width / (2 * dest_width), 1, BLXO_PIXBUF_SCALER_MAX_BOX);
+  task.box_height = CLAMP (source_height / (2 * dest_height), 1, BLXO_PIXBUF_SCALER_MAX_BOX);
+  if (task.box_width > 1 || task.box_height > 1)
+    {
+      task.reduced = gdk_pixbuf_new (GDK_COLORSPACE_RGB, gdk_pixbuf_get_has_alpha (source), 8,
+                                     (source_width + task.box_width - 1) / task.box_width,
+                                     (source_height + task.box_height - 1) / task.box_height);
+      blxo_pixbuf_scale_run (&task, blxo_pixbuf_scale_reduce, gdk_pixbuf_get_height (task.reduced));
+    }
+  else
+    {
+      task.reduced = g_object_ref (G_OBJECT (source));
+    }
+
+  task.dest = gdk_pixbuf_new (GDK_COLORSPACE_RGB, gdk_pixbuf_get_has_alpha (source), 8, dest_width, dest_height);
+  blxo_pixbuf_scale_run (&task, blxo_pixbuf_scale_bilinear, dest_height);
+
+  g_object_unref (G_OBJECT (task.reduced));
+  g_cond_clear (&task.cond);
+  g_mutex_clear (&task.mutex);
+
+  return task.dest;
+}
+
+
+
+#define __BLXO_PIXBUF_SCALER_C__
+#include <blxo/blxo-aliasdef.c>
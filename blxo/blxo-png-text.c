@@ -0,0 +1,404 @@
+/*-
+ * Copyright (c) 2026 Xfce Development Team <xfce4-dev@xfce.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#ifdef HAVE_SYS_TYPES_H
+#include <sys/types.h>
+#endif
+
+#ifdef HAVE_ERRNO_H
+#include <errno.h>
+#endif
+#ifdef HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#include <gio/gio.h>
+
+#include <blxo/blxo-png-text.h>
+#include <blxo/blxo-private.h>
+#include <blxo/blxo-alias.h>
+
+/* use g_open() on win32 */
+#if defined(G_OS_WIN32)
+#include <glib/gstdio.h>
+#else
+#define g_open(path, mode, flags) (open ((path), (mode), (flags)))
+#endif
+
+/* _O_BINARY is required on some platforms */
+#ifndef _O_BINARY
+#define _O_BINARY 0
+#endif
+
+/* The text chunks of a PNG file are read without decoding the image, by
+ * walking the chunk headers up to the first IDAT chunk and skipping over
+ * everything but tEXt, zTXt and iTXt chunks. Writers like gdk-pixbuf put
+ * the text chunks right after the IHDR chunk, so for thumbnails this is a
+ * single read() of a few hundred bytes.
+ */
+
+/* the size of the read() calls */
+#define BLXO_PNG_TEXT_READ_SIZE (1024)
+
+/* the maximum size of text chunks that are parsed, and of their inflated text */
+#define BLXO_PNG_TEXT_MAX_LENGTH (64 * 1024)
+
+
+
+typedef struct
+{
+  gint   fd;
+  gsize  pos;
+  gsize  len;
+  guchar buffer[BLXO_PNG_TEXT_READ_SIZE];
+} PngReader;
+
+
+
+static const guchar png_signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+
+
+
+static gboolean
+png_reader_read (PngReader *reader,
+                 guchar    *data,
+                 gsize      length)
+{
+  gssize n;
+  gsize  count;
+
+  while (length > 0)
+    {
+      /* refill the buffer */
+      if (reader->pos == reader->len)
+        {
+          n = read (reader->fd, reader->buffer, sizeof (reader->buffer));
+          if (G_UNLIKELY (n < 0 && errno == EINTR))
+            continue;
+          else if (G_UNLIKELY (n <= 0))
+            return FALSE;
+
+          reader->pos = 0;
+          reader->len = n;
+        }
+
+      count = MIN (length, reader->len - reader->pos);
+      memcpy (data, reader->buffer + reader->pos, count);
+      reader->pos += count;
+      data += count;
+      length -= count;
+    }
+
+  return TRUE;
+}
+
+
+
+static gboolean
+png_reader_skip (PngReader *reader,
+                 gsize      length)
+{
+  /* skip within the buffer if possible */
+  if (length <= reader->len - reader->pos)
+    {
+      reader->pos += length;
+      return TRUE;
+    }
+
+  length -= reader->len - reader->pos;
+  reader->pos = reader->len = 0;
+
+  return (lseek (reader->fd, length, SEEK_CUR) >= 0);
+}
+
+
+
+static gchar*
+png_text_inflate (const guchar *data,
+                  gsize         length,
+                  gsize        *length_return)
+{
+  GConverterResult result;
+  GConverter      *decompressor;
+  GByteArray      *array;
+  guchar           buffer[1024];
+  gsize            bytes_read;
+  gsize            bytes_written;
+
+  decompressor = G_CONVERTER (g_zlib_decompressor_new (G_ZLIB_COMPRESSOR_FORMAT_ZLIB));
+  array = g_byte_array_new ();
+
+  do
+    {
+      result = g_converter_convert (decompressor, data, length, buffer, sizeof (buffer),
+                                    G_CONVERTER_INPUT_AT_END, &bytes_read, &bytes_written, NULL);
+      if (G_UNLIKELY (result == G_CONVERTER_ERROR))
+        break;
+
+      g_byte_array_append (array, buffer, bytes_written);
+      data += bytes_read;
+      length -= bytes_read;
+    }
+  while (result != G_CONVERTER_FINISHED && array->len <= BLXO_PNG_TEXT_MAX_LENGTH);
+
+  g_object_unref (G_OBJECT (decompressor));
+
+  /* ignore broken and overly large texts */
+  if (G_UNLIKELY (result != G_CONVERTER_FINISHED))
+    {
+      g_byte_array_free (array, TRUE);
+      return NULL;
+    }
+
+  *length_return = array->len;
+  g_byte_array_append (array, (const guchar *) "", 1);
+
+  return (gchar *) g_byte_array_free (array, FALSE);
+}
+
+
+
+static gchar*
+png_text_parse (const guchar *type,
+                const guchar *data,
+                gsize         length,
+                const gchar  *keyword)
+{
+  const guchar *end = data + length;
+  const guchar *p;
+  gchar        *inflated = NULL;
+  gchar        *value = NULL;
+  gsize         inflated_length;
+  gsize         n;
+
+  /* skip the keyword, which was already compared */
+  data += strlen (keyword) + 1;
+
+  if (memcmp (type, "tEXt", 4) == 0)
+    {
+      /* Latin-1 text */
+      value = g_convert ((const gchar *) data, end - data, "UTF-8", "ISO-8859-1", NULL, NULL, NULL);
+    }
+  else if (memcmp (type, "zTXt", 4) == 0)
+    {
+      /* compression method and compressed Latin-1 text */
+      if (data < end && *data == 0)
+        {
+          inflated = png_text_inflate (data + 1, end - data - 1, &inflated_length);
+          if (G_LIKELY (inflated != NULL))
+            value = g_convert (inflated, inflated_length, "UTF-8", "ISO-8859-1", NULL, NULL, NULL);
+        }
+    }
+  else if (end - data >= 2 && (data[0] == 0 || (data[0] == 1 && data[1] == 0)))
+    {
+      /* iTXt, skip the language tag and the translated keyword */
+      for (p = data + 2, n = 0; p < end && n < 2; ++p)
+        if (*p == '\0')
+          n++;
+
+      if (G_LIKELY (n == 2))
+        {
+          /* possibly compressed UTF-8 text */
+          if (data[0] == 1)
+            {
+              inflated = png_text_inflate (p, end - p, &inflated_length);
+              if (G_LIKELY (inflated != NULL && g_utf8_validate (inflated, inflated_length, NULL)))
+                {
+                  value = inflated;
+                  inflated = NULL;
+                }
+            }
+          else if (g_utf8_validate ((const gchar *) p, end - p, NULL))
+            {
+              value = g_strndup ((const gchar *) p, end - p);
+            }
+        }
+    }
+
+  g_free (inflated);
+
+  return value;
+}
+
+
+
+/**
+ * _blxo_png_text_read_fd:
+ * @fd       : a file descriptor of a PNG file, positioned at its start.
+ * @keys     : a %NULL-terminated array of text chunk keywords.
+ * @values   : return location for the values, one for each of the @keys.
+ * @error    : return location for errors or %NULL.
+ *
+ * Reads the text chunks of the PNG file @fd, that precede the image
+ * data, without decoding the image. For every keyword in @keys, the text
+ * of the first tEXt, zTXt or iTXt chunk with that keyword is stored as
+ * UTF-8 in the corresponding element of @values, which must be initialized
+ * to %NULL. Values of keywords not found are left %NULL; they may still be
+ * present after the image data.
+ *
+ * The caller is responsible to free the @values using g_free().
+ *
+ * The @fd is not closed, and left positioned somewhere
+ * in the file.
+ *
+ * Returns: %TRUE if @fd was read, %FALSE if it could not be read or is
+ *          not a PNG file, in which case @error is set.
+ **/
+gboolean
+_blxo_png_text_read_fd (gint                fd,
+                        const gchar * const *keys,
+                        gchar             **values,
+                        GError            **error)
+{
+  PngReader  reader;
+  guchar     header[8];
+  guchar    *data = NULL;
+  gsize      length;
+  guint      n_missing;
+  guint      n;
+  gboolean   succeed = FALSE;
+  gint       sverrno;
+
+  _blxo_return_val_if_fail (fd >= 0, FALSE);
+  _blxo_return_val_if_fail (keys != NULL && values != NULL, FALSE);
+  _blxo_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  reader.fd = fd;
+  reader.pos = reader.len = 0;
+  errno = 0;
+
+  n_missing = g_strv_length ((gchar **) keys);
+
+  /* check the signature */
+  if (png_reader_read (&reader, header, sizeof (header))
+      && memcmp (header, png_signature, sizeof (png_signature)) == 0)
+    {
+      /* walk the chunks, until all keys are found or the image data starts */
+      while (n_missing > 0)
+        {
+          if (!png_reader_read (&reader, header, sizeof (header)))
+            break;
+
+          length = ((gsize) header[0] << 24) | ((gsize) header[1] << 16) | ((gsize) header[2] << 8) | header[3];
+          if (memcmp (header + 4, "IDAT", 4) == 0 || memcmp (header + 4, "IEND", 4) == 0)
+            {
+              succeed = TRUE;
+              break;
+            }
+
+          /* skip everything but text chunks, and the CRC */
+          if ((memcmp (header + 4, "tEXt", 4) != 0 && memcmp (header + 4, "zTXt", 4) != 0
+               && memcmp (header + 4, "iTXt", 4) != 0) || length > BLXO_PNG_TEXT_MAX_LENGTH)
+            {
+              if (!png_reader_skip (&reader, length + 4))
+                break;
+              continue;
+            }
+
+          data = g_realloc (data, length + 1);
+          if (!png_reader_read (&reader, data, length) || !png_reader_skip (&reader, 4))
+            break;
+          data[length] = '\0';
+
+          /* check if the keyword, which is terminated by a nul byte, is one of the keys */
+          for (n = 0; keys[n] != NULL; ++n)
+            if (values[n] == NULL && strlen ((const gchar *) data) < length && strcmp ((const gchar *) data, keys[n]) == 0)
+              {
+                values[n] = png_text_parse (header + 4, data, length, keys[n]);
+                if (G_LIKELY (values[n] != NULL))
+                  n_missing--;
+                break;
+              }
+        }
+
+      /* all keys were found */
+      if (n_missing == 0)
+        succeed = TRUE;
+    }
+
+  if (G_UNLIKELY (!succeed))
+    {
+      /* end of file or invalid chunks if errno is not set */
+      sverrno = errno;
+      if (sverrno != 0)
+        g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (sverrno), "%s", g_strerror (sverrno));
+      else
+        g_set_error_literal (error, G_FILE_ERROR, G_FILE_ERROR_INVAL, "Not a PNG file");
+    }
+
+  g_free (data);
+
+  return succeed;
+}
+
+
+
+/**
+ * _blxo_png_text_read:
+ * @filename : the path to a PNG file.
+ * @keys     : a %NULL-terminated array of text chunk keywords.
+ * @values   : return location for the values, one for each of the @keys.
+ * @error    : return location for errors or %NULL.
+ *
+ * Like _blxo_png_text_read_fd(), but opens and closes @filename.
+ *
+ * Returns: %TRUE if @filename was read, %FALSE if it could not be read or is
+ *          not a PNG file, in which case @error is set.
+ **/
+gboolean
+_blxo_png_text_read (const gchar        *filename,
+                     const gchar * const *keys,
+                     gchar             **values,
+                     GError            **error)
+{
+  gboolean succeed;
+  gint     fd;
+
+  _blxo_return_val_if_fail (filename != NULL, FALSE);
+  _blxo_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  /* try to open the file for reading */
+  fd = g_open (filename, _O_BINARY | O_RDONLY, 0000);
+  if (G_UNLIKELY (fd < 0))
+    {
+      g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errno), "%s", g_strerror (errno));
+      return FALSE;
+    }
+
+  succeed = _blxo_png_text_read_fd (fd, keys, values, error);
+  close (fd);
+
+  return succeed;
+}
+
+
+
+#define __BLXO_PNG_TEXT_C__
+#include <blxo/blxo-aliasdef.c>
@@ -0,0 +1,44 @@
+/*-
+ * Copyright (c) 2026 Xfce Development Team <xfce4-dev@xfce.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+
+#if !defined (BLXO_COMPILATION)
+#error "Only <blxo/blxo.h> can be included directly, this file is not part of the public API."
+#endif
+
+#ifndef __BLXO_PNG_TEXT_H__
+#define __BLXO_PNG_TEXT_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+G_GNUC_INTERNAL gboolean _blxo_png_text_read_fd (gint                fd,
+                                                 const gchar * const *keys,
+                                                 gchar             **values,
+                                                 GError            **error);
+
+G_GNUC_INTERNAL gboolean _blxo_png_text_read    (const gchar        *filename,
+                                                 const gchar * const *keys,
+                                                 gchar             **values,
+                                                 GError            **error);
+
+G_END_DECLS
+
+#endif /* !__BLXO_PNG_TEXT_H__ */
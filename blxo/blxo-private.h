@@ -72,6 +72,20 @@ G_GNUC_INTERNAL void  _blxo_i18n_init                    (void);
 G_GNUC_INTERNAL void  _blxo_gtk_widget_send_focus_change (GtkWidget         *widget,
                                                          gboolean           in);
 
+G_GNUC_INTERNAL void  _blxo_cell_renderer_icon_prefetch  (GtkCellRenderer   *renderer,
+                                                         GtkWidget         *widget);
+
+G_GNUC_INTERNAL GdkPixbuf *_blxo_gdk_pixbuf_new_recycled (gboolean          has_alpha,
+                                                        gint              width,
+                                                        gint              height) G_GNUC_MALLOC G_GNUC_WARN_UNUSED_RESULT;
+
+G_GNUC_INTERNAL GdkPixbuf *_blxo_gdk_pixbuf_new_from_file_at_max_size_full (const gchar *filename,
+                                                                           gint         max_width,
+                                                                           gint         max_height,
+                                                                           gboolean     preserve_aspect_ratio,
+                                                                           gboolean     use_previews,
+                                                                           GError     **error) G_GNUC_MALLOC G_GNUC_WARN_UNUSED_RESULT;
+
 G_END_DECLS
 
 #endif /* !__BLXO_PRIVATE_H__ */
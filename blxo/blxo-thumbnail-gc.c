@@ -0,0 +1,509 @@
+/*-
+ * Copyright (c) 2026 Xfce Development Team <xfce4-dev@xfce.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+
+/* for O_NOATIME */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#ifdef HAVE_SYS_TYPES_H
+#include <sys/types.h>
+#endif
+#ifdef HAVE_SYS_STAT_H
+#include <sys/stat.h>
+#endif
+
+#ifdef HAVE_ERRNO_H
+#include <errno.h>
+#endif
+#ifdef HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+#ifdef HAVE_TIME_H
+#include <time.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#include <glib/gstdio.h>
+
+#include <blxo/blxo-png-text.h>
+#include <blxo/blxo-thumbnail-gc.h>
+#include <blxo/blxo-alias.h>
+
+/**
+ * SECTION: blxo-thumbnail-gc
+ * @title: Thumbnail Cache Maintenance
+ * @short_description: Remove stale thumbnails and limit the size of the thumbnail cache
+ * @include: blxo/blxo.h
+ *
+ * Nothing in the thumbnail specification ever removes thumbnails, so the
+ * thumbnail cache grows without bound. blxo_thumbnail_gc() removes the
+ * thumbnails whose source file no longer exists or was modified, and then
+ * the least recently accessed thumbnails until the cache fits a size budget.
+ *
+ * Only the text chunks at the start of the thumbnails are read, and the
+ * buckets are examined by a pool of threads. The files are opened with
+ * O_NOATIME where available, so that the scan does not disturb the access
+ * times used for the eviction order.
+ **/
+
+/* _O_BINARY is required on some platforms */
+#ifndef _O_BINARY
+#define _O_BINARY 0
+#endif
+#ifndef O_NOATIME
+#define O_NOATIME 0
+#endif
+#ifndef O_NOFOLLOW
+#define O_NOFOLLOW 0
+#endif
+#ifndef O_NONBLOCK
+#define O_NONBLOCK 0
+#endif
+
+/* the number of files in a job of the thread pool */
+#define BLXO_THUMBNAIL_GC_CHUNK_SIZE (256)
+
+/* seconds before temporary and broken thumbnails are considered leftovers
+ * of an interrupted save, instead of one still in progress */
+#define BLXO_THUMBNAIL_GC_GRACE_PERIOD (60 * 60)
+
+
+
+typedef struct _BlxoThumbnailGc      BlxoThumbnailGc;
+typedef struct _BlxoThumbnailGcChunk BlxoThumbnailGcChunk;
+typedef struct _BlxoThumbnailGcEntry BlxoThumbnailGcEntry;
+
+
+
+static gboolean blxo_thumbnail_gc_is_temp  (const gchar           *name);
+static gboolean blxo_thumbnail_gc_is_stale (const gchar           *thumbnail_uri,
+                                           const gchar           *thumbnail_mtime);
+static void     blxo_thumbnail_gc_check    (BlxoThumbnailGc       *gc,
+                                           const gchar           *dirname,
+                                           const gchar           *name,
+                                           GArray                *entries,
+                                           BlxoThumbnailGcStats  *stats);
+static void     blxo_thumbnail_gc_worker   (gpointer               data,
+                                           gpointer               user_data);
+static void     blxo_thumbnail_gc_scan     (BlxoThumbnailGc       *gc,
+                                           GThreadPool           *pool,
+                                           const gchar           *dirname);
+static gint     blxo_thumbnail_gc_compare  (gconstpointer          a,
+                                           gconstpointer          b);
+
+
+
+struct _BlxoThumbnailGc
+{
+  GCancellable        *cancellable;
+  gboolean             dry_run;
+  time_t               now;
+
+  /* protected by the mutex */
+  GMutex               mutex;
+  GArray              *entries;
+  BlxoThumbnailGcStats stats;
+};
+
+struct _BlxoThumbnailGcChunk
+{
+  gchar     *dirname;
+  GPtrArray *names;
+};
+
+struct _BlxoThumbnailGcEntry
+{
+  gchar   *path;
+  guint64  n_bytes;
+  time_t   atime;
+};
+
+
+
+static gboolean
+blxo_thumbnail_gc_is_temp (const gchar *name)
+{
+  guint n;
+
+  /* thumbnails are saved to "<md5>.png.XXXXXX" and renamed once complete */
+  if (strlen (name) != 32 + 5 + 6)
+    return FALSE;
+
+  for (n = 0; n < 32; ++n)
+    if (!g_ascii_isxdigit (name[n]))
+      return FALSE;
+
+  if (strncmp (name + 32, ".png.", 5) != 0)
+    return FALSE;
+
+  for (n = 32 + 5; name[n] != '\0'; ++n)
+    if (!g_ascii_isalnum (name[n]))
+      return FALSE;
+
+  return TRUE;
+}
+
+
+
+static gboolean
+blxo_thumbnail_gc_is_stale (const gchar *thumbnail_uri,
+                            const gchar *thumbnail_mtime)
+{
+  struct stat statb;
+  gboolean    stale = FALSE;
+  gchar      *filename;
+
+  /* the existence of other than local files cannot be checked cheaply, keep them */
+  filename = g_filename_from_uri (thumbnail_uri, NULL, NULL);
+  if (G_UNLIKELY (filename == NULL))
+    return FALSE;
+
+  /* the source is gone, or was modified after the thumbnail was generated */
+  if (g_stat (filename, &statb) < 0)
+    stale = (errno == ENOENT || errno == ENOTDIR);
+  else
+    stale = (strtoul (thumbnail_mtime, NULL, 10) != (gulong) statb.st_mtime);
+
+  g_free (filename);
+
+  return stale;
+}
+
+
+
+static void
+blxo_thumbnail_gc_check (BlxoThumbnailGc      *gc,
+                         const gchar          *dirname,
+                         const gchar          *name,
+                         GArray               *entries,
+                         BlxoThumbnailGcStats *stats)
+{
+  static const gchar   *keys[] = { "Thumb::URI", "Thumb::MTime", NULL };
+  BlxoThumbnailGcEntry  entry;
+  struct stat           statb;
+  gboolean              stale = FALSE;
+  GError               *error = NULL;
+  gchar                *values[2] = { NULL, NULL };
+  gchar                *path;
+  gboolean              is_temp;
+  gint                  fd;
+
+  /* leave alone everything that was not written by a thumbnailer */
+  is_temp = blxo_thumbnail_gc_is_temp (name);
+  if (!is_temp && !g_str_has_suffix (name, ".png"))
+    return;
+
+  path = g_build_filename (dirname, name, NULL);
+
+  /* open without updating the access time, which is not permitted for files of other users */
+  fd = g_open (path, _O_BINARY | O_RDONLY | O_NOATIME | O_NOFOLLOW | O_NONBLOCK, 0000);
+  if (G_UNLIKELY (fd < 0 && errno == EPERM && O_NOATIME != 0))
+    fd = g_open (path, _O_BINARY | O_RDONLY | O_NOFOLLOW | O_NONBLOCK, 0000);
+  if (G_UNLIKELY (fd < 0))
+    {
+      g_free (path);
+      return;
+    }
+
+  /* skip everything but regular files */
+  if (fstat (fd, &statb) < 0 || !S_ISREG (statb.st_mode))
+    {
+      close (fd);
+      g_free (path);
+      return;
+    }
+
+  stats->n_scanned += 1;
+
+  if (is_temp)
+    {
+      /* temporary files of interrupted saves */
+      stale = (statb.st_mtime + BLXO_THUMBNAIL_GC_GRACE_PERIOD < gc->now);
+    }
+  else if (_blxo_png_text_read_fd (fd, keys, values, &error))
+    {
+      /* without both keys at the start, the thumbnail is left to the size budget */
+      if (G_LIKELY (values[0] != NULL && values[1] != NULL))
+        stale = blxo_thumbnail_gc_is_stale (values[0], values[1]);
+    }
+  else
+    {
+      /* remove broken thumbnails, unless they may still be written to */
+      stale = (g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_INVAL)
+               && statb.st_mtime + BLXO_THUMBNAIL_GC_GRACE_PERIOD < gc->now);
+      g_error_free (error);
+    }
+
+  close (fd);
+  g_free (values[0]);
+  g_free (values[1]);
+
+  if (G_UNLIKELY (stale))
+    {
+      if (gc->dry_run || g_unlink (path) == 0)
+        {
+          stats->n_stale += 1;
+          stats->n_bytes_reclaimed += statb.st_size;
+        }
+      g_free (path);
+    }
+  else
+    {
+      /* remember the thumbnail for the eviction */
+      entry.path = path;
+      entry.n_bytes = statb.st_size;
+      entry.atime = statb.st_atime;
+      g_array_append_val (entries, entry);
+    }
+}
+
+
+
+static void
+blxo_thumbnail_gc_worker (gpointer data,
+                          gpointer user_data)
+{
+  BlxoThumbnailGcStats  stats = { 0, };
+  BlxoThumbnailGcChunk *chunk = data;
+  BlxoThumbnailGc      *gc = user_data;
+  GArray               *entries;
+  guint                 n;
+
+  entries = g_array_sized_new (FALSE, FALSE, sizeof (BlxoThumbnailGcEntry), chunk->names->len);
+
+  for (n = 0; n < chunk->names->len; ++n)
+    {
+      if (g_cancellable_is_cancelled (gc->cancellable))
+        break;
+
+      blxo_thumbnail_gc_check (gc, chunk->dirname, g_ptr_array_index (chunk->names, n), entries, &stats);
+    }
+
+  /* merge the results of the chunk */
+  g_mutex_lock (&gc->mutex);
+  g_array_append_vals (gc->entries, entries->data, entries->len);
+  gc->stats.n_scanned += stats.n_scanned;
+  gc->stats.n_stale += stats.n_stale;
+  gc->stats.n_bytes_reclaimed += stats.n_bytes_reclaimed;
+  g_mutex_unlock (&gc->mutex);
+
+  g_array_free (entries, TRUE);
+  g_ptr_array_free (chunk->names, TRUE);
+  g_free (chunk->dirname);
+  g_slice_free (BlxoThumbnailGcChunk, chunk);
+}
+
+
+
+static void
+blxo_thumbnail_gc_scan (BlxoThumbnailGc *gc,
+                        GThreadPool     *pool,
+                        const gchar     *dirname)
+{
+  BlxoThumbnailGcChunk *chunk = NULL;
+  const gchar          *name;
+  GDir                 *dp;
+
+  /* buckets that were never used do not exist */
+  dp = g_dir_open (dirname, 0, NULL);
+  if (G_UNLIKELY (dp == NULL))
+    return;
+
+  /* listing the directory is cheap, the files are examined in chunks by the pool */
+  while ((name = g_dir_read_name (dp)) != NULL && !g_cancellable_is_cancelled (gc->cancellable))
+    {
+      if (chunk == NULL)
+        {
+          chunk = g_slice_new (BlxoThumbnailGcChunk);
+          chunk->dirname = g_strdup (dirname);
+          chunk->names = g_ptr_array_new_full (BLXO_THUMBNAIL_GC_CHUNK_SIZE, g_free);
+        }
+
+      g_ptr_array_add (chunk->names, g_strdup (name));
+
+      if (chunk->names->len == BLXO_THUMBNAIL_GC_CHUNK_SIZE)
+        {
+          g_thread_pool_push (pool, chunk, NULL);
+          chunk = NULL;
+        }
+    }
+
+  if (chunk != NULL)
+    g_thread_pool_push (pool, chunk, NULL);
+
+  g_dir_close (dp);
+}
+
+
+
+static gint
+blxo_thumbnail_gc_compare (gconstpointer a,
+                           gconstpointer b)
+{
+  const BlxoThumbnailGcEntry *entry_a = a;
+  const BlxoThumbnailGcEntry *entry_b = b;
+
+  /* least recently accessed first */
+  return (entry_a->atime < entry_b->atime) ? -1 : (entry_a->atime > entry_b->atime);
+}
+
+
+
+/**
+ * blxo_thumbnail_gc:
+ * @max_bytes   : the maximum size of the thumbnail cache in bytes, or 0 to
+ *                only remove stale thumbnails.
+ * @dry_run     : %TRUE to only report what would be removed.
+ * @stats       : return location for the statistics of the run or %NULL.
+ * @cancellable : a #GCancellable or %NULL.
+ * @error       : return location for errors or %NULL.
+ *
+ * Removes the thumbnails of the user's thumbnail cache, including the
+ * failure markers, whose local source file no longer exists or was
+ * modified after the thumbnail was generated. Thumbnails of remote files
+ * are kept.
+ *
+ * If the remaining thumbnails are larger than @max_bytes in total, the
+ * thumbnails that were accessed least recently are removed until the
+ * cache fits.
+ *
+ * Only thumbnails and the temporary files of interrupted saves are
+ * considered, other files and symbolic links in the cache are left alone.
+ *
+ * Thumbnails that could not be removed are silently skipped. The @stats
+ * are filled in even if the run was cancelled.
+ *
+ * Returns: %TRUE on success, %FALSE if @cancellable was cancelled, in
+ *          which case @error is set.
+ *
+ * Since: 0.13.0
+ **/
+gboolean
+blxo_thumbnail_gc (guint64               max_bytes,
+                   gboolean              dry_run,
+                   BlxoThumbnailGcStats *stats,
+                   GCancellable         *cancellable,
+                   GError              **error)
+{
+  static const gchar   *buckets[] = { "normal", "large", "x-large", "xx-large" };
+  BlxoThumbnailGcEntry *entry;
+  BlxoThumbnailGc       gc;
+  struct stat           statb;
+  GThreadPool          *pool;
+  const gchar          *name;
+  guint64               n_bytes = 0;
+  gchar                *dirname;
+  gchar                *path;
+  gchar                *root;
+  GDir                 *dp;
+  guint                 n;
+
+  g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  memset (&gc, 0, sizeof (gc));
+  gc.cancellable = cancellable;
+  gc.dry_run = dry_run;
+  gc.now = time (NULL);
+  gc.entries = g_array_new (FALSE, FALSE, sizeof (BlxoThumbnailGcEntry));
+  g_mutex_init (&gc.mutex);
+
+  /* the work is mostly waiting for the disk, so use at least two threads */
+  pool = g_thread_pool_new (blxo_thumbnail_gc_worker, &gc, MAX (g_get_num_processors (), 2), FALSE, NULL);
+
+  root = g_build_filename (g_get_user_cache_dir (), "thumbnails", NULL);
+
+  for (n = 0; n < G_N_ELEMENTS (buckets); ++n)
+    {
+      dirname = g_build_filename (root, buckets[n], NULL);
+      blxo_thumbnail_gc_scan (&gc, pool, dirname);
+      g_free (dirname);
+    }
+
+  /* the failure markers of all applications */
+  dirname = g_build_filename (root, "fail", NULL);
+  dp = g_dir_open (dirname, 0, NULL);
+  if (G_LIKELY (dp != NULL))
+    {
+      while ((name = g_dir_read_name (dp)) != NULL)
+        {
+          /* only descend into real directories, never follow symlinks out of the cache */
+          path = g_build_filename (dirname, name, NULL);
+          if (g_lstat (path, &statb) == 0 && S_ISDIR (statb.st_mode))
+            blxo_thumbnail_gc_scan (&gc, pool, path);
+          g_free (path);
+        }
+      g_dir_close (dp);
+    }
+  g_free (dirname);
+  g_free (root);
+
+  /* wait for the scan to finish */
+  g_thread_pool_free (pool, FALSE, TRUE);
+
+  for (n = 0; n < gc.entries->len; ++n)
+    n_bytes += g_array_index (gc.entries, BlxoThumbnailGcEntry, n).n_bytes;
+
+  /* evict the least recently accessed thumbnails until the budget is met */
+  if (max_bytes > 0 && n_bytes > max_bytes && !g_cancellable_is_cancelled (cancellable))
+    {
+      g_array_sort (gc.entries, blxo_thumbnail_gc_compare);
+
+      for (n = 0; n < gc.entries->len && n_bytes > max_bytes; ++n)
+        {
+          entry = &g_array_index (gc.entries, BlxoThumbnailGcEntry, n);
+          if (dry_run || g_unlink (entry->path) == 0)
+            {
+              gc.stats.n_evicted += 1;
+              gc.stats.n_bytes_reclaimed += entry->n_bytes;
+              n_bytes -= entry->n_bytes;
+            }
+        }
+    }
+
+  gc.stats.n_bytes_remaining = n_bytes;
+  if (stats != NULL)
+    *stats = gc.stats;
+
+  for (n = 0; n < gc.entries->len; ++n)
+    g_free (g_array_index (gc.entries, BlxoThumbnailGcEntry, n).path);
+  g_array_free (gc.entries, TRUE);
+  g_mutex_clear (&gc.mutex);
+
+  return !g_cancellable_set_error_if_cancelled (cancellable, error);
+}
+
+
+
+#define __BLXO_THUMBNAIL_GC_C__
+#include <blxo/blxo-aliasdef.c>
@@ -0,0 +1,65 @@
+/*-
+ * Copyright (c) 2026 Xfce Development Team <xfce4-dev@xfce.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+
+#if !defined (BLXO_INSIDE_BLXO_H) && !defined (BLXO_COMPILATION)
+#error "Only <blxo/blxo.h> can be included directly, this file may disappear or change contents."
+#endif
+
+#ifndef __BLXO_THUMBNAIL_GC_H__
+#define __BLXO_THUMBNAIL_GC_H__
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+typedef struct _BlxoThumbnailGcStats BlxoThumbnailGcStats;
+
+/**
+ * BlxoThumbnailGcStats:
+ * @n_scanned         : the number of thumbnails examined.
+ * @n_stale           : the number of thumbnails removed, because their source
+ *                      file is gone or was modified.
+ * @n_evicted         : the number of thumbnails removed to enforce the size
+ *                      budget.
+ * @n_bytes_reclaimed : the number of bytes freed by removing thumbnails.
+ * @n_bytes_remaining : the size of the thumbnails left in the cache.
+ *
+ * Statistics about a run of blxo_thumbnail_gc().
+ *
+ * Since: 0.13.0
+ **/
+struct _BlxoThumbnailGcStats
+{
+  guint   n_scanned;
+  guint   n_stale;
+  guint   n_evicted;
+  guint64 n_bytes_reclaimed;
+  guint64 n_bytes_remaining;
+};
+
+gboolean blxo_thumbnail_gc (guint64               max_bytes,
+                            gboolean              dry_run,
+                            BlxoThumbnailGcStats *stats,
+                            GCancellable         *cancellable,
+                            GError              **error);
+
+G_END_DECLS
+
+#endif /* !__BLXO_THUMBNAIL_GC_H__ */
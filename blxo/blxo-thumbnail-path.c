@@ -0,0 +1,289 @@
+/*-
+ * Copyright (c) 2005-2006 Benedikt Meurer <benny@xfce.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include <blxo/blxo-private.h>
+#include <blxo/blxo-thumbnail-path.h>
+#include <blxo/blxo-alias.h>
+
+/* the length of the thumbnail file names, a hex MD5 digest and .png */
+#define BLXO_THUMBNAIL_NAME_LENGTH (32 + 4)
+
+/* the index of the failure marker directory in BlxoThumbnailPathBuilder */
+#define BLXO_THUMBNAIL_FAIL_INDEX (4)
+
+/* the directory of the failure markers, below thumbnails/fail/ */
+#define BLXO_THUMBNAIL_FAIL_DIR "blxo-" PACKAGE_VERSION
+
+
+
+struct _BlxoThumbnailPathBuilder
+{
+  GChecksum *checksum;
+
+  /* the directories of the sizes and of the failure markers, with a trailing slash */
+  gchar     *prefixes[5];
+  gsize      prefix_lengths[5];
+
+  /* the path returned by _blxo_thumbnail_path_builder_build() */
+  gchar     *buffer;
+};
+
+
+
+static const gchar*
+blxo_thumbnail_size_get_dir (BlxoThumbnailSize size)
+{
+  switch (size)
+    {
+    case BLXO_THUMBNAIL_SIZE_NORMAL:
+      return "normal";
+
+    case BLXO_THUMBNAIL_SIZE_LARGE:
+      return "large";
+
+    case BLXO_THUMBNAIL_SIZE_X_LARGE:
+      return "x-large";
+
+    default:
+      return "xx-large";
+    }
+}
+
+
+
+static guint
+blxo_thumbnail_size_get_index (BlxoThumbnailSize size)
+{
+  switch (size)
+    {
+    case BLXO_THUMBNAIL_SIZE_NORMAL:
+      return 0;
+
+    case BLXO_THUMBNAIL_SIZE_LARGE:
+      return 1;
+
+    case BLXO_THUMBNAIL_SIZE_X_LARGE:
+      return 2;
+
+    default:
+      return 3;
+    }
+}
+
+
+
+static void
+blxo_thumbnail_path_builder_write (BlxoThumbnailPathBuilder *builder,
+                                  const gchar              *uri,
+                                  guint                     index,
+                                  gchar                    *path)
+{
+  static const gchar hex_digits[] = "0123456789abcdef";
+  guint8             digest[16];
+  gsize              digest_len = sizeof (digest);
+  guint              n;
+
+  /* the checksum is reused, so hashing does not allocate */
+  g_checksum_reset (builder->checksum);
+  g_checksum_update (builder->checksum, (const guchar *) uri, -1);
+  g_checksum_get_digest (builder->checksum, digest, &digest_len);
+
+  /* the directory, the hex digest and the suffix */
+  memcpy (path, builder->prefixes[index], builder->prefix_lengths[index]);
+  path += builder->prefix_lengths[index];
+  for (n = 0; n < sizeof (digest); ++n)
+    {
+      *path++ = hex_digits[digest[n] >> 4];
+      *path++ = hex_digits[digest[n] & 0x0f];
+    }
+  memcpy (path, ".png", sizeof (".png"));
+}
+
+
+
+static const gchar*
+blxo_thumbnail_path_builder_build_index (BlxoThumbnailPathBuilder *builder,
+                                        const gchar              *uri,
+                                        guint                     index)
+{
+  blxo_thumbnail_path_builder_write (builder, uri, index, builder->buffer);
+  return builder->buffer;
+}
+
+
+
+/**
+ * _blxo_thumbnail_path_builder_get_default:
+ *
+ * Returns the #BlxoThumbnailPathBuilder of the calling thread, which
+ * is freed when the thread exits.
+ *
+ * Returns: the #BlxoThumbnailPathBuilder of the calling thread.
+ **/
+BlxoThumbnailPathBuilder*
+_blxo_thumbnail_path_builder_get_default (void)
+{
+  static GPrivate           builders = G_PRIVATE_INIT ((GDestroyNotify) _blxo_thumbnail_path_builder_free);
+  BlxoThumbnailPathBuilder *builder;
+
+  /* the builders are not thread-safe, so every thread gets its own */
+  builder = g_private_get (&builders);
+  if (G_UNLIKELY (builder == NULL))
+    {
+      builder = _blxo_thumbnail_path_builder_new ();
+      g_private_set (&builders, builder);
+    }
+
+  return builder;
+}
+
+
+
+/**
+ * _blxo_thumbnail_path_builder_new:
+ *
+ * Allocates a new #BlxoThumbnailPathBuilder, which determines the paths of
+ * thumbnails in the thumbnail database without allocating memory for each
+ * path. The directories of the thumbnail sizes are determined once, and the
+ * file names are hashed with a reused checksum.
+ *
+ * A #BlxoThumbnailPathBuilder must only be used by one thread at a time.
+ *
+ * Returns: the newly allocated #BlxoThumbnailPathBuilder, to be freed
+ *          with _blxo_thumbnail_path_builder_free().
+ **/
+BlxoThumbnailPathBuilder*
+_blxo_thumbnail_path_builder_new (void)
+{
+  static const BlxoThumbnailSize sizes[] =
+  {
+    BLXO_THUMBNAIL_SIZE_NORMAL,
+    BLXO_THUMBNAIL_SIZE_LARGE,
+    BLXO_THUMBNAIL_SIZE_X_LARGE,
+    BLXO_THUMBNAIL_SIZE_XX_LARGE,
+  };
+  BlxoThumbnailPathBuilder      *builder;
+  gchar                         *dirname;
+  gsize                          max_length = 0;
+  guint                          n;
+
+  builder = g_slice_new (BlxoThumbnailPathBuilder);
+  builder->checksum = g_checksum_new (G_CHECKSUM_MD5);
+
+  /* the directories of the sizes, in the order of blxo_thumbnail_size_get_index(), and of the failure markers */
+  for (n = 0; n < G_N_ELEMENTS (sizes); ++n)
+    {
+      dirname = g_build_path ("/", g_get_user_cache_dir (), "thumbnails", blxo_thumbnail_size_get_dir (sizes[n]), NULL);
+      builder->prefixes[n] = g_strconcat (dirname, "/", NULL);
+      g_free (dirname);
+    }
+  dirname = g_build_path ("/", g_get_user_cache_dir (), "thumbnails", "fail", BLXO_THUMBNAIL_FAIL_DIR, NULL);
+  builder->prefixes[BLXO_THUMBNAIL_FAIL_INDEX] = g_strconcat (dirname, "/", NULL);
+  g_free (dirname);
+
+  for (n = 0; n < G_N_ELEMENTS (builder->prefixes); ++n)
+    {
+      builder->prefix_lengths[n] = strlen (builder->prefixes[n]);
+      max_length = MAX (max_length, builder->prefix_lengths[n]);
+    }
+
+  builder->buffer = g_malloc (max_length + BLXO_THUMBNAIL_NAME_LENGTH + 1);
+
+  return builder;
+}
+
+
+
+/**
+ * _blxo_thumbnail_path_builder_free:
+ * @builder : a #BlxoThumbnailPathBuilder.
+ *
+ * Frees the @builder.
+ **/
+void
+_blxo_thumbnail_path_builder_free (BlxoThumbnailPathBuilder *builder)
+{
+  guint n;
+
+  for (n = 0; n < G_N_ELEMENTS (builder->prefixes); ++n)
+    g_free (builder->prefixes[n]);
+  g_checksum_free (builder->checksum);
+  g_free (builder->buffer);
+  g_slice_free (BlxoThumbnailPathBuilder, builder);
+}
+
+
+
+/**
+ * _blxo_thumbnail_path_builder_build:
+ * @builder : a #BlxoThumbnailPathBuilder.
+ * @uri     : the URI of a file.
+ * @size    : the #BlxoThumbnailSize.
+ *
+ * Determines the path of the thumbnail for @uri at @size.
+ *
+ * Returns: the path, which is owned by the @builder and only valid until
+ *          the next call to _blxo_thumbnail_path_builder_build().
+ **/
+const gchar*
+_blxo_thumbnail_path_builder_build (BlxoThumbnailPathBuilder *builder,
+                                   const gchar              *uri,
+                                   BlxoThumbnailSize          size)
+{
+  _blxo_return_val_if_fail (builder != NULL, NULL);
+  _blxo_return_val_if_fail (uri != NULL, NULL);
+
+  return blxo_thumbnail_path_builder_build_index (builder, uri, blxo_thumbnail_size_get_index (size));
+}
+
+
+
+/**
+ * _blxo_thumbnail_path_builder_build_failure:
+ * @builder : a #BlxoThumbnailPathBuilder.
+ * @uri     : the URI of a file.
+ *
+ * Determines the path of the marker, that records that no thumbnail
+ * could be generated for @uri.
+ *
+ * Returns: the path, which is owned by the @builder and only valid until
+ *          the next call to _blxo_thumbnail_path_builder_build().
+ **/
+const gchar*
+_blxo_thumbnail_path_builder_build_failure (BlxoThumbnailPathBuilder *builder,
+                                            const gchar              *uri)
+{
+  _blxo_return_val_if_fail (builder != NULL, NULL);
+  _blxo_return_val_if_fail (uri != NULL, NULL);
+
+  return blxo_thumbnail_path_builder_build_index (builder, uri, BLXO_THUMBNAIL_FAIL_INDEX);
+}
+
+
+
+#define __BLXO_THUMBNAIL_PATH_C__
+#include <blxo/blxo-aliasdef.c>
@@ -0,0 +1,44 @@
+/*-
+ * Copyright (c) 2005-2006 Benedikt Meurer <benny@xfce.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#if !defined (BLXO_COMPILATION)
+#error "Only <blxo/blxo.h> can be included directly, this file is not part of the public API."
+#endif
+
+#ifndef __BLXO_THUMBNAIL_PATH_H__
+#define __BLXO_THUMBNAIL_PATH_H__
+
+#include <blxo/blxo-thumbnail.h>
+
+G_BEGIN_DECLS
+
+typedef struct _BlxoThumbnailPathBuilder BlxoThumbnailPathBuilder;
+
+G_GNUC_INTERNAL BlxoThumbnailPathBuilder *_blxo_thumbnail_path_builder_new           (void) G_GNUC_MALLOC;
+G_GNUC_INTERNAL void                      _blxo_thumbnail_path_builder_free          (BlxoThumbnailPathBuilder *builder);
+G_GNUC_INTERNAL BlxoThumbnailPathBuilder *_blxo_thumbnail_path_builder_get_default   (void);
+G_GNUC_INTERNAL const gchar              *_blxo_thumbnail_path_builder_build         (BlxoThumbnailPathBuilder *builder,
+                                                                                     const gchar              *uri,
+                                                                                     BlxoThumbnailSize          size);
+G_GNUC_INTERNAL const gchar              *_blxo_thumbnail_path_builder_build_failure (BlxoThumbnailPathBuilder *builder,
+                                                                                     const gchar              *uri);
+
+G_END_DECLS
+
+#endif /* !__BLXO_THUMBNAIL_PATH_H__ */
@@ -28,6 +28,9 @@
 #include <sys/stat.h>
 #endif
 
+#ifdef HAVE_ERRNO_H
+#include <errno.h>
+#endif
 #ifdef HAVE_MEMORY_H
 #include <memory.h>
 #endif
@@ -35,16 +38,40 @@
 #include <string.h>
 #endif
 
+#include <gio/gio.h>
+
 #include <blxo/blxo-gdk-pixbuf-extensions.h>
 #include <blxo/blxo-private.h>
 #include <blxo/blxo-thumbnail-preview.h>
+#include <blxo/blxo-thumbnail-queue.h>
 #include <blxo/blxo-thumbnail.h>
 #include <blxo/blxo-utils.h>
 #include <blxo/blxo-alias.h>
 #include <blxo/blxo-string.h>
 
+/* The preview is updated once the selection did not change for a short
+ * while, so arrowing through a folder only loads the thumbnail of the file
+ * the user stops at. Thumbnails of local files are loaded by the thumbnail
+ * queue, superseded loads are cancelled, and the thumbnails of the image
+ * files before and after the previewed file are prefetched, in the order
+ * the file chooser sorts them by default. The file is stat()ed, the folder
+ * is listed and thumbnails of remote files are loaded on worker threads, so
+ * even large or remote folders do not block the main loop.
+ */
+
+/* milliseconds the selection has to settle before the preview is updated */
+#define BLXO_THUMBNAIL_PREVIEW_DELAY (50)
+
 
 
+typedef struct _BlxoThumbnailPreviewInfo    BlxoThumbnailPreviewInfo;
+typedef struct _BlxoThumbnailPreviewSibling BlxoThumbnailPreviewSibling;
+typedef struct _BlxoThumbnailPreviewListing BlxoThumbnailPreviewListing;
+
+
+
+static void blxo_thumbnail_preview_dispose   (GObject             *object);
+static void blxo_thumbnail_preview_finalize  (GObject             *object);
 static void blxo_thumbnail_preview_style_set (GtkWidget           *ebox,
                                              GtkStyle            *previous_style,
                                              BlxoThumbnailPreview *thumbnail_preview);
@@ -58,10 +85,60 @@ struct _BlxoThumbnailPreviewClass
 
 struct _BlxoThumbnailPreview
 {
-  GtkFrame   __parent__;
-  GtkWidget *image;
-  GtkWidget *name_label;
-  GtkWidget *size_label;
+  GtkFrame      __parent__;
+  GtkWidget    *image;
+  GtkWidget    *name_label;
+  GtkWidget    *size_label;
+
+  /* the URI to preview once the selection settled */
+  gchar        *uri;
+  guint         update_id;
+
+  /* the queued thumbnail of the previewed file, and of its neighbours */
+  guint         load_handle;
+  guint         prefetch_batch;
+
+  /* the image files in the folder of the previewed file, sorted by key */
+  gchar        *folder;
+  time_t        folder_mtime;
+  GArray       *siblings;
+
+  /* cancels the queries and the listing for the previewed file */
+  GCancellable *cancellable;
+};
+
+struct _BlxoThumbnailPreviewInfo
+{
+  /* the URI to query, and its local file or %NULL */
+  gchar     *uri;
+  gchar     *filename;
+
+  /* the icon for anything but regular files, and the size label */
+  gchar     *icon_name;
+  gchar     *size_name;
+
+  /* the existing thumbnail of a remote file */
+  GdkPixbuf *thumbnail;
+};
+
+struct _BlxoThumbnailPreviewSibling
+{
+  gchar *key;
+  gchar *filename;
+};
+
+struct _BlxoThumbnailPreviewListing
+{
+  /* the URI and the file to prefetch the neighbours of */
+  gchar  *uri;
+  gchar  *filename;
+
+  /* the folder to list, and the mtime of the listing we have or -1 */
+  gchar  *folder;
+  time_t  mtime;
+
+  /* the new listing, or %NULL if the folder did not change */
+  GArray *siblings;
 };
 
 
@@ -73,6 +150,11 @@ G_DEFINE_TYPE (BlxoThumbnailPreview, blxo_thumbnail_preview, GTK_TYPE_FRAME)
 static void
 blxo_thumbnail_preview_class_init (BlxoThumbnailPreviewClass *klass)
 {
+  GObjectClass *gobject_class;
+
+  gobject_class = G_OBJECT_CLASS (klass);
+  gobject_class->dispose = blxo_thumbnail_preview_dispose;
+  gobject_class->finalize = blxo_thumbnail_preview_finalize;
 }
 
 
@@ -151,6 +233,87 @@ blxo_thumbnail_preview_init (BlxoThumbnailPreview *thumbnail_preview)
 
 
 
+static void
+blxo_thumbnail_preview_free_siblings (GArray *siblings)
+{
+  BlxoThumbnailPreviewSibling *sibling;
+  guint                        n;
+
+  for (n = 0; n < siblings->len; ++n)
+    {
+      sibling = &g_array_index (siblings, BlxoThumbnailPreviewSibling, n);
+      g_free (sibling->filename);
+      g_free (sibling->key);
+    }
+  g_array_free (siblings, TRUE);
+}
+
+
+
+static void
+blxo_thumbnail_preview_clear_siblings (BlxoThumbnailPreview *thumbnail_preview)
+{
+  if (thumbnail_preview->siblings != NULL)
+    {
+      blxo_thumbnail_preview_free_siblings (thumbnail_preview->siblings);
+      thumbnail_preview->siblings = NULL;
+    }
+
+  g_free (thumbnail_preview->folder);
+  thumbnail_preview->folder = NULL;
+}
+
+
+
+static void
+blxo_thumbnail_preview_dispose (GObject *object)
+{
+  BlxoThumbnailPreview *thumbnail_preview = BLXO_THUMBNAIL_PREVIEW (object);
+
+  /* stop the pending update and loads, which reference the preview */
+  if (G_UNLIKELY (thumbnail_preview->update_id != 0))
+    {
+      g_source_remove (thumbnail_preview->update_id);
+      thumbnail_preview->update_id = 0;
+    }
+
+  if (G_UNLIKELY (thumbnail_preview->load_handle != 0))
+    {
+      _blxo_thumbnail_queue_cancel (thumbnail_preview->load_handle);
+      thumbnail_preview->load_handle = 0;
+    }
+
+  if (thumbnail_preview->prefetch_batch != 0)
+    {
+      _blxo_thumbnail_queue_cancel_batch (thumbnail_preview->prefetch_batch);
+      thumbnail_preview->prefetch_batch = 0;
+    }
+
+  if (thumbnail_preview->cancellable != NULL)
+    {
+      g_cancellable_cancel (thumbnail_preview->cancellable);
+      g_object_unref (G_OBJECT (thumbnail_preview->cancellable));
+      thumbnail_preview->cancellable = NULL;
+    }
+
+  (*G_OBJECT_CLASS (blxo_thumbnail_preview_parent_class)->dispose) (object);
+}
+
+
+
+static void
+blxo_thumbnail_preview_finalize (GObject *object)
+{
+  BlxoThumbnailPreview *thumbnail_preview = BLXO_THUMBNAIL_PREVIEW (object);
+
+  blxo_thumbnail_preview_clear_siblings (thumbnail_preview);
+  g_free (thumbnail_preview->uri);
+
+  (*G_OBJECT_CLASS (blxo_thumbnail_preview_parent_class)->finalize) (object);
+}
+
+
+
 static void
 blxo_thumbnail_preview_style_set (GtkWidget           *ebox,
                                  GtkStyle            *previous_style,
@@ -192,12 +355,14 @@ _blxo_thumbnail_preview_new (void)
 static inline GdkPixbuf*
 thumbnail_add_frame (GdkPixbuf *thumbnail)
 {
-  const guchar *pixels;
-  GdkPixbuf    *frame;
-  gint          rowstride;
-  gint          height;
-  gint          width;
-  gint          n;
+  static BlxoPixbufFrame *frame = NULL;
+  static gboolean         frame_loaded = FALSE;
+  const guchar           *pixels;
+  GdkPixbuf              *image;
+  gint                    rowstride;
+  gint                    height;
+  gint                    width;
+  gint                    n;
 
   /* determine the thumbnail dimensions */
   width = gdk_pixbuf_get_width (thumbnail);
@@ -235,14 +400,23 @@ thumbnail_add_frame (GdkPixbuf *thumbnail)
           goto none;
     }
 
-  /* try to load the frame image */
-  frame = gdk_pixbuf_new_from_file (DATADIR G_DIR_SEPARATOR_S "pixmaps" G_DIR_SEPARATOR_S "blxo"
-                                    G_DIR_SEPARATOR_S "blxo-thumbnail-frame.png", NULL);
+  /* try to load the frame image, only once */
+  if (G_UNLIKELY (!frame_loaded))
+    {
+      image = gdk_pixbuf_new_from_file (DATADIR G_DIR_SEPARATOR_S "pixmaps" G_DIR_SEPARATOR_S "blxo"
+                                        G_DIR_SEPARATOR_S "blxo-thumbnail-frame.png", NULL);
+      if (G_LIKELY (image != NULL))
+        {
+          frame = blxo_pixbuf_frame_new (image, 4, 3, 5, 6);
+          g_object_unref (G_OBJECT (image));
+        }
+      frame_loaded = TRUE;
+    }
+
   if (G_LIKELY (frame != NULL))
     {
       /* add a frame to the thumbnail */
-      thumbnail = blxo_gdk_pixbuf_frame (thumbnail, frame, 4, 3, 5, 6);
-      g_object_unref (G_OBJECT (frame));
+      thumbnail = blxo_pixbuf_frame_apply (frame, thumbnail);
     }
   else
     {
@@ -255,27 +429,468 @@ none: /* just add a ref on the thumbnail */
 
 
 
-/**
- * _blxo_thumbnail_preview_set_uri:
- * @thumbnail_preview : an #BlxoThumbnailPreview.
- * @uri               : the new URI for which to show a preview or %NULL.
- *
- * Updates the @thumbnail_preview to display a preview of the specified @uri.
- **/
-void
-_blxo_thumbnail_preview_set_uri (BlxoThumbnailPreview *thumbnail_preview,
-                                const gchar         *uri)
+static void
+blxo_thumbnail_preview_set_thumbnail (BlxoThumbnailPreview *thumbnail_preview,
+                                      GdkPixbuf            *thumbnail)
 {
-  struct stat statb;
-  GdkPixbuf  *thumbnail_framed;
-  GdkPixbuf  *thumbnail;
-  gchar      *icon_name = NULL;
-  gchar      *size_name = NULL;
-  gchar      *displayname;
-  gchar      *filename;
-  gchar      *slash;
+  GdkPixbuf *thumbnail_framed;
+
+  /* check if we have a thumbnail */
+  if (G_LIKELY (thumbnail != NULL))
+    {
+      /* setup the thumbnail for the image (using a frame if possible) */
+      thumbnail_framed = thumbnail_add_frame (thumbnail);
+      gtk_image_set_from_pixbuf (GTK_IMAGE (thumbnail_preview->image), thumbnail_framed);
+      g_object_unref (G_OBJECT (thumbnail_framed));
+    }
+  else
+    {
+      /* no thumbnail, cannot display anything useful then */
+      gtk_image_set_from_icon_name (GTK_IMAGE (thumbnail_preview->image), "image-missing", GTK_ICON_SIZE_DIALOG);
+    }
+}
+
+
+
+static void
+blxo_thumbnail_preview_loaded (const gchar      *filename,
+                               BlxoThumbnailSize  size,
+                               GdkPixbuf        *thumbnail,
+                               const GError     *error,
+                               gpointer          user_data)
+{
+  BlxoThumbnailPreview *thumbnail_preview = BLXO_THUMBNAIL_PREVIEW (user_data);
+
+  /* superseded loads are cancelled, so this is the previewed file */
+  thumbnail_preview->load_handle = 0;
+  blxo_thumbnail_preview_set_thumbnail (thumbnail_preview, thumbnail);
+}
+
+
+
+static void
+blxo_thumbnail_preview_prefetched (const gchar      *filename,
+                                   BlxoThumbnailSize  size,
+                                   GdkPixbuf        *thumbnail,
+                                   const GError     *error,
+                                   gpointer          user_data)
+{
+  /* the thumbnail is kept in the thumbnail cache until it is previewed */
+}
+
+
+
+static gboolean
+blxo_thumbnail_preview_is_image (const gchar *name)
+{
+  static GHashTable *mime_types = NULL;
+  GHashTable        *types_table;
+  gboolean           is_image;
+  GSList            *formats;
+  GSList            *lp;
+  gchar            **types;
+  gchar             *content_type;
+  gchar             *mime_type;
+  guint              n;
+
+  /* determine the MIME types supported by the gdk-pixbuf loaders, only once */
+  if (g_once_init_enter (&mime_types))
+    {
+      types_table = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+      formats = gdk_pixbuf_get_formats ();
+      for (lp = formats; lp != NULL; lp = lp->next)
+        {
+          types = gdk_pixbuf_format_get_mime_types (lp->data);
+          for (n = 0; types[n] != NULL; ++n)
+            g_hash_table_add (types_table, types[n]);
+          g_free (types);
+        }
+      g_slist_free (formats);
+      g_once_init_leave (&mime_types, types_table);
+    }
+
+  /* the file name is enough to guess, without reading the file */
+  content_type = g_content_type_guess (name, NULL, 0, NULL);
+  mime_type = g_content_type_get_mime_type (content_type);
+  is_image = (mime_type != NULL && g_hash_table_contains (mime_types, mime_type));
+  g_free (content_type);
+  g_free (mime_type);
+
+  return is_image;
+}
+
+
+
+static gchar*
+blxo_thumbnail_preview_sibling_key (const gchar *name)
+{
+  gchar *displayname;
+  gchar *casefold;
+  gchar *key;
+
+  /* the file chooser sorts files case-insensitively by their display name */
+  displayname = g_filename_display_name (name);
+  casefold = g_utf8_casefold (displayname, -1);
+  key = g_utf8_collate_key_for_filename (casefold, -1);
+  g_free (displayname);
+  g_free (casefold);
+
+  return key;
+}
+
+
+
+static gint
+blxo_thumbnail_preview_sibling_compare (gconstpointer a,
+                                        gconstpointer b)
+{
+  const BlxoThumbnailPreviewSibling *sibling_a = a;
+  const BlxoThumbnailPreviewSibling *sibling_b = b;
+
+  return strcmp (sibling_a->key, sibling_b->key);
+}
+
+
+
+static void
+blxo_thumbnail_preview_listing_free (gpointer data)
+{
+  BlxoThumbnailPreviewListing *listing = data;
+
+  if (listing->siblings != NULL)
+    blxo_thumbnail_preview_free_siblings (listing->siblings);
+  g_free (listing->folder);
+  g_free (listing->filename);
+  g_free (listing->uri);
+  g_slice_free (BlxoThumbnailPreviewListing, listing);
+}
+
+
+
+static void
+blxo_thumbnail_preview_list_siblings (GTask        *task,
+                                      gpointer      source_object,
+                                      gpointer      task_data,
+                                      GCancellable *cancellable)
+{
+  BlxoThumbnailPreviewListing *listing = task_data;
+  BlxoThumbnailPreviewSibling  sibling;
+  struct stat                  statb;
+  const gchar                 *name;
+  GError                      *error = NULL;
+  GArray                      *siblings;
+  GDir                        *dp;
+
+  if (stat (listing->folder, &statb) < 0)
+    {
+      g_task_return_new_error (task, G_FILE_ERROR, g_file_error_from_errno (errno), "%s", g_strerror (errno));
+      return;
+    }
+
+  /* the listing is reused until files are added to or removed from the folder */
+  if (listing->mtime == statb.st_mtime)
+    {
+      g_task_return_boolean (task, TRUE);
+      return;
+    }
+
+  dp = g_dir_open (listing->folder, 0, &error);
+  if (G_UNLIKELY (dp == NULL))
+    {
+      g_task_return_error (task, error);
+      return;
+    }
+
+  /* collect the visible image files, which are all the chooser shows with an image filter */
+  siblings = g_array_new (FALSE, FALSE, sizeof (BlxoThumbnailPreviewSibling));
+  while ((name = g_dir_read_name (dp)) != NULL && !g_cancellable_is_cancelled (cancellable))
+    {
+      if (name[0] == '.' || g_str_has_suffix (name, "~") || !blxo_thumbnail_preview_is_image (name))
+        continue;
+
+      sibling.key = blxo_thumbnail_preview_sibling_key (name);
+      sibling.filename = g_build_filename (listing->folder, name, NULL);
+      g_array_append_val (siblings, sibling);
+    }
+  g_dir_close (dp);
+
+  g_array_sort (siblings, blxo_thumbnail_preview_sibling_compare);
+
+  listing->mtime = statb.st_mtime;
+  listing->siblings = siblings;
+
+  g_task_return_boolean (task, TRUE);
+}
+
+
+
+static void
+blxo_thumbnail_preview_prefetch (BlxoThumbnailPreview *thumbnail_preview,
+                                 const gchar          *filename)
+{
+  BlxoThumbnailPreviewSibling *siblings;
+  const gchar                 *filenames[3];
+  gchar                       *name;
+  gchar                       *key;
+  guint                        n_filenames = 0;
+  guint                        lower, upper, mid;
+
+  if (thumbnail_preview->siblings == NULL || thumbnail_preview->siblings->len == 0)
+    return;
+
+  name = g_path_get_basename (filename);
+  key = blxo_thumbnail_preview_sibling_key (name);
+  g_free (name);
+
+  /* find the position of the file in the sorted listing */
+  siblings = (BlxoThumbnailPreviewSibling *) (gpointer) thumbnail_preview->siblings->data;
+  for (lower = 0, upper = thumbnail_preview->siblings->len; lower < upper; )
+    {
+      mid = (lower + upper) / 2;
+      if (strcmp (siblings[mid].key, key) < 0)
+        lower = mid + 1;
+      else
+        upper = mid;
+    }
+  g_free (key);
+
+  /* the previous file, and the next one after the file itself */
+  if (lower > 0)
+    filenames[n_filenames++] = siblings[lower - 1].filename;
+  if (lower < thumbnail_preview->siblings->len && strcmp (siblings[lower].filename, filename) == 0)
+    lower++;
+  if (lower < thumbnail_preview->siblings->len)
+    filenames[n_filenames++] = siblings[lower].filename;
+  filenames[n_filenames] = NULL;
+
+  if (thumbnail_preview->prefetch_batch != 0)
+    _blxo_thumbnail_queue_cancel_batch (thumbnail_preview->prefetch_batch);
+  thumbnail_preview->prefetch_batch = _blxo_thumbnail_queue_add_batch (filenames, BLXO_THUMBNAIL_SIZE_NORMAL,
+                                                                       BLXO_THUMBNAIL_PRIORITY_PREFETCH,
+                                                                       blxo_thumbnail_preview_prefetched,
+                                                                       NULL, NULL);
+}
+
+
+
+static void
+blxo_thumbnail_preview_listed (GObject      *object,
+                               GAsyncResult *result,
+                               gpointer      user_data)
+{
+  BlxoThumbnailPreviewListing *listing = g_task_get_task_data (G_TASK (result));
+  BlxoThumbnailPreview        *thumbnail_preview = BLXO_THUMBNAIL_PREVIEW (object);
+
+  /* cancelled tasks report an error as well */
+  if (!g_task_propagate_boolean (G_TASK (result), NULL))
+    return;
+
+  /* drop the result if the preview moved on meanwhile */
+  if (g_strcmp0 (thumbnail_preview->uri, listing->uri) != 0)
+    return;
+
+  if (listing->siblings != NULL)
+    {
+      /* take the new listing of the folder */
+      blxo_thumbnail_preview_clear_siblings (thumbnail_preview);
+      thumbnail_preview->folder = g_strdup (listing->folder);
+      thumbnail_preview->folder_mtime = listing->mtime;
+      thumbnail_preview->siblings = listing->siblings;
+      listing->siblings = NULL;
+    }
+  else if (g_strcmp0 (thumbnail_preview->folder, listing->folder) != 0)
+    {
+      /* the listing we had was replaced meanwhile */
+      return;
+    }
+
+  blxo_thumbnail_preview_prefetch (thumbnail_preview, listing->filename);
+}
+
+
+
+static void
+blxo_thumbnail_preview_list_folder (BlxoThumbnailPreview *thumbnail_preview,
+                                    const gchar          *filename)
+{
+  BlxoThumbnailPreviewListing *listing;
+  GTask                       *task;
+
+  listing = g_slice_new0 (BlxoThumbnailPreviewListing);
+  listing->uri = g_strdup (thumbnail_preview->uri);
+  listing->filename = g_strdup (filename);
+  listing->folder = g_path_get_dirname (filename);
+
+  /* the worker only lists the folder again if it changed */
+  if (g_strcmp0 (thumbnail_preview->folder, listing->folder) == 0)
+    listing->mtime = thumbnail_preview->folder_mtime;
+  else
+    listing->mtime = (time_t) -1;
+
+  task = g_task_new (thumbnail_preview, thumbnail_preview->cancellable, blxo_thumbnail_preview_listed, NULL);
+  g_task_set_task_data (task, listing, blxo_thumbnail_preview_listing_free);
+  g_task_run_in_thread (task, blxo_thumbnail_preview_list_siblings);
+  g_object_unref (G_OBJECT (task));
+}
+
+
+
+static void
+blxo_thumbnail_preview_info_free (gpointer data)
+{
+  BlxoThumbnailPreviewInfo *info = data;
+
+  if (info->thumbnail != NULL)
+    g_object_unref (G_OBJECT (info->thumbnail));
+  g_free (info->size_name);
+  g_free (info->icon_name);
+  g_free (info->filename);
+  g_free (info->uri);
+  g_slice_free (BlxoThumbnailPreviewInfo, info);
+}
+
+
+
+static void
+blxo_thumbnail_preview_query_info (GTask        *task,
+                                   gpointer      source_object,
+                                   gpointer      task_data,
+                                   GCancellable *cancellable)
+{
+  BlxoThumbnailPreviewInfo *info = task_data;
+  struct stat               statb;
+
+  if (g_task_return_error_if_cancelled (task))
+    return;
+
+  if (G_UNLIKELY (info->filename == NULL))
+    {
+      /* thumbnails cannot be generated for other than local files, but may exist */
+      info->thumbnail = _blxo_thumbnail_get_for_uri (info->uri, BLXO_THUMBNAIL_SIZE_NORMAL, NULL);
+    }
+  else if (stat (info->filename, &statb) == 0)
+    {
+      /* icon and size label depends on the mode */
+      if (S_ISBLK (statb.st_mode))
+        {
+          info->icon_name = g_strdup ("drive-harddisk");
+          info->size_name = g_strdup (_("Block Device"));
+        }
+      else if (S_ISCHR (statb.st_mode))
+        {
+          info->icon_name = g_strdup ("drive-harddisk");
+          info->size_name = g_strdup (_("Character Device"));
+        }
+      else if (S_ISDIR (statb.st_mode))
+        {
+          info->icon_name = g_strdup ("folder");
+          info->size_name = g_strdup (_("Folder"));
+        }
+      else if (S_ISFIFO (statb.st_mode))
+        {
+          info->icon_name = g_strdup ("drive-harddisk");
+          info->size_name = g_strdup (_("FIFO"));
+        }
+      else if (S_ISSOCK (statb.st_mode))
+        {
+          info->icon_name = g_strdup ("drive-harddisk");
+          info->size_name = g_strdup (_("Socket"));
+        }
+      else if (S_ISREG (statb.st_mode))
+        {
+          if (G_UNLIKELY ((gulong) statb.st_size > 1024ul * 1024ul * 1024ul))
+            info->size_name = g_strdup_printf ("%0.1f GB", statb.st_size / (1024.0 * 1024.0 * 1024.0));
+          else if ((gulong) statb.st_size > 1024ul * 1024ul)
+            info->size_name = g_strdup_printf ("%0.1f MB", statb.st_size / (1024.0 * 1024.0));
+          else if ((gulong) statb.st_size > 1024ul)
+            info->size_name = g_strdup_printf ("%0.1f kB", statb.st_size / 1024.0);
+          else
+            info->size_name = g_strdup_printf ("%lu B", (gulong) statb.st_size);
+        }
+    }
+
+  g_task_return_boolean (task, TRUE);
+}
+
 
-  _blxo_return_if_fail (BLXO_IS_THUMBNAIL_PREVIEW (thumbnail_preview));
+
+static void
+blxo_thumbnail_preview_queried (GObject      *object,
+                                GAsyncResult *result,
+                                gpointer      user_data)
+{
+  BlxoThumbnailPreviewInfo *info = g_task_get_task_data (G_TASK (result));
+  BlxoThumbnailPreview     *thumbnail_preview = BLXO_THUMBNAIL_PREVIEW (object);
+  guint                     prefetch_batch;
+
+  /* cancelled tasks report an error as well */
+  if (!g_task_propagate_boolean (G_TASK (result), NULL))
+    return;
+
+  /* drop the result if the preview moved on meanwhile */
+  if (g_strcmp0 (thumbnail_preview->uri, info->uri) != 0)
+    return;
+
+  /* the neighbours of the previous file are cancelled once the new requests are queued,
+   * so thumbnails requested again are not dropped in between */
+  prefetch_batch = thumbnail_preview->prefetch_batch;
+  thumbnail_preview->prefetch_batch = 0;
+
+  /* setup the new size label */
+  gtk_label_set_text (GTK_LABEL (thumbnail_preview->size_label), (info->size_name != NULL) ? info->size_name : "");
+
+  /* check if we have an icon-name */
+  if (G_UNLIKELY (info->icon_name != NULL))
+    {
+      /* setup the named icon then */
+      gtk_image_set_from_icon_name (GTK_IMAGE (thumbnail_preview->image), info->icon_name, GTK_ICON_SIZE_DIALOG);
+    }
+  else if (G_LIKELY (info->filename != NULL))
+    {
+      /* load or generate the thumbnail in the background */
+      thumbnail_preview->load_handle = _blxo_thumbnail_queue_add (info->filename, BLXO_THUMBNAIL_SIZE_NORMAL,
+                                                                  BLXO_THUMBNAIL_PRIORITY_VISIBLE,
+                                                                  blxo_thumbnail_preview_loaded,
+                                                                  thumbnail_preview, NULL);
+
+      /* the user is likely to move to the next or previous file,
+       * which are prefetched once the folder is listed */
+      blxo_thumbnail_preview_list_folder (thumbnail_preview, info->filename);
+    }
+  else
+    {
+      blxo_thumbnail_preview_set_thumbnail (thumbnail_preview, info->thumbnail);
+    }
+
+  if (prefetch_batch != 0)
+    _blxo_thumbnail_queue_cancel_batch (prefetch_batch);
+}
+
+
+
+static gboolean
+blxo_thumbnail_preview_update (gpointer user_data)
+{
+  BlxoThumbnailPreview     *thumbnail_preview = BLXO_THUMBNAIL_PREVIEW (user_data);
+  BlxoThumbnailPreviewInfo *info;
+  const gchar              *uri = thumbnail_preview->uri;
+  gchar                    *displayname;
+  gchar                    *filename;
+  gchar                    *slash;
+  GTask                    *task;
+
+  thumbnail_preview->update_id = 0;
+
+  /* a query or listing for the previous file is no longer needed */
+  if (thumbnail_preview->cancellable != NULL)
+    {
+      g_cancellable_cancel (thumbnail_preview->cancellable);
+      g_object_unref (G_OBJECT (thumbnail_preview->cancellable));
+      thumbnail_preview->cancellable = NULL;
+    }
+
+  /* the size is only known once the file was queried */
+  gtk_label_set_text (GTK_LABEL (thumbnail_preview->size_label), "");
 
   /* check if we have an URI to preview */
   if (G_UNLIKELY (uri == NULL))
@@ -284,6 +899,13 @@ _blxo_thumbnail_preview_set_uri (BlxoThumbnailPreview *thumbnail_preview,
       gtk_widget_set_sensitive (GTK_WIDGET (thumbnail_preview), FALSE);
       gtk_image_set_from_icon_name (GTK_IMAGE (thumbnail_preview->image), "image-missing", GTK_ICON_SIZE_DIALOG);
       gtk_label_set_text (GTK_LABEL (thumbnail_preview->name_label), _("No file selected"));
+
+      /* the neighbours of the previous file are no longer needed */
+      if (thumbnail_preview->prefetch_batch != 0)
+        {
+          _blxo_thumbnail_queue_cancel_batch (thumbnail_preview->prefetch_batch);
+          thumbnail_preview->prefetch_batch = 0;
+        }
     }
   else
     {
@@ -294,48 +916,6 @@ _blxo_thumbnail_preview_set_uri (BlxoThumbnailPreview *thumbnail_preview,
       filename = g_filename_from_uri (uri, NULL, NULL);
       if (G_LIKELY (filename != NULL))
         {
-          /* try to stat the file */
-          if (stat (filename, &statb) == 0)
-            {
-              /* icon and size label depends on the mode */
-              if (S_ISBLK (statb.st_mode))
-                {
-                  icon_name = g_strdup ("drive-harddisk");
-                  size_name = g_strdup (_("Block Device"));
-                }
-              else if (S_ISCHR (statb.st_mode))
-                {
-                  icon_name = g_strdup ("drive-harddisk");
-                  size_name = g_strdup (_("Character Device"));
-                }
-              else if (S_ISDIR (statb.st_mode))
-                {
-                  icon_name = g_strdup ("folder");
-                  size_name = g_strdup (_("Folder"));
-                }
-              else if (S_ISFIFO (statb.st_mode))
-                {
-                  icon_name = g_strdup ("drive-harddisk");
-                  size_name = g_strdup (_("FIFO"));
-                }
-              else if (S_ISSOCK (statb.st_mode))
-                {
-                  icon_name = g_strdup ("drive-harddisk");
-                  size_name = g_strdup (_("Socket"));
-                }
-              else if (S_ISREG (statb.st_mode))
-                {
-                  if (G_UNLIKELY ((gulong) statb.st_size > 1024ul * 1024ul * 1024ul))
-                    size_name = g_strdup_printf ("%0.1f GB", statb.st_size / (1024.0 * 1024.0 * 1024.0));
-                  else if ((gulong) statb.st_size > 1024ul * 1024ul)
-                    size_name = g_strdup_printf ("%0.1f MB", statb.st_size / (1024.0 * 1024.0));
-                  else if ((gulong) statb.st_size > 1024ul)
-                    size_name = g_strdup_printf ("%0.1f kB", statb.st_size / 1024.0);
-                  else
-                    size_name = g_strdup_printf ("%lu B", (gulong) statb.st_size);
-                }
-            }
-
           /* determine the basename from the filename */
           displayname = g_filename_display_basename (filename);
         }
@@ -349,50 +929,60 @@ _blxo_thumbnail_preview_set_uri (BlxoThumbnailPreview *thumbnail_preview,
             displayname = g_filename_display_name (uri);
         }
 
-      /* check if we have an icon-name */
-      if (G_UNLIKELY (icon_name != NULL))
-        {
-          /* setup the named icon then */
-          gtk_image_set_from_icon_name (GTK_IMAGE (thumbnail_preview->image), icon_name, GTK_ICON_SIZE_DIALOG);
-          g_free (icon_name);
-        }
-      else
-        {
-          /* try to load a thumbnail for the URI */
-          thumbnail = _blxo_thumbnail_get_for_uri (uri, BLXO_THUMBNAIL_SIZE_NORMAL, NULL);
-          if (thumbnail == NULL && G_LIKELY (filename != NULL))
-            {
-              /* but we can try to generate a thumbnail */
-              thumbnail = _blxo_thumbnail_get_for_file (filename, BLXO_THUMBNAIL_SIZE_NORMAL, NULL);
-            }
-
-          /* check if we have a thumbnail */
-          if (G_LIKELY (thumbnail != NULL))
-            {
-              /* setup the thumbnail for the image (using a frame if possible) */
-              thumbnail_framed = thumbnail_add_frame (thumbnail);
-              gtk_image_set_from_pixbuf (GTK_IMAGE (thumbnail_preview->image), thumbnail_framed);
-              g_object_unref (G_OBJECT (thumbnail_framed));
-              g_object_unref (G_OBJECT (thumbnail));
-            }
-          else
-            {
-              /* no thumbnail, cannot display anything useful then */
-              gtk_image_set_from_icon_name (GTK_IMAGE (thumbnail_preview->image), "image-missing", GTK_ICON_SIZE_DIALOG);
-            }
-        }
-
       /* setup the name label */
       gtk_label_set_text (GTK_LABEL (thumbnail_preview->name_label), displayname);
-
-      /* cleanup */
       g_free (displayname);
-      g_free (filename);
+
+      /* show a placeholder until the file was queried */
+      gtk_image_set_from_icon_name (GTK_IMAGE (thumbnail_preview->image), "image-loading", GTK_ICON_SIZE_DIALOG);
+
+      info = g_slice_new0 (BlxoThumbnailPreviewInfo);
+      info->uri = g_strdup (uri);
+      info->filename = filename;
+
+      /* stat() the file, or load the thumbnail of a remote file, on a worker thread */
+      thumbnail_preview->cancellable = g_cancellable_new ();
+      task = g_task_new (thumbnail_preview, thumbnail_preview->cancellable, blxo_thumbnail_preview_queried, NULL);
+      g_task_set_task_data (task, info, blxo_thumbnail_preview_info_free);
+      g_task_run_in_thread (task, blxo_thumbnail_preview_query_info);
+      g_object_unref (G_OBJECT (task));
     }
 
-  /* setup the new size label */
-  gtk_label_set_text (GTK_LABEL (thumbnail_preview->size_label), (size_name != NULL) ? size_name : "");
-  g_free (size_name);
+  return FALSE;
+}
+
+
+
+/**
+ * _blxo_thumbnail_preview_set_uri:
+ * @thumbnail_preview : an #BlxoThumbnailPreview.
+ * @uri               : the new URI for which to show a preview or %NULL.
+ *
+ * Updates the @thumbnail_preview to display a preview of the specified @uri,
+ * once the @uri was not changed again for a short while. The thumbnail is
+ * loaded in the background, and the thumbnails of the image files next to
+ * @uri are prefetched.
+ **/
+void
+_blxo_thumbnail_preview_set_uri (BlxoThumbnailPreview *thumbnail_preview,
+                                const gchar         *uri)
+{
+  _blxo_return_if_fail (BLXO_IS_THUMBNAIL_PREVIEW (thumbnail_preview));
+
+  /* the thumbnail being loaded is no longer needed */
+  if (thumbnail_preview->load_handle != 0)
+    {
+      _blxo_thumbnail_queue_cancel (thumbnail_preview->load_handle);
+      thumbnail_preview->load_handle = 0;
+    }
+
+  g_free (thumbnail_preview->uri);
+  thumbnail_preview->uri = g_strdup (uri);
+
+  /* restart the delay on every change, so rapid changes result in a single update */
+  if (thumbnail_preview->update_id != 0)
+    g_source_remove (thumbnail_preview->update_id);
+  thumbnail_preview->update_id = g_timeout_add (BLXO_THUMBNAIL_PREVIEW_DELAY, blxo_thumbnail_preview_update, thumbnail_preview);
 }
 
 
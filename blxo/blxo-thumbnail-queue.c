@@ -0,0 +1,482 @@
+/*-
+ * Copyright (c) 2026 Xfce Development Team <xfce4-dev@xfce.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include <blxo/blxo-private.h>
+#include <blxo/blxo-thumbnail-queue.h>
+#include <blxo/blxo-alias.h>
+
+/* The thumbnail queue generates thumbnails on a pool of worker threads,
+ * sized to the number of processors. Queued files are ordered by priority
+ * and then by the time they were queued, and requests for the same file
+ * and size share a single job, even while the job is running. All state
+ * but the order of the queued jobs is owned by the main thread; workers
+ * take the most important job from the sorted sequence when they start,
+ * so jobs can be raised in priority after they were queued.
+ */
+
+
+
+typedef struct _BlxoThumbnailQueueKey     BlxoThumbnailQueueKey;
+typedef struct _BlxoThumbnailQueueJob     BlxoThumbnailQueueJob;
+typedef struct _BlxoThumbnailQueueBatch   BlxoThumbnailQueueBatch;
+typedef struct _BlxoThumbnailQueueRequest BlxoThumbnailQueueRequest;
+
+
+
+struct _BlxoThumbnailQueueKey
+{
+  gchar            *filename;
+  BlxoThumbnailSize  size;
+};
+
+struct _BlxoThumbnailQueueJob
+{
+  BlxoThumbnailQueueKey key;
+  BlxoThumbnailPriority priority;
+  guint                serial;
+
+  /* the position in the queue, or %NULL once a worker took the job */
+  GSequenceIter       *iter;
+
+  /* the requests waiting for the job, in the order they were added */
+  GSList              *requests;
+
+  /* set by the worker thread */
+  GdkPixbuf           *thumbnail;
+  GError              *error;
+};
+
+struct _BlxoThumbnailQueueBatch
+{
+  guint                 id;
+  BlxoThumbnailQueueFunc func;
+  gpointer              user_data;
+  GDestroyNotify        destroy;
+  GSList               *requests;
+};
+
+struct _BlxoThumbnailQueueRequest
+{
+  guint                   handle;
+  BlxoThumbnailQueueBatch *batch;
+  BlxoThumbnailQueueJob   *job;
+};
+
+
+
+static GHashTable  *queue_jobs = NULL;
+static GHashTable  *queue_requests = NULL;
+static GHashTable  *queue_batches = NULL;
+static GSequence   *queue_sequence = NULL;
+static GThreadPool *queue_pool = NULL;
+static guint        queue_serial = 0;
+static guint        queue_last_handle = 0;
+static GMutex       queue_mutex;
+
+
+
+static guint
+blxo_thumbnail_queue_key_hash (gconstpointer data)
+{
+  const BlxoThumbnailQueueKey *key = data;
+
+  return g_str_hash (key->filename) ^ (guint) key->size;
+}
+
+
+
+static gboolean
+blxo_thumbnail_queue_key_equal (gconstpointer a,
+                               gconstpointer b)
+{
+  const BlxoThumbnailQueueKey *key_a = a;
+  const BlxoThumbnailQueueKey *key_b = b;
+
+  return (key_a->size == key_b->size && strcmp (key_a->filename, key_b->filename) == 0);
+}
+
+
+
+static gint
+blxo_thumbnail_queue_job_compare (gconstpointer a,
+                                 gconstpointer b,
+                                 gpointer      user_data)
+{
+  const BlxoThumbnailQueueJob *job_a = a;
+  const BlxoThumbnailQueueJob *job_b = b;
+
+  /* more important jobs first, then the jobs queued first */
+  if (job_a->priority != job_b->priority)
+    return job_a->priority - job_b->priority;
+
+  return (job_a->serial < job_b->serial) ? -1 : (job_a->serial > job_b->serial);
+}
+
+
+
+static void
+blxo_thumbnail_queue_job_free (BlxoThumbnailQueueJob *job)
+{
+  if (G_UNLIKELY (job->error != NULL))
+    g_error_free (job->error);
+  if (G_LIKELY (job->thumbnail != NULL))
+    g_object_unref (G_OBJECT (job->thumbnail));
+  g_free (job->key.filename);
+  g_slice_free (BlxoThumbnailQueueJob, job);
+}
+
+
+
+static void
+blxo_thumbnail_queue_request_free (BlxoThumbnailQueueRequest *request)
+{
+  BlxoThumbnailQueueBatch *batch = request->batch;
+  BlxoThumbnailQueueJob   *job = request->job;
+  gboolean                 dequeued = FALSE;
+
+  g_hash_table_remove (queue_requests, GUINT_TO_POINTER (request->handle));
+
+  /* drop the job if nobody waits for it and no worker took it yet */
+  if (job != NULL)
+    {
+      job->requests = g_slist_remove (job->requests, request);
+      if (job->requests == NULL)
+        {
+          g_mutex_lock (&queue_mutex);
+          if (job->iter != NULL)
+            {
+              g_sequence_remove (job->iter);
+              job->iter = NULL;
+              dequeued = TRUE;
+            }
+          g_mutex_unlock (&queue_mutex);
+
+          if (dequeued)
+            {
+              g_hash_table_remove (queue_jobs, &job->key);
+              blxo_thumbnail_queue_job_free (job);
+            }
+        }
+    }
+
+  /* release the batch with its last request */
+  batch->requests = g_slist_remove (batch->requests, request);
+  if (batch->requests == NULL)
+    {
+      g_hash_table_remove (queue_batches, GUINT_TO_POINTER (batch->id));
+      if (batch->destroy != NULL)
+        (*batch->destroy) (batch->user_data);
+      g_slice_free (BlxoThumbnailQueueBatch, batch);
+    }
+
+  g_slice_free (BlxoThumbnailQueueRequest, request);
+}
+
+
+
+static gboolean
+blxo_thumbnail_queue_job_finished (gpointer user_data)
+{
+  BlxoThumbnailQueueRequest *request;
+  BlxoThumbnailQueueJob     *job = user_data;
+
+  g_hash_table_remove (queue_jobs, &job->key);
+
+  /* notify the waiting requests, which may cancel other requests */
+  while (job->requests != NULL)
+    {
+      request = job->requests->data;
+      job->requests = g_slist_delete_link (job->requests, job->requests);
+      request->job = NULL;
+
+      (*request->batch->func) (job->key.filename, job->key.size, job->thumbnail,
+                               job->error, request->batch->user_data);
+
+      blxo_thumbnail_queue_request_free (request);
+    }
+
+  blxo_thumbnail_queue_job_free (job);
+
+  return FALSE;
+}
+
+
+
+static void
+blxo_thumbnail_queue_worker (gpointer data,
+                            gpointer user_data)
+{
+  BlxoThumbnailQueueJob *job = NULL;
+  GSequenceIter         *iter;
+
+  /* take the most important job, if it was not cancelled meanwhile */
+  g_mutex_lock (&queue_mutex);
+  iter = g_sequence_get_begin_iter (queue_sequence);
+  if (!g_sequence_iter_is_end (iter))
+    {
+      job = g_sequence_get (iter);
+      g_sequence_remove (iter);
+      job->iter = NULL;
+    }
+  g_mutex_unlock (&queue_mutex);
+
+  if (G_UNLIKELY (job == NULL))
+    return;
+
+  job->thumbnail = _blxo_thumbnail_get_for_file (job->key.filename, job->key.size, &job->error);
+
+  /* hand the job back to the main loop */
+  g_idle_add_full (G_PRIORITY_HIGH_IDLE, blxo_thumbnail_queue_job_finished, job, NULL);
+}
+
+
+
+static void
+blxo_thumbnail_queue_init (void)
+{
+  if (G_LIKELY (queue_jobs != NULL))
+    return;
+
+  queue_jobs = g_hash_table_new (blxo_thumbnail_queue_key_hash, blxo_thumbnail_queue_key_equal);
+  queue_requests = g_hash_table_new (g_direct_hash, g_direct_equal);
+  queue_batches = g_hash_table_new (g_direct_hash, g_direct_equal);
+  queue_sequence = g_sequence_new (NULL);
+  queue_pool = g_thread_pool_new (blxo_thumbnail_queue_worker, NULL, g_get_num_processors (), FALSE, NULL);
+}
+
+
+
+static guint
+blxo_thumbnail_queue_add_request (BlxoThumbnailQueueBatch *batch,
+                                 const gchar             *filename,
+                                 BlxoThumbnailSize         size,
+                                 BlxoThumbnailPriority     priority)
+{
+  BlxoThumbnailQueueRequest *request;
+  BlxoThumbnailQueueJob     *job;
+  BlxoThumbnailQueueKey      key;
+
+  /* check if the thumbnail is queued or generated already */
+  key.filename = (gchar *) filename;
+  key.size = size;
+  job = g_hash_table_lookup (queue_jobs, &key);
+  if (G_LIKELY (job == NULL))
+    {
+      job = g_slice_new0 (BlxoThumbnailQueueJob);
+      job->key.filename = g_strdup (filename);
+      job->key.size = size;
+      job->priority = priority;
+      job->serial = queue_serial++;
+      g_hash_table_insert (queue_jobs, &job->key, job);
+
+      g_mutex_lock (&queue_mutex);
+      job->iter = g_sequence_insert_sorted (queue_sequence, job, blxo_thumbnail_queue_job_compare, NULL);
+      g_mutex_unlock (&queue_mutex);
+
+      /* every job wakes up one worker, which takes the most important job */
+      g_thread_pool_push (queue_pool, GUINT_TO_POINTER (1), NULL);
+    }
+  else if (priority < job->priority)
+    {
+      /* raise the priority of the queued job */
+      g_mutex_lock (&queue_mutex);
+      job->priority = priority;
+      if (job->iter != NULL)
+        g_sequence_sort_changed (job->iter, blxo_thumbnail_queue_job_compare, NULL);
+      g_mutex_unlock (&queue_mutex);
+    }
+
+  request = g_slice_new (BlxoThumbnailQueueRequest);
+  request->handle = ++queue_last_handle;
+  request->batch = batch;
+  request->job = job;
+  job->requests = g_slist_append (job->requests, request);
+  batch->requests = g_slist_prepend (batch->requests, request);
+  g_hash_table_insert (queue_requests, GUINT_TO_POINTER (request->handle), request);
+
+  return request->handle;
+}
+
+
+
+static BlxoThumbnailQueueBatch*
+blxo_thumbnail_queue_batch_new (BlxoThumbnailQueueFunc func,
+                               gpointer              user_data,
+                               GDestroyNotify        destroy)
+{
+  BlxoThumbnailQueueBatch *batch;
+
+  blxo_thumbnail_queue_init ();
+
+  batch = g_slice_new0 (BlxoThumbnailQueueBatch);
+  batch->id = ++queue_last_handle;
+  batch->func = func;
+  batch->user_data = user_data;
+  batch->destroy = destroy;
+  g_hash_table_insert (queue_batches, GUINT_TO_POINTER (batch->id), batch);
+
+  return batch;
+}
+
+
+
+/**
+ * _blxo_thumbnail_queue_add:
+ * @filename  : the absolute path to the file to generate a thumbnail for.
+ * @size      : the thumbnail size.
+ * @priority  : the #BlxoThumbnailPriority of the request.
+ * @func      : the function to call once the thumbnail is ready.
+ * @user_data : the data to pass to @func.
+ * @destroy   : the function to release @user_data with, or %NULL.
+ *
+ * Queues loading or generating the thumbnail for @filename at @size on a
+ * worker thread, see _blxo_thumbnail_get_for_file(). If the thumbnail is
+ * queued already, the request is attached to the queued job, and the job
+ * is raised to @priority if necessary.
+ *
+ * @func is called in the main loop unless the request is cancelled, then
+ * @destroy is called for @user_data.
+ *
+ * Returns: the handle of the request, for _blxo_thumbnail_queue_cancel().
+ **/
+guint
+_blxo_thumbnail_queue_add (const gchar           *filename,
+                          BlxoThumbnailSize       size,
+                          BlxoThumbnailPriority   priority,
+                          BlxoThumbnailQueueFunc  func,
+                          gpointer               user_data,
+                          GDestroyNotify         destroy)
+{
+  BlxoThumbnailQueueBatch *batch;
+
+  _blxo_return_val_if_fail (filename != NULL, 0);
+  _blxo_return_val_if_fail (func != NULL, 0);
+
+  batch = blxo_thumbnail_queue_batch_new (func, user_data, destroy);
+
+  return blxo_thumbnail_queue_add_request (batch, filename, size, priority);
+}
+
+
+
+/**
+ * _blxo_thumbnail_queue_add_batch:
+ * @filenames : a %NULL-terminated array of absolute paths.
+ * @size      : the thumbnail size.
+ * @priority  : the #BlxoThumbnailPriority of the requests.
+ * @func      : the function to call for each thumbnail that is ready.
+ * @user_data : the data to pass to @func.
+ * @destroy   : the function to release @user_data with, or %NULL.
+ *
+ * Like _blxo_thumbnail_queue_add(), but queues all @filenames at once.
+ * @func is called for each of the @filenames, and @destroy once the last
+ * thumbnail was reported or the batch was cancelled.
+ *
+ * Returns: the handle of the batch, for _blxo_thumbnail_queue_cancel_batch(),
+ *          or 0 if @filenames is empty.
+ **/
+guint
+_blxo_thumbnail_queue_add_batch (const gchar * const    *filenames,
+                                BlxoThumbnailSize       size,
+                                BlxoThumbnailPriority   priority,
+                                BlxoThumbnailQueueFunc  func,
+                                gpointer               user_data,
+                                GDestroyNotify         destroy)
+{
+  BlxoThumbnailQueueBatch *batch;
+  guint                    n;
+
+  _blxo_return_val_if_fail (filenames != NULL, 0);
+  _blxo_return_val_if_fail (func != NULL, 0);
+
+  if (G_UNLIKELY (filenames[0] == NULL))
+    {
+      if (destroy != NULL)
+        (*destroy) (user_data);
+      return 0;
+    }
+
+  batch = blxo_thumbnail_queue_batch_new (func, user_data, destroy);
+  for (n = 0; filenames[n] != NULL; ++n)
+    blxo_thumbnail_queue_add_request (batch, filenames[n], size, priority);
+
+  return batch->id;
+}
+
+
+
+/**
+ * _blxo_thumbnail_queue_cancel:
+ * @handle : the handle returned by _blxo_thumbnail_queue_add().
+ *
+ * Cancels the request, so its function is not called. The thumbnail is
+ * not generated, unless other requests wait for it or a worker started
+ * generating it already. Cancelling finished requests is a no-op.
+ **/
+void
+_blxo_thumbnail_queue_cancel (guint handle)
+{
+  BlxoThumbnailQueueRequest *request;
+
+  if (G_UNLIKELY (queue_requests == NULL))
+    return;
+
+  request = g_hash_table_lookup (queue_requests, GUINT_TO_POINTER (handle));
+  if (G_LIKELY (request != NULL))
+    blxo_thumbnail_queue_request_free (request);
+}
+
+
+
+/**
+ * _blxo_thumbnail_queue_cancel_batch:
+ * @batch : the handle returned by _blxo_thumbnail_queue_add_batch().
+ *
+ * Cancels all pending requests of the @batch, see _blxo_thumbnail_queue_cancel().
+ **/
+void
+_blxo_thumbnail_queue_cancel_batch (guint batch)
+{
+  BlxoThumbnailQueueBatch *queue_batch;
+
+  if (G_UNLIKELY (queue_batches == NULL))
+    return;
+
+  queue_batch = g_hash_table_lookup (queue_batches, GUINT_TO_POINTER (batch));
+  if (G_UNLIKELY (queue_batch == NULL))
+    return;
+
+  /* the batch is released with its last request */
+  while (g_hash_table_lookup (queue_batches, GUINT_TO_POINTER (batch)) == queue_batch)
+    blxo_thumbnail_queue_request_free (queue_batch->requests->data);
+}
+
+
+
+#define __BLXO_THUMBNAIL_QUEUE_C__
+#include <blxo/blxo-aliasdef.c>
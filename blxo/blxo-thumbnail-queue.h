@@ -0,0 +1,80 @@
+/*-
+ * Copyright (c) 2026 Xfce Development Team <xfce4-dev@xfce.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+
+#if !defined (BLXO_COMPILATION)
+#error "Only <blxo/blxo.h> can be included directly, this file is not part of the public API."
+#endif
+
+#ifndef __BLXO_THUMBNAIL_QUEUE_H__
+#define __BLXO_THUMBNAIL_QUEUE_H__
+
+#include <blxo/blxo-thumbnail.h>
+
+G_BEGIN_DECLS
+
+/**
+ * BlxoThumbnailPriority:
+ * @BLXO_THUMBNAIL_PRIORITY_VISIBLE    : the thumbnail is displayed right now.
+ * @BLXO_THUMBNAIL_PRIORITY_PREFETCH   : the thumbnail is likely to be displayed soon.
+ * @BLXO_THUMBNAIL_PRIORITY_BACKGROUND : the thumbnail is generated ahead of time.
+ *
+ * The order in which queued thumbnails are generated.
+ **/
+typedef enum /*< skip >*/
+{
+  BLXO_THUMBNAIL_PRIORITY_VISIBLE,
+  BLXO_THUMBNAIL_PRIORITY_PREFETCH,
+  BLXO_THUMBNAIL_PRIORITY_BACKGROUND,
+} BlxoThumbnailPriority;
+
+/**
+ * BlxoThumbnailQueueFunc:
+ * @filename  : the file the thumbnail was requested for.
+ * @size      : the requested thumbnail size.
+ * @thumbnail : the thumbnail or %NULL on error.
+ * @error     : the error if @thumbnail is %NULL.
+ * @user_data : the data passed to _blxo_thumbnail_queue_add().
+ *
+ * Called in the main loop once a queued thumbnail is ready.
+ **/
+typedef void (*BlxoThumbnailQueueFunc) (const gchar      *filename,
+                                        BlxoThumbnailSize  size,
+                                        GdkPixbuf        *thumbnail,
+                                        const GError     *error,
+                                        gpointer          user_data);
+
+G_GNUC_INTERNAL guint _blxo_thumbnail_queue_add          (const gchar           *filename,
+                                                         BlxoThumbnailSize       size,
+                                                         BlxoThumbnailPriority   priority,
+                                                         BlxoThumbnailQueueFunc  func,
+                                                         gpointer               user_data,
+                                                         GDestroyNotify         destroy);
+G_GNUC_INTERNAL guint _blxo_thumbnail_queue_add_batch    (const gchar * const    *filenames,
+                                                         BlxoThumbnailSize       size,
+                                                         BlxoThumbnailPriority   priority,
+                                                         BlxoThumbnailQueueFunc  func,
+                                                         gpointer               user_data,
+                                                         GDestroyNotify         destroy);
+G_GNUC_INTERNAL void  _blxo_thumbnail_queue_cancel       (guint                  handle);
+G_GNUC_INTERNAL void  _blxo_thumbnail_queue_cancel_batch (guint                  batch);
+
+G_END_DECLS
+
+#endif /* !__BLXO_THUMBNAIL_QUEUE_H__ */
@@ -17,6 +17,11 @@
  * MA 02110-1301 USA
  */
 
+/* for O_TMPFILE */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #ifdef HAVE_CONFIG_H
 #include <config.h>
 #endif
@@ -31,6 +36,9 @@
 #ifdef HAVE_ERRNO_H
 #include <errno.h>
 #endif
+#ifdef HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
 #ifdef HAVE_MEMORY_H
 #include <memory.h>
 #endif
@@ -50,8 +58,11 @@
 
 #include <libbladeutil/libbladeutil.h>
 
+#include <blxo/blxo-cache-monitor.h>
 #include <blxo/blxo-gdk-pixbuf-extensions.h>
+#include <blxo/blxo-png-text.h>
 #include <blxo/blxo-private.h>
+#include <blxo/blxo-thumbnail-path.h>
 #include <blxo/blxo-thumbnail.h>
 #include <blxo/blxo-alias.h>
 
@@ -63,6 +74,24 @@
 #define g_unlink(filename) (unlink ((filename)))
 #endif
 
+/* the maximum number of bytes of pixel data kept in the thumbnail cache */
+#define BLXO_THUMBNAIL_CACHE_MAX_BYTES (16u * 1024u * 1024u)
+
+/* the default zlib compression level of saved thumbnails, favouring speed */
+#define BLXO_THUMBNAIL_COMPRESSION (1)
+
+/* microseconds after which failures to load or generate a thumbnail are retried */
+#define BLXO_THUMBNAIL_CACHE_FAILURE_TTL (30 * G_USEC_PER_SEC)
+
+/* the mtime passed to blxo_thumbnail_cache_lookup() to accept only entries
+ * of watched files, which are evicted by the cache monitor on changes */
+#define BLXO_THUMBNAIL_MTIME_WATCHED ((time_t) -2)
+
+
+
+typedef struct _BlxoThumbnailKey   BlxoThumbnailKey;
+typedef struct _BlxoThumbnailEntry BlxoThumbnailEntry;
+
 
 
 static GdkPixbuf *blxo_thumbnail_load (const gchar *thumbnail_path,
@@ -77,15 +106,297 @@ static gboolean   blxo_thumbnail_save (GdkPixbuf   *thumbnail,
 
 
 
+struct _BlxoThumbnailKey
+{
+  gchar            *uri;
+  BlxoThumbnailSize  size;
+};
+
+struct _BlxoThumbnailEntry
+{
+  BlxoThumbnailKey key;
+
+  /* the mtime of the file the entry is valid for, or -1 if unknown */
+  time_t          mtime;
+
+  /* the file watched for the entry or %NULL, and whether changes of
+   * the file since the mtime was determined would have been reported */
+  gchar          *filename;
+  gboolean        watched;
+
+  /* the thumbnail, or %NULL and the error for failures */
+  GdkPixbuf      *thumbnail;
+  GError         *error;
+  gint64          expires;
+
+  gsize           n_bytes;
+  GList           lru_link;
+};
+
+
+
+/* flags of the thumbnail directories */
+enum
+{
+  THUMBNAIL_DIR_NO_TMPFILE = 1 << 0, /* O_TMPFILE is not supported by the file system */
+};
+
+/* The thumbnail directories that are known to exist, with flags for each. */
+static GHashTable *thumbnail_dirs = NULL;
+G_LOCK_DEFINE_STATIC (thumbnail_dirs);
+
+
+
+/* The thumbnail cache keeps recently loaded thumbnails, and recent failures
+ * to load or generate them, keyed by URI and size, and remembers the mtime
+ * of the file each entry is valid for. It is shared by the main thread and
+ * the icon cache workers, and therefore protected by a lock. The files of
+ * the entries are watched, and the entries are evicted when the file
+ * changes, so the entries of watched files are valid without a stat().
+ */
+static GHashTable *thumbnail_cache = NULL;
+static GQueue      thumbnail_cache_lru = G_QUEUE_INIT;
+static gsize       thumbnail_cache_n_bytes = 0;
+G_LOCK_DEFINE_STATIC (thumbnail_cache);
+
+
+
+static guint
+blxo_thumbnail_key_hash (gconstpointer data)
+{
+  const BlxoThumbnailKey *key = data;
+
+  return g_str_hash (key->uri) ^ (guint) key->size;
+}
+
+
+
+static gboolean
+blxo_thumbnail_key_equal (gconstpointer a,
+                         gconstpointer b)
+{
+  const BlxoThumbnailKey *key_a = a;
+  const BlxoThumbnailKey *key_b = b;
+
+  return (key_a->size == key_b->size && strcmp (key_a->uri, key_b->uri) == 0);
+}
+
+
+
+static void
+blxo_thumbnail_entry_free (gpointer data)
+{
+  BlxoThumbnailEntry *entry = data;
+
+  /* drop the entry from the LRU list */
+  g_queue_unlink (&thumbnail_cache_lru, &entry->lru_link);
+  thumbnail_cache_n_bytes -= entry->n_bytes;
+
+  if (G_LIKELY (entry->thumbnail != NULL))
+    g_object_unref (G_OBJECT (entry->thumbnail));
+  if (G_UNLIKELY (entry->error != NULL))
+    g_error_free (entry->error);
+  if (G_LIKELY (entry->filename != NULL))
+    {
+      _blxo_cache_monitor_unwatch (entry->filename);
+      g_free (entry->filename);
+    }
+  g_free (entry->key.uri);
+  g_slice_free (BlxoThumbnailEntry, entry);
+}
+
+
+
+static void
+blxo_thumbnail_cache_invalidate (GHashTable *filenames)
+{
+  BlxoThumbnailEntry *entry;
+  GHashTableIter     iter;
+
+  G_LOCK (thumbnail_cache);
+
+  /* drop the entries of the files that changed */
+  g_hash_table_iter_init (&iter, thumbnail_cache);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &entry))
+    if (entry->filename != NULL && g_hash_table_contains (filenames, entry->filename))
+      g_hash_table_iter_remove (&iter);
+
+  G_UNLOCK (thumbnail_cache);
+}
+
+
+
+static gboolean
+blxo_thumbnail_cache_lookup (const gchar      *uri,
+                            BlxoThumbnailSize  size,
+                            time_t            mtime,
+                            GdkPixbuf       **thumbnail_return,
+                            GError          **error)
+{
+  BlxoThumbnailEntry *entry;
+  BlxoThumbnailKey    key;
+  gboolean           found = FALSE;
+
+  key.uri = (gchar *) uri;
+  key.size = size;
+
+  G_LOCK (thumbnail_cache);
+
+  entry = (thumbnail_cache != NULL) ? g_hash_table_lookup (thumbnail_cache, &key) : NULL;
+  if (G_LIKELY (entry != NULL))
+    {
+      if (entry->thumbnail == NULL && entry->expires <= g_get_monotonic_time ())
+        {
+          /* the failure expired, try again */
+          g_hash_table_remove (thumbnail_cache, &entry->key);
+        }
+      else if (entry->mtime == mtime
+               || (mtime == (time_t) -1 && entry->thumbnail != NULL)
+               || (mtime == BLXO_THUMBNAIL_MTIME_WATCHED && entry->watched))
+        {
+          /* move the entry to the front of the LRU list */
+          g_queue_unlink (&thumbnail_cache_lru, &entry->lru_link);
+          g_queue_push_head_link (&thumbnail_cache_lru, &entry->lru_link);
+
+          if (G_LIKELY (entry->thumbnail != NULL))
+            *thumbnail_return = g_object_ref (G_OBJECT (entry->thumbnail));
+          else
+            g_propagate_error (error, g_error_copy (entry->error));
+          found = TRUE;
+        }
+      else if (mtime != (time_t) -1 && mtime != BLXO_THUMBNAIL_MTIME_WATCHED)
+        {
+          /* the file was modified since */
+          g_hash_table_remove (thumbnail_cache, &entry->key);
+        }
+    }
+
+  G_UNLOCK (thumbnail_cache);
+
+  return found;
+}
+
+
+
+static void
+blxo_thumbnail_cache_insert (const gchar      *uri,
+                            BlxoThumbnailSize  size,
+                            time_t            mtime,
+                            const gchar      *filename,
+                            guint             stamp,
+                            GdkPixbuf        *thumbnail,
+                            const GError     *error)
+{
+  BlxoThumbnailEntry *entry;
+
+  entry = g_slice_new0 (BlxoThumbnailEntry);
+  entry->key.uri = g_strdup (uri);
+  entry->key.size = size;
+  entry->mtime = mtime;
+  entry->lru_link.data = entry;
+  entry->n_bytes = sizeof (*entry) + strlen (uri);
+
+  if (G_LIKELY (thumbnail != NULL))
+    {
+      entry->thumbnail = g_object_ref (G_OBJECT (thumbnail));
+      entry->n_bytes += (gsize) gdk_pixbuf_get_rowstride (thumbnail) * gdk_pixbuf_get_height (thumbnail);
+    }
+  else
+    {
+      if (G_LIKELY (error != NULL))
+        entry->error = g_error_copy (error);
+      else
+        entry->error = g_error_new_literal (G_FILE_ERROR, G_FILE_ERROR_NOENT, g_strerror (ENOENT));
+      entry->expires = g_get_monotonic_time () + BLXO_THUMBNAIL_CACHE_FAILURE_TTL;
+    }
+
+  /* the entry is only trusted without a stat() if the file did not change since the
+   * @stamp, that was taken before the mtime was determined */
+  if (G_LIKELY (filename != NULL))
+    {
+      entry->filename = g_strdup (filename);
+      entry->watched = _blxo_cache_monitor_watch (filename, NULL) && !_blxo_cache_monitor_has_changed (filename, stamp);
+    }
+
+  G_LOCK (thumbnail_cache);
+
+  if (G_UNLIKELY (thumbnail_cache == NULL))
+    {
+      thumbnail_cache = g_hash_table_new_full (blxo_thumbnail_key_hash, blxo_thumbnail_key_equal, NULL, blxo_thumbnail_entry_free);
+      _blxo_cache_monitor_connect (blxo_thumbnail_cache_invalidate);
+    }
+
+  /* replaces the key as well, which is owned by the entry */
+  g_hash_table_replace (thumbnail_cache, &entry->key, entry);
+  g_queue_push_head_link (&thumbnail_cache_lru, &entry->lru_link);
+  thumbnail_cache_n_bytes += entry->n_bytes;
+
+  /* drop least recently used entries until we are below the budget */
+  while (thumbnail_cache_n_bytes > BLXO_THUMBNAIL_CACHE_MAX_BYTES && thumbnail_cache_lru.tail != &entry->lru_link)
+    g_hash_table_remove (thumbnail_cache, &((BlxoThumbnailEntry *) thumbnail_cache_lru.tail->data)->key);
+
+  G_UNLOCK (thumbnail_cache);
+}
+
+
+
+static inline gboolean
+blxo_thumbnail_size_is_valid (BlxoThumbnailSize size)
+{
+  return (size == BLXO_THUMBNAIL_SIZE_NORMAL || size == BLXO_THUMBNAIL_SIZE_LARGE
+       || size == BLXO_THUMBNAIL_SIZE_X_LARGE || size == BLXO_THUMBNAIL_SIZE_XX_LARGE);
+}
+
+
+
+static inline gboolean
+blxo_thumbnail_is_valid (const gchar *thumbnail_uri,
+                        const gchar *thumbnail_mtime,
+                        const gchar *uri,
+                        time_t       mtime)
+{
+  return (thumbnail_uri != NULL && thumbnail_mtime != NULL && strcmp (thumbnail_uri, uri) == 0
+       && (mtime == (time_t) -1 || strtoul (thumbnail_mtime, NULL, 10) == (gulong) mtime));
+}
+
+
+
 static GdkPixbuf*
 blxo_thumbnail_load (const gchar *thumbnail_path,
                     const gchar *uri,
                     time_t       mtime,
                     GError     **error)
 {
-  const gchar *thumbnail_mtime;
-  const gchar *thumbnail_uri;
-  GdkPixbuf   *thumbnail;
+  static const gchar *keys[] = { "Thumb::URI", "Thumb::MTime", NULL };
+  const gchar        *thumbnail_mtime;
+  const gchar        *thumbnail_uri;
+  GdkPixbuf          *thumbnail;
+  gchar              *values[2] = { NULL, NULL };
+  gboolean            valid;
+
+  /* read the URI and the mtime from the text chunks preceding the image data */
+  if (!_blxo_png_text_read (thumbnail_path, keys, values, error))
+    return NULL;
+
+  /* the options may also follow the image data, which requires a full decode to find out */
+  if (G_LIKELY (values[0] != NULL && values[1] != NULL))
+    {
+      valid = blxo_thumbnail_is_valid (values[0], values[1], uri, mtime);
+      g_free (values[0]);
+      g_free (values[1]);
+
+      /* don't decode stale or foreign thumbnails */
+      if (G_UNLIKELY (!valid))
+        {
+          g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_NOENT, "%s", g_strerror (ENOENT));
+          return NULL;
+        }
+
+      return gdk_pixbuf_new_from_file (thumbnail_path, error);
+    }
+
+  g_free (values[0]);
+  g_free (values[1]);
 
   /* try to load the thumbnail */
   thumbnail = gdk_pixbuf_new_from_file (thumbnail_path, error);
@@ -96,8 +407,7 @@ blxo_thumbnail_load (const gchar *thumbnail_path,
       thumbnail_mtime = gdk_pixbuf_get_option (thumbnail, "tEXt::Thumb::MTime");
 
       /* verify both the URI and the mtime for the thumbnail */
-      if (G_UNLIKELY (thumbnail_uri == NULL || thumbnail_mtime == NULL || strcmp (thumbnail_uri, uri) != 0
-                   || (mtime != (time_t) -1 && strtoul (thumbnail_mtime, NULL, 10) != (gulong) mtime)))
+      if (G_UNLIKELY (!blxo_thumbnail_is_valid (thumbnail_uri, thumbnail_mtime, uri, mtime)))
         {
           /* the thumbnail is invalid */
           g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_NOENT, "%s", g_strerror (ENOENT));
@@ -112,6 +422,145 @@ blxo_thumbnail_load (const gchar *thumbnail_path,
 
 
 
+static const gchar*
+blxo_thumbnail_get_compression (void)
+{
+  static const gchar *levels[] = { "0", "1", "2", "3", "4", "5", "6", "7", "8", "9" };
+  static gsize        level = 0;
+  const gchar        *value;
+  gsize               n = BLXO_THUMBNAIL_COMPRESSION;
+
+  /* BLXO_THUMBNAIL_COMPRESSION=0..9 in the environment overrides the zlib level */
+  if (g_once_init_enter (&level))
+    {
+      value = g_getenv ("BLXO_THUMBNAIL_COMPRESSION");
+      if (value != NULL && value[0] >= '0' && value[0] <= '9' && value[1] == '\0')
+        n = value[0] - '0';
+      g_once_init_leave (&level, n + 1);
+    }
+
+  return levels[level - 1];
+}
+
+
+
+static gboolean
+blxo_thumbnail_dir_prepare (const gchar *dirname,
+                           guint       *flags_return,
+                           GError     **error)
+{
+  gpointer flags;
+  gboolean known;
+
+  G_LOCK (thumbnail_dirs);
+  if (G_UNLIKELY (thumbnail_dirs == NULL))
+    thumbnail_dirs = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  known = g_hash_table_lookup_extended (thumbnail_dirs, dirname, NULL, &flags);
+  G_UNLOCK (thumbnail_dirs);
+
+  if (G_LIKELY (known))
+    {
+      *flags_return = GPOINTER_TO_UINT (flags);
+      return TRUE;
+    }
+
+  /* verify that the thumbnail directory exists */
+  if (!xfce_mkdirhier (dirname, 0700, error))
+    return FALSE;
+
+  G_LOCK (thumbnail_dirs);
+  g_hash_table_insert (thumbnail_dirs, g_strdup (dirname), GUINT_TO_POINTER (0));
+  G_UNLOCK (thumbnail_dirs);
+
+  *flags_return = 0;
+  return TRUE;
+}
+
+
+
+static void
+blxo_thumbnail_dir_forget (const gchar *dirname)
+{
+  /* the directory was removed behind our back */
+  G_LOCK (thumbnail_dirs);
+  g_hash_table_remove (thumbnail_dirs, dirname);
+  G_UNLOCK (thumbnail_dirs);
+}
+
+
+
+static gint
+blxo_thumbnail_open_temp (const gchar *dirname,
+                         guint        flags,
+                         const gchar *thumbnail_path,
+                         gchar      **tmp_path_return)
+{
+  gint fd;
+  gint sverrno;
+
+  *tmp_path_return = NULL;
+
+#if defined(O_TMPFILE) && defined(HAVE_LINKAT)
+  /* try to create an unnamed file, that becomes visible once it is complete */
+  if ((flags & THUMBNAIL_DIR_NO_TMPFILE) == 0)
+    {
+      fd = open (dirname, O_TMPFILE | O_WRONLY, 0600);
+      if (G_LIKELY (fd >= 0) || errno == ENOENT)
+        return fd;
+
+      /* the kernel or the file system does not support O_TMPFILE */
+      G_LOCK (thumbnail_dirs);
+      g_hash_table_insert (thumbnail_dirs, g_strdup (dirname), GUINT_TO_POINTER (flags | THUMBNAIL_DIR_NO_TMPFILE));
+      G_UNLOCK (thumbnail_dirs);
+    }
+#endif
+
+  /* try to create a temporary file to write the thumbnail to */
+  *tmp_path_return = g_strconcat (thumbnail_path, ".XXXXXX", NULL);
+  fd = g_mkstemp (*tmp_path_return);
+  if (G_UNLIKELY (fd < 0))
+    {
+      sverrno = errno;
+      g_free (*tmp_path_return);
+      *tmp_path_return = NULL;
+      errno = sverrno;
+    }
+
+  return fd;
+}
+
+
+
+static gboolean
+blxo_thumbnail_write (const gchar *buffer,
+                     gsize        count,
+                     GError     **error,
+                     gpointer     user_data)
+{
+  gssize n;
+  gint   fd = GPOINTER_TO_INT (user_data);
+
+  while (count > 0)
+    {
+      n = write (fd, buffer, count);
+      if (G_UNLIKELY (n < 0))
+        {
+          if (errno == EINTR)
+            continue;
+
+          g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errno), "%s", g_strerror (errno));
+          return FALSE;
+        }
+
+      buffer += n;
+      count -= n;
+    }
+
+  return TRUE;
+}
+
+
+
 static gboolean
 blxo_thumbnail_save (GdkPixbuf   *thumbnail,
                     const gchar *thumbnail_path,
@@ -123,64 +572,170 @@ blxo_thumbnail_save (GdkPixbuf   *thumbnail,
   gchar   *tmp_path;
   gchar   *dirname;
   gchar    smtime[32];
+  guint    flags;
+  guint    attempt;
   gint     tmp_fd;
+  gint     sverrno;
+#if defined(O_TMPFILE) && defined(HAVE_LINKAT)
+  gchar    fd_path[64];
+#endif
 
-  /* verify that the thumbnail directory exists */
   dirname = g_path_get_dirname (thumbnail_path);
-  succeed = xfce_mkdirhier (dirname, 0700, error);
-  g_free (dirname);
 
-  /* check if we succeed so far */
-  if (G_LIKELY (succeed))
+  for (attempt = 0;; ++attempt)
     {
-      /* try to create a temporary file to write the thumbnail to */
-      tmp_path = g_strconcat (thumbnail_path, ".XXXXXX", NULL);
-      tmp_fd = g_mkstemp (tmp_path);
-      if (G_UNLIKELY (tmp_fd < 0))
+      /* verify that the thumbnail directory exists, once per process */
+      if (!blxo_thumbnail_dir_prepare (dirname, &flags, error))
         {
-          g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errno), "%s", g_strerror (errno));
-          g_free (tmp_path);
+          g_free (dirname);
           return FALSE;
         }
-      close (tmp_fd);
 
-      /* determine the string representation of the mtime */
-      g_snprintf (smtime, sizeof (smtime), "%lu", (gulong) mtime);
+      tmp_fd = blxo_thumbnail_open_temp (dirname, flags, thumbnail_path, &tmp_path);
+      if (G_LIKELY (tmp_fd >= 0))
+        break;
 
-      /* write the thumbnail to the temporary location */
-      succeed = gdk_pixbuf_save (thumbnail, tmp_path, "png", error,
-                                 "tEXt::Thumb::URI", uri,
-                                 "tEXt::Thumb::MTime", smtime,
-                                 "tEXt::Software", PACKAGE_STRING,
-                                 NULL);
+      /* create the directory again, if it was removed since we checked it */
+      sverrno = errno;
+      if (sverrno == ENOENT && attempt == 0)
+        {
+          blxo_thumbnail_dir_forget (dirname);
+          continue;
+        }
 
+      g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (sverrno), "%s", g_strerror (sverrno));
+      g_free (dirname);
+      return FALSE;
+    }
+
+  /* determine the string representation of the mtime */
+  g_snprintf (smtime, sizeof (smtime), "%lu", (gulong) mtime);
+
+  /* write the thumbnail to the temporary file */
+  succeed = gdk_pixbuf_save_to_callback (thumbnail, blxo_thumbnail_write, GINT_TO_POINTER (tmp_fd), "png", error,
+                                         "tEXt::Thumb::URI", uri,
+                                         "tEXt::Thumb::MTime", smtime,
+                                         "tEXt::Software", PACKAGE_STRING,
+                                         "compression", blxo_thumbnail_get_compression (),
+                                         NULL);
+
+  if (G_LIKELY (tmp_path != NULL))
+    {
       /* rename the file to the final location */
       if (succeed && g_rename (tmp_path, thumbnail_path) < 0)
         {
           /* set an error and unlink the temporary file */
           g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errno), "%s", g_strerror (errno));
-          g_unlink (tmp_path);
           succeed = FALSE;
         }
 
-      /* cleanup */
-      g_free (tmp_path);
+      if (G_UNLIKELY (!succeed))
+        g_unlink (tmp_path);
     }
+#if defined(O_TMPFILE) && defined(HAVE_LINKAT)
+  else if (succeed)
+    {
+      /* give the unnamed file its name, replacing an outdated thumbnail */
+      g_snprintf (fd_path, sizeof (fd_path), "/proc/self/fd/%d", tmp_fd);
+      if (linkat (AT_FDCWD, fd_path, AT_FDCWD, thumbnail_path, AT_SYMLINK_FOLLOW) < 0
+          && (errno != EEXIST || g_unlink (thumbnail_path) < 0
+              || linkat (AT_FDCWD, fd_path, AT_FDCWD, thumbnail_path, AT_SYMLINK_FOLLOW) < 0))
+        {
+          /* another thread or process may have won the race, which is fine */
+          if (errno != EEXIST)
+            {
+              g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errno), "%s", g_strerror (errno));
+              succeed = FALSE;
+
+              /* use named temporary files from now on, e.g. if /proc is not mounted */
+              G_LOCK (thumbnail_dirs);
+              g_hash_table_insert (thumbnail_dirs, g_strdup (dirname), GUINT_TO_POINTER (flags | THUMBNAIL_DIR_NO_TMPFILE));
+              G_UNLOCK (thumbnail_dirs);
+            }
+        }
+    }
+#endif
+
+  /* cleanup */
+  close (tmp_fd);
+  g_free (tmp_path);
+  g_free (dirname);
 
   return succeed;
 }
 
 
 
+static gboolean
+blxo_thumbnail_has_failed (const gchar *fail_path,
+                          const gchar *uri,
+                          time_t       mtime,
+                          gboolean    *stale_return)
+{
+  static const gchar *keys[] = { "Thumb::URI", "Thumb::MTime", NULL };
+  gchar              *values[2] = { NULL, NULL };
+  gboolean            failed = FALSE;
+
+  *stale_return = FALSE;
+
+  /* check for a failure marker for this version of the file */
+  if (_blxo_png_text_read (fail_path, keys, values, NULL))
+    {
+      failed = blxo_thumbnail_is_valid (values[0], values[1], uri, mtime);
+      *stale_return = !failed;
+    }
+
+  g_free (values[0]);
+  g_free (values[1]);
+
+  return failed;
+}
+
+
+
+static void
+blxo_thumbnail_save_failure (const gchar *fail_path,
+                            const gchar *uri,
+                            time_t       mtime)
+{
+  GdkPixbuf *marker;
+  GError    *err = NULL;
+
+  /* failure markers are empty thumbnails, that only carry the URI and the mtime */
+  marker = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8, 1, 1);
+  gdk_pixbuf_fill (marker, 0x00000000);
+
+  if (!blxo_thumbnail_save (marker, fail_path, uri, mtime, &err))
+    {
+      /* we will just try again next time */
+      g_error_free (err);
+    }
+
+  g_object_unref (G_OBJECT (marker));
+}
+
+
+
 /**
  * _blxo_thumbnail_get_for_file:
  * @filename : the absolute path to the file for which to load or generate a thumbnail.
- * @size     : the desired thumbnail size, either %BLXO_THUMBNAIL_SIZE_NORMAL or %BLXO_THUMBNAIL_SIZE_LARGE.
+ * @size     : the desired #BlxoThumbnailSize.
  * @error    : return location for errors or %NULL.
  *
  * Loads the thumbnail stored for @filename in the thumbnail database if such a thumbnail exists. If no
  * such thumbnail exists, the function tries to generate a store a thumbnail for the @filename.
  *
+ * Files that cannot be decoded are recorded in the fail/ directory of the thumbnail
+ * database, and are not tried again until their mtime changes. Generated thumbnails
+ * are saved with zlib compression level 1, which can be changed by setting
+ * BLXO_THUMBNAIL_COMPRESSION to a level from 0 to 9 in the environment.
+ *
+ * Thumbnails are kept in memory for subsequent calls, as long as the mtime of @filename
+ * does not change. Failures are remembered for half a minute, so
+ * files that cannot be thumbnailed are not retried on every call. While the
+ * directory of @filename is monitored, the thumbnails kept in memory are
+ * dropped when the file changes, and returned without a stat() of @filename.
+ *
  * The caller is responsible to free the returned pixbuf using g_object_unref() when no longer needed.
  *
  * Returns: the #GdkPixbuf for the thumbnail of @filename or %NULL in case of an error.
@@ -189,65 +744,239 @@ GdkPixbuf*
 _blxo_thumbnail_get_for_file (const gchar     *filename,
                              BlxoThumbnailSize size,
                              GError         **error)
+{
+  GdkPixbuf *thumbnail;
+
+  _blxo_return_val_if_fail (blxo_thumbnail_size_is_valid (size), NULL);
+  _blxo_return_val_if_fail (error == NULL || *error == NULL, NULL);
+  _blxo_return_val_if_fail (g_path_is_absolute (filename), NULL);
+
+  _blxo_thumbnail_get_for_file_at_sizes (filename, &size, 1, &thumbnail, error);
+
+  return thumbnail;
+}
+
+
+
+/**
+ * _blxo_thumbnail_get_for_file_at_sizes:
+ * @filename   : the absolute path to the file for which to load or generate thumbnails.
+ * @sizes      : the desired thumbnail sizes.
+ * @n_sizes    : the number of @sizes, at most 32.
+ * @thumbnails : return location for the thumbnails, one for each of the @sizes.
+ * @error      : return location for errors or %NULL.
+ *
+ * Like _blxo_thumbnail_get_for_file(), but for several sizes at once. The
+ * file is decoded only once, at the largest of the @sizes that are not in
+ * the thumbnail database yet, and the thumbnails of the smaller sizes are
+ * scaled down from that image, and all of them are saved.
+ *
+ * The caller is responsible to free the returned pixbufs using g_object_unref()
+ * when no longer needed. Thumbnails that could not be loaded are %NULL.
+ *
+ * Returns: %TRUE if all thumbnails were loaded, %FALSE otherwise.
+ **/
+gboolean
+_blxo_thumbnail_get_for_file_at_sizes (const gchar            *filename,
+                                      const BlxoThumbnailSize *sizes,
+                                      guint                   n_sizes,
+                                      GdkPixbuf             **thumbnails,
+                                      GError                **error)
 {
   struct stat statb;
-  GdkPixbuf  *thumbnail = NULL;
+  GdkPixbuf  *rotated;
+  GdkPixbuf  *source;
+  gboolean    stale;
+  guint       stamp;
   GError     *err = NULL;
-  gchar      *name;
-  gchar      *path;
-  gchar      *md5;
+  GError     *gen_err = NULL;
+  guint32     missing = 0;
+  guint       largest = 0;
+  BlxoThumbnailPathBuilder *builder;
+  const gchar              *path;
+  gchar      *display_name;
+  gchar      *fail_path;
   gchar      *uri;
+  guint       n;
 
-  _blxo_return_val_if_fail (size == BLXO_THUMBNAIL_SIZE_NORMAL || size == BLXO_THUMBNAIL_SIZE_LARGE, NULL);
-  _blxo_return_val_if_fail (error == NULL || *error == NULL, NULL);
-  _blxo_return_val_if_fail (g_path_is_absolute (filename), NULL);
+  _blxo_return_val_if_fail (g_path_is_absolute (filename), FALSE);
+  _blxo_return_val_if_fail (n_sizes > 0 && n_sizes <= 32, FALSE);
+  _blxo_return_val_if_fail (thumbnails != NULL, FALSE);
+  _blxo_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  for (n = 0; n < n_sizes; ++n)
+    thumbnails[n] = NULL;
+
+  /* determine the URI of the file */
+  uri = g_filename_to_uri (filename, NULL, error);
+  if (G_UNLIKELY (uri == NULL))
+    return FALSE;
+
+  /* the entries of watched files are dropped when the file changes, so no stat() is needed */
+  for (n = 0; n < n_sizes; ++n)
+    if (!blxo_thumbnail_cache_lookup (uri, sizes[n], BLXO_THUMBNAIL_MTIME_WATCHED, &thumbnails[n], (err == NULL) ? &err : NULL))
+      break;
+
+  if (G_LIKELY (n == n_sizes))
+    {
+      g_free (uri);
+
+      if (G_UNLIKELY (err != NULL))
+        {
+          g_propagate_error (error, err);
+          return FALSE;
+        }
+
+      return TRUE;
+    }
+
+  /* the thumbnails found are looked up again below */
+  for (n = 0; n < n_sizes; ++n)
+    if (thumbnails[n] != NULL)
+      {
+        g_object_unref (G_OBJECT (thumbnails[n]));
+        thumbnails[n] = NULL;
+      }
+  g_clear_error (&err);
+
+  /* watch the file before the stat(), so changes after it are noticed */
+  _blxo_cache_monitor_watch (filename, &stamp);
 
-  /* stat the file first */
   if (stat (filename, &statb) < 0)
     {
       /* we cannot recover from here */
       g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errno), "%s", g_strerror (errno));
+      _blxo_cache_monitor_unwatch (filename);
+      g_free (uri);
+      return FALSE;
     }
-  else
+
+  builder = _blxo_thumbnail_path_builder_get_default ();
+
+  for (n = 0; n < n_sizes; ++n)
     {
-      /* determine the URI of the file */
-      uri = g_filename_to_uri (filename, NULL, error);
-      if (G_LIKELY (uri != NULL))
+      /* check if we loaded, or failed to load, the thumbnail for this version of the file before */
+      if (blxo_thumbnail_cache_lookup (uri, sizes[n], statb.st_mtime, &thumbnails[n], (err == NULL) ? &err : NULL))
+        continue;
+
+      /* try to load the thumbnail from the thumbnail database */
+      path = _blxo_thumbnail_path_builder_build (builder, uri, sizes[n]);
+      thumbnails[n] = blxo_thumbnail_load (path, uri, statb.st_mtime, NULL);
+
+      if (G_LIKELY (thumbnails[n] != NULL))
         {
-          /* determine the filename of the thumbnail */
-          md5 = g_compute_checksum_for_string (G_CHECKSUM_MD5, uri, -1);
-          name = g_strconcat (md5, ".png", NULL);
-          g_free (md5);
-
-          /* determine the path of the thumbnail */
-          path = g_build_path ("/", g_get_user_cache_dir(), "thumbnails", (size == BLXO_THUMBNAIL_SIZE_NORMAL) ? "normal" : "large", name, NULL);
-          g_free (name);
-
-          /* try to load the thumbnail */
-          thumbnail = blxo_thumbnail_load (path, uri, statb.st_mtime, NULL);
-          if (G_UNLIKELY (thumbnail == NULL))
+          blxo_thumbnail_cache_insert (uri, sizes[n], statb.st_mtime, filename, stamp, thumbnails[n], NULL);
+        }
+      else
+        {
+          /* generate this one */
+          missing |= 1u << n;
+          largest = MAX (largest, (guint) sizes[n]);
+        }
+    }
+
+  if (missing != 0)
+    {
+      /* determine the path of the failure marker */
+      fail_path = g_strdup (_blxo_thumbnail_path_builder_build_failure (builder, uri));
+
+      /* don't try again for files that failed before */
+      if (blxo_thumbnail_has_failed (fail_path, uri, statb.st_mtime, &stale))
+        {
+          display_name = g_filename_display_name (filename);
+          g_set_error (&gen_err, G_FILE_ERROR, G_FILE_ERROR_INVAL, "Failed to generate a thumbnail for \"%s\" before", display_name);
+          g_free (display_name);
+        }
+      else
+        {
+          /* decode the file once, at the largest size we need; an embedded
+           * preview is good enough for a thumbnail */
+          source = _blxo_gdk_pixbuf_new_from_file_at_max_size_full (filename, largest, largest, TRUE, TRUE, &gen_err);
+          if (G_LIKELY (source != NULL))
             {
-              /* try to generate a thumbnail for the file using the available GdkPixbufLoaders */
-              thumbnail = blxo_gdk_pixbuf_new_from_file_at_max_size (filename, size, size, TRUE, error);
-              if (G_LIKELY (thumbnail != NULL))
-                {
-                  /* save the generated thumbnail into the thumbnail database */
-                  if (!blxo_thumbnail_save (thumbnail, path, uri, statb.st_mtime, &err))
-                    {
-                      /* better let the user know whats going on, but no need to fail here */
-                      g_warning ("Failed to save generated thumbnail for \"%s\" to \"%s\": %s", filename, path, err->message);
-                      g_error_free (err);
-                    }
-                }
-            }
+              /* store the thumbnails upright */
+              rotated = gdk_pixbuf_apply_embedded_orientation (source);
+              g_object_unref (G_OBJECT (source));
+              source = rotated;
+
+              /* the file was fixed since it failed */
+              if (G_UNLIKELY (stale))
+                g_unlink (fail_path);
+
+              for (n = 0; n < n_sizes; ++n)
+                if ((missing & (1u << n)) != 0)
+                  {
+                    /* derive the smaller thumbnails from the decoded image */
+                    thumbnails[n] = blxo_gdk_pixbuf_scale_down (source, TRUE, sizes[n], sizes[n]);
 
-          /* cleanup */
-          g_free (path);
-          g_free (uri);
+                    /* save the generated thumbnail into the thumbnail database */
+                    path = _blxo_thumbnail_path_builder_build (builder, uri, sizes[n]);
+                    if (!blxo_thumbnail_save (thumbnails[n], path, uri, statb.st_mtime, &gen_err))
+                      {
+                        /* better let the user know whats going on, but no need to fail here */
+                        g_warning ("Failed to save generated thumbnail for \"%s\" to \"%s\": %s", filename, path, gen_err->message);
+                        g_clear_error (&gen_err);
+                      }
+                  }
+
+              g_object_unref (G_OBJECT (source));
+            }
+          else if (gen_err == NULL || gen_err->domain != G_FILE_ERROR)
+            {
+              /* remember files that could be read, but not decoded */
+              blxo_thumbnail_save_failure (fail_path, uri, statb.st_mtime);
+            }
         }
+
+      /* remember the thumbnails, or that we failed to generate them */
+      for (n = 0; n < n_sizes; ++n)
+        if ((missing & (1u << n)) != 0)
+          blxo_thumbnail_cache_insert (uri, sizes[n], statb.st_mtime, filename, stamp, thumbnails[n], gen_err);
+
+      /* report the first error */
+      if (G_LIKELY (err == NULL))
+        err = gen_err;
+      else if (gen_err != NULL)
+        g_error_free (gen_err);
+
+      g_free (fail_path);
     }
 
-  return thumbnail;
+  /* cleanup */
+  _blxo_cache_monitor_unwatch (filename);
+  g_free (uri);
+
+  if (G_UNLIKELY (err != NULL))
+    {
+      g_propagate_error (error, err);
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+
+
+/**
+ * _blxo_thumbnail_size_for:
+ * @pixels : the size in device pixels an image is displayed at.
+ *
+ * Determines the smallest #BlxoThumbnailSize, that is not scaled up to display
+ * an image at @pixels, or the largest size for larger images.
+ *
+ * Returns: the #BlxoThumbnailSize for @pixels.
+ **/
+BlxoThumbnailSize
+_blxo_thumbnail_size_for (gint pixels)
+{
+  if (pixels <= BLXO_THUMBNAIL_SIZE_NORMAL)
+    return BLXO_THUMBNAIL_SIZE_NORMAL;
+  else if (pixels <= BLXO_THUMBNAIL_SIZE_LARGE)
+    return BLXO_THUMBNAIL_SIZE_LARGE;
+  else if (pixels <= BLXO_THUMBNAIL_SIZE_X_LARGE)
+    return BLXO_THUMBNAIL_SIZE_X_LARGE;
+  else
+    return BLXO_THUMBNAIL_SIZE_XX_LARGE;
 }
 
 
@@ -259,7 +988,8 @@ _blxo_thumbnail_get_for_file (const gchar     *filename,
  * @error : return location for errors or %NULL.
  *
  * Similar to _blxo_thumbnail_get_for_file(), but does not try to generate
- * a thumbnail if no valid thumbnail is found.
+ * a thumbnail if no valid thumbnail is found. Since the mtime of the file is
+ * not known, any thumbnail cached for the @uri is returned.
  *
  * Returns: the thumbnail for the @uri or %NULL.
  **/
@@ -268,27 +998,28 @@ _blxo_thumbnail_get_for_uri (const gchar     *uri,
                             BlxoThumbnailSize size,
                             GError         **error)
 {
-  GdkPixbuf *thumbnail;
-  gchar     *name;
-  gchar     *path;
-  gchar     *md5;
+  GdkPixbuf   *thumbnail = NULL;
+  GError      *err = NULL;
+  const gchar *path;
 
-  _blxo_return_val_if_fail (size == BLXO_THUMBNAIL_SIZE_NORMAL || size == BLXO_THUMBNAIL_SIZE_LARGE, NULL);
+  _blxo_return_val_if_fail (blxo_thumbnail_size_is_valid (size), NULL);
   _blxo_return_val_if_fail (error == NULL || *error == NULL, NULL);
   _blxo_return_val_if_fail (uri != NULL, NULL);
 
-  /* determine the filename of the thumbnail */
-  md5 = g_compute_checksum_for_string (G_CHECKSUM_MD5, uri, -1);
-  name = g_strconcat (md5, ".png", NULL);
-  g_free (md5);
+  /* check if we loaded, or failed to load, the thumbnail before */
+  if (blxo_thumbnail_cache_lookup (uri, size, (time_t) -1, &thumbnail, error))
+    return thumbnail;
 
   /* determine the path of the thumbnail */
-  path = g_build_path ("/", g_get_user_cache_dir(), "thumbnails", (size == BLXO_THUMBNAIL_SIZE_NORMAL) ? "normal" : "large", name, NULL);
-  g_free (name);
+  path = _blxo_thumbnail_path_builder_build (_blxo_thumbnail_path_builder_get_default (), uri, size);
 
   /* try to load the thumbnail */
-  thumbnail = blxo_thumbnail_load (path, uri, (time_t) -1, error);
-  g_free (path);
+  thumbnail = blxo_thumbnail_load (path, uri, (time_t) -1, &err);
+
+  /* remember the thumbnail, or that there is none */
+  blxo_thumbnail_cache_insert (uri, size, (time_t) -1, NULL, 0, thumbnail, err);
+  if (G_UNLIKELY (err != NULL))
+    g_propagate_error (error, err);
 
   return thumbnail;
 }
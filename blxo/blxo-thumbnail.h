@@ -32,24 +32,35 @@ G_BEGIN_DECLS
 
 /**
  * BlxoThumbnailSize:
- * @BLXO_THUMBNAIL_SIZE_NORMAL : normal sized thumbnails (up to 128px).
- * @BLXO_THUMBNAIL_SIZE_LARGE  : large sized thumbnails.
+ * @BLXO_THUMBNAIL_SIZE_NORMAL   : normal sized thumbnails (up to 128px).
+ * @BLXO_THUMBNAIL_SIZE_LARGE    : large sized thumbnails (up to 256px).
+ * @BLXO_THUMBNAIL_SIZE_X_LARGE  : x-large sized thumbnails (up to 512px).
+ * @BLXO_THUMBNAIL_SIZE_XX_LARGE : xx-large sized thumbnails (up to 1024px).
  *
  * Thumbnail sizes used by the thumbnail database.
  **/
 typedef enum /*< skip >*/
 {
-  BLXO_THUMBNAIL_SIZE_NORMAL = 128,
-  BLXO_THUMBNAIL_SIZE_LARGE  = 256,
+  BLXO_THUMBNAIL_SIZE_NORMAL   = 128,
+  BLXO_THUMBNAIL_SIZE_LARGE    = 256,
+  BLXO_THUMBNAIL_SIZE_X_LARGE  = 512,
+  BLXO_THUMBNAIL_SIZE_XX_LARGE = 1024,
 } BlxoThumbnailSize;
 
 G_GNUC_INTERNAL GdkPixbuf *_blxo_thumbnail_get_for_file (const gchar     *filename,
                                                         BlxoThumbnailSize size,
                                                         GError         **error) G_GNUC_MALLOC G_GNUC_WARN_UNUSED_RESULT;
+G_GNUC_INTERNAL gboolean   _blxo_thumbnail_get_for_file_at_sizes (const gchar            *filename,
+                                                                 const BlxoThumbnailSize *sizes,
+                                                                 guint                   n_sizes,
+                                                                 GdkPixbuf             **thumbnails,
+                                                                 GError                **error);
 G_GNUC_INTERNAL GdkPixbuf *_blxo_thumbnail_get_for_uri  (const gchar     *uri,
                                                         BlxoThumbnailSize size,
                                                         GError         **error) G_GNUC_MALLOC G_GNUC_WARN_UNUSED_RESULT;
 
+G_GNUC_INTERNAL BlxoThumbnailSize _blxo_thumbnail_size_for (gint pixels) G_GNUC_CONST;
+
 G_END_DECLS
 
 #endif /* !__BLXO_THUMBNAIL_H__ */
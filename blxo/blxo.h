@@ -44,6 +44,7 @@
 #include <blxo/blxo-job.h>
 #include <blxo/blxo-simple-job.h>
 #include <blxo/blxo-string.h>
+#include <blxo/blxo-thumbnail-gc.h>
 #include <blxo/blxo-utils.h>
 #include <blxo/blxo-gtk-extensions.h>
 #include <blxo/blxo-icon-chooser-dialog.h>
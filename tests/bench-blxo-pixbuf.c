@@ -0,0 +1,773 @@
+/*
+ * Copyright (c) 2026 Xfce Development Team <xfce4-dev@xfce.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+/*
+ * Checks the gdk-pixbuf extensions against the scalar reference
+ * implementations below, and measures their throughput in megapixels
+ * per second. The kernels picked for this CPU are tested directly, the
+ * SSE2 and scalar kernels in subprocesses, using BLXO_PIXBUF_KERNELS.
+ *
+ * Run with --verbose to see the throughput, or with -m perf to measure
+ * for one second per case instead of a few milliseconds.
+ *
+ * All results must be bit-exact, except for large images scaled down
+ * with the box filter pre-reduction, which are compared against the
+ * bilinear filter of gdk-pixbuf with SCALE_MAX_MEAN_DIFF on average and
+ * SCALE_MAX_DIFF per channel, using smooth gradients.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#ifdef HAVE_MATH_H
+#include <math.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include <blxo/blxo.h>
+
+/* tolerances for the box filter pre-reduction of large images */
+#define SCALE_MAX_MEAN_DIFF (2.0)
+#define SCALE_MAX_DIFF      (24)
+
+
+
+typedef GdkPixbuf *(*BenchFunc) (const GdkPixbuf *source);
+
+typedef struct
+{
+  gint width;
+  gint height;
+} TestSize;
+
+static const TestSize test_sizes[] =
+{
+  {    1,    1 },
+  {    7,    5 },
+  {   33,   17 },
+  {  127,  129 },
+  {  640,  480 },
+  { 1500, 1000 },
+};
+
+static const GdkColor test_color = { 0, 0xffff, 0x8000, 0x1234 };
+
+
+
+static GdkPixbuf*
+create_pixbuf (gint     width,
+               gint     height,
+               gboolean has_alpha,
+               gint     padding,
+               gboolean gradient)
+{
+  GRand  *rand;
+  guchar *pixels;
+  guchar *p;
+  gint    n_channels = has_alpha ? 4 : 3;
+  gint    rowstride;
+  gint    x, y;
+
+  /* odd paddings give unaligned rows */
+  rowstride = width * n_channels + padding;
+  pixels = g_malloc (rowstride * height);
+  rand = g_rand_new_with_seed (width * 31 + height);
+
+  for (y = 0; y < height; ++y)
+    for (x = 0, p = pixels + y * rowstride; x < width; ++x, p += n_channels)
+      {
+        if (gradient)
+          {
+            p[0] = x * 255 / MAX (width - 1, 1);
+            p[1] = y * 255 / MAX (height - 1, 1);
+            p[2] = (x + y) * 255 / MAX (width + height - 2, 1);
+            if (has_alpha)
+              p[3] = 128 + (x * 127 / MAX (width - 1, 1));
+          }
+        else
+          {
+            p[0] = g_rand_int (rand);
+            p[1] = g_rand_int (rand);
+            p[2] = g_rand_int (rand);
+            if (has_alpha)
+              p[3] = g_rand_int (rand);
+          }
+      }
+
+  g_rand_free (rand);
+
+  return gdk_pixbuf_new_from_data (pixels, GDK_COLORSPACE_RGB, has_alpha, 8, width, height,
+                                   rowstride, (GdkPixbufDestroyNotify) g_free, NULL);
+}
+
+
+
+static void
+assert_pixbufs_equal (const GdkPixbuf *a,
+                      const GdkPixbuf *b,
+                      gint             max_diff,
+                      gdouble          max_mean_diff)
+{
+  const guchar *pa;
+  const guchar *pb;
+  gdouble       sum = 0.0;
+  gint          diff;
+  gint          n_bytes;
+  gint          x, y;
+
+  g_assert_cmpint (gdk_pixbuf_get_width (a), ==, gdk_pixbuf_get_width (b));
+  g_assert_cmpint (gdk_pixbuf_get_height (a), ==, gdk_pixbuf_get_height (b));
+  g_assert_cmpint (gdk_pixbuf_get_n_channels (a), ==, gdk_pixbuf_get_n_channels (b));
+
+  n_bytes = gdk_pixbuf_get_width (a) * gdk_pixbuf_get_n_channels (a);
+  for (y = 0; y < gdk_pixbuf_get_height (a); ++y)
+    {
+      pa = gdk_pixbuf_get_pixels (a) + y * gdk_pixbuf_get_rowstride (a);
+      pb = gdk_pixbuf_get_pixels (b) + y * gdk_pixbuf_get_rowstride (b);
+      for (x = 0; x < n_bytes; ++x)
+        {
+          diff = ABS (pa[x] - pb[x]);
+          g_assert_cmpint (diff, <=, max_diff);
+          sum += diff;
+        }
+    }
+
+  g_assert_cmpfloat (sum / ((gdouble) n_bytes * gdk_pixbuf_get_height (a)), <=, max_mean_diff);
+}
+
+
+
+static void
+assert_surfaces_equal (cairo_surface_t *a,
+                       cairo_surface_t *b,
+                       gint             max_diff)
+{
+  const guchar *pa;
+  const guchar *pb;
+  gint          x, y;
+
+  cairo_surface_flush (a);
+  cairo_surface_flush (b);
+
+  g_assert_cmpint (cairo_image_surface_get_width (a), ==, cairo_image_surface_get_width (b));
+  g_assert_cmpint (cairo_image_surface_get_height (a), ==, cairo_image_surface_get_height (b));
+
+  for (y = 0; y < cairo_image_surface_get_height (a); ++y)
+    {
+      pa = cairo_image_surface_get_data (a) + y * cairo_image_surface_get_stride (a);
+      pb = cairo_image_surface_get_data (b) + y * cairo_image_surface_get_stride (b);
+      for (x = 0; x < cairo_image_surface_get_width (a) * 4; ++x)
+        g_assert_cmpint (ABS (pa[x] - pb[x]), <=, max_diff);
+    }
+}
+
+
+
+static void
+bench (const gchar     *name,
+       BenchFunc        func,
+       const GdkPixbuf *source)
+{
+  GdkPixbuf *result;
+  gdouble    megapixels;
+  gint64     budget;
+  gint64     start;
+  gint64     elapsed;
+  gint       n;
+
+  /* a few milliseconds are enough to spot regressions */
+  budget = g_test_perf () ? G_USEC_PER_SEC : 5000;
+  megapixels = gdk_pixbuf_get_width (source) * gdk_pixbuf_get_height (source) / 1e6;
+
+  start = g_get_monotonic_time ();
+  for (n = 0, elapsed = 0; elapsed < budget; ++n, elapsed = g_get_monotonic_time () - start)
+    {
+      result = (*func) (source);
+      g_object_unref (G_OBJECT (result));
+    }
+
+  g_test_maximized_result (megapixels * n * G_USEC_PER_SEC / MAX (elapsed, 1),
+                           "%s %dx%d%s: %.1f MP/s", name,
+                           gdk_pixbuf_get_width (source), gdk_pixbuf_get_height (source),
+                           gdk_pixbuf_get_has_alpha (source) ? " alpha" : "",
+                           megapixels * n * G_USEC_PER_SEC / MAX (elapsed, 1));
+}
+
+
+
+/* runs @check for all sizes, with and without alpha, padding and aligned rows */
+static void
+foreach_pixbuf (void     (*check) (const GdkPixbuf *source),
+                gboolean   gradient)
+{
+  GdkPixbuf *source;
+  GdkPixbuf *subpixbuf;
+  guint      n;
+  gint       has_alpha;
+
+  for (n = 0; n < G_N_ELEMENTS (test_sizes); ++n)
+    for (has_alpha = 0; has_alpha < 2; ++has_alpha)
+      {
+        /* rows with an odd padding */
+        source = create_pixbuf (test_sizes[n].width, test_sizes[n].height, has_alpha, 3, gradient);
+        (*check) (source);
+
+        /* rows starting at an odd address */
+        if (test_sizes[n].width > 1)
+          {
+            subpixbuf = gdk_pixbuf_new_subpixbuf (source, 1, 0, test_sizes[n].width - 1, test_sizes[n].height);
+            (*check) (subpixbuf);
+            g_object_unref (G_OBJECT (subpixbuf));
+          }
+
+        g_object_unref (G_OBJECT (source));
+      }
+}
+
+
+
+static GdkPixbuf*
+reference_colorize (const GdkPixbuf *source,
+                    const GdkColor  *color)
+{
+  GdkPixbuf *dst;
+  guint16    factors[3];
+  guchar    *p;
+  gint       n_channels;
+  gint       x, y, c;
+
+  factors[0] = color->red / 255.0;
+  factors[1] = color->green / 255.0;
+  factors[2] = color->blue / 255.0;
+
+  dst = gdk_pixbuf_copy (source);
+  n_channels = gdk_pixbuf_get_n_channels (dst);
+  for (y = 0; y < gdk_pixbuf_get_height (dst); ++y)
+    for (x = 0, p = gdk_pixbuf_get_pixels (dst) + y * gdk_pixbuf_get_rowstride (dst); x < gdk_pixbuf_get_width (dst); ++x, p += n_channels)
+      for (c = 0; c < 3; ++c)
+        p[c] = (p[c] * factors[c]) >> 8;
+
+  return dst;
+}
+
+
+
+static GdkPixbuf*
+reference_spotlight (const GdkPixbuf *source)
+{
+  GdkPixbuf *dst;
+  guchar    *p;
+  gint       n_channels;
+  gint       x, y, c;
+
+  dst = gdk_pixbuf_copy (source);
+  n_channels = gdk_pixbuf_get_n_channels (dst);
+  for (y = 0; y < gdk_pixbuf_get_height (dst); ++y)
+    for (x = 0, p = gdk_pixbuf_get_pixels (dst) + y * gdk_pixbuf_get_rowstride (dst); x < gdk_pixbuf_get_width (dst); ++x, p += n_channels)
+      for (c = 0; c < 3; ++c)
+        p[c] = MIN (p[c] + 24 + (p[c] >> 3), 255);
+
+  return dst;
+}
+
+
+
+static GdkPixbuf*
+reference_lucent (const GdkPixbuf *source,
+                  guint            percent)
+{
+  const guchar *s;
+  GdkPixbuf    *dst;
+  guchar       *d;
+  gint          n_channels;
+  gint          x, y;
+
+  dst = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8, gdk_pixbuf_get_width (source), gdk_pixbuf_get_height (source));
+  n_channels = gdk_pixbuf_get_n_channels (source);
+  for (y = 0; y < gdk_pixbuf_get_height (dst); ++y)
+    {
+      s = gdk_pixbuf_get_pixels (source) + y * gdk_pixbuf_get_rowstride (source);
+      d = gdk_pixbuf_get_pixels (dst) + y * gdk_pixbuf_get_rowstride (dst);
+      for (x = 0; x < gdk_pixbuf_get_width (dst); ++x, s += n_channels, d += 4)
+        {
+          d[0] = s[0];
+          d[1] = s[1];
+          d[2] = s[2];
+          d[3] = ((n_channels == 4 ? s[3] : 255u) * percent) / 100u;
+        }
+    }
+
+  return dst;
+}
+
+
+
+static GdkPixbuf*
+reference_frame (const GdkPixbuf *source,
+                 const GdkPixbuf *frame,
+                 gint             left,
+                 gint             top,
+                 gint             right,
+                 gint             bottom)
+{
+  GdkPixbuf *dst;
+  gint       frame_width = gdk_pixbuf_get_width (frame);
+  gint       frame_height = gdk_pixbuf_get_height (frame);
+  gint       src_width = gdk_pixbuf_get_width (source);
+  gint       src_height = gdk_pixbuf_get_height (source);
+  gint       dst_width = src_width + left + right;
+  gint       dst_height = src_height + top + bottom;
+  gint       edge_width = frame_width - left - right;
+  gint       edge_height = frame_height - top - bottom;
+  gint       n, slab;
+
+  dst = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8, dst_width, dst_height);
+
+  /* the corners */
+  gdk_pixbuf_copy_area (frame, 0, 0, left, top, dst, 0, 0);
+  gdk_pixbuf_copy_area (frame, frame_width - right, 0, right, top, dst, dst_width - right, 0);
+  gdk_pixbuf_copy_area (frame, 0, frame_height - bottom, left, bottom, dst, 0, dst_height - bottom);
+  gdk_pixbuf_copy_area (frame, frame_width - right, frame_height - bottom, right, bottom, dst, dst_width - right, dst_height - bottom);
+
+  /* the edges, slab by slab */
+  for (n = 0; n < src_width; n += slab)
+    {
+      slab = MIN (edge_width, src_width - n);
+      gdk_pixbuf_copy_area (frame, left, 0, slab, top, dst, left + n, 0);
+      gdk_pixbuf_copy_area (frame, left, frame_height - bottom, slab, bottom, dst, left + n, dst_height - bottom);
+    }
+
+  for (n = 0; n < src_height; n += slab)
+    {
+      slab = MIN (edge_height, src_height - n);
+      gdk_pixbuf_copy_area (frame, 0, top, left, slab, dst, 0, top + n);
+      gdk_pixbuf_copy_area (frame, frame_width - right, top, right, slab, dst, dst_width - right, top + n);
+    }
+
+  gdk_pixbuf_copy_area (source, 0, 0, src_width, src_height, dst, left, top);
+
+  return dst;
+}
+
+
+
+static GdkPixbuf*
+bench_colorize (const GdkPixbuf *source)
+{
+  return blxo_gdk_pixbuf_colorize (source, &test_color);
+}
+
+
+
+static GdkPixbuf*
+bench_lucent (const GdkPixbuf *source)
+{
+  return blxo_gdk_pixbuf_lucent (source, 50);
+}
+
+
+
+static GdkPixbuf*
+bench_scale_down (const GdkPixbuf *source)
+{
+  return blxo_gdk_pixbuf_scale_down ((GdkPixbuf *) source, TRUE, 128, 128);
+}
+
+
+
+static GdkPixbuf*
+bench_scale_ratio (const GdkPixbuf *source)
+{
+  return blxo_gdk_pixbuf_scale_ratio ((GdkPixbuf *) source, 256);
+}
+
+
+
+static GdkPixbuf*
+bench_effects (const GdkPixbuf *source)
+{
+  BlxoGdkPixbufEffects effects = { 128, 128, &test_color, TRUE, TRUE, 50 };
+
+  return blxo_gdk_pixbuf_apply_effects (source, &effects);
+}
+
+
+
+static void
+check_colorize (const GdkPixbuf *source)
+{
+  GdkPixbuf *expected;
+  GdkPixbuf *result;
+
+  expected = reference_colorize (source, &test_color);
+
+  result = blxo_gdk_pixbuf_colorize (source, &test_color);
+  assert_pixbufs_equal (result, expected, 0, 0.0);
+  g_object_unref (G_OBJECT (result));
+
+  result = gdk_pixbuf_copy (source);
+  blxo_gdk_pixbuf_colorize_inplace (result, &test_color);
+  assert_pixbufs_equal (result, expected, 0, 0.0);
+  g_object_unref (G_OBJECT (result));
+
+  bench ("colorize", bench_colorize, source);
+  g_object_unref (G_OBJECT (expected));
+}
+
+
+
+static void
+check_spotlight (const GdkPixbuf *source)
+{
+  GdkPixbuf *expected;
+  GdkPixbuf *result;
+
+  expected = reference_spotlight (source);
+
+  result = blxo_gdk_pixbuf_spotlight (source);
+  assert_pixbufs_equal (result, expected, 0, 0.0);
+  g_object_unref (G_OBJECT (result));
+
+  result = gdk_pixbuf_copy (source);
+  blxo_gdk_pixbuf_spotlight_inplace (result);
+  assert_pixbufs_equal (result, expected, 0, 0.0);
+  g_object_unref (G_OBJECT (result));
+
+  bench ("spotlight", blxo_gdk_pixbuf_spotlight, source);
+  g_object_unref (G_OBJECT (expected));
+}
+
+
+
+static void
+check_lucent (const GdkPixbuf *source)
+{
+  GdkPixbuf *expected;
+  GdkPixbuf *result;
+  guint      percent;
+
+  for (percent = 0; percent <= 100; percent += 25)
+    {
+      expected = reference_lucent (source, percent);
+      result = blxo_gdk_pixbuf_lucent (source, percent);
+      assert_pixbufs_equal (result, expected, 0, 0.0);
+      g_object_unref (G_OBJECT (result));
+      g_object_unref (G_OBJECT (expected));
+    }
+
+  bench ("lucent", bench_lucent, source);
+}
+
+
+
+static void
+check_scale_down (const GdkPixbuf *source)
+{
+  GdkPixbuf *expected;
+  GdkPixbuf *result;
+  gboolean   large;
+  gint       width = gdk_pixbuf_get_width (source);
+  gint       height = gdk_pixbuf_get_height (source);
+  gint       dest_width;
+  gint       dest_height;
+
+  result = blxo_gdk_pixbuf_scale_down ((GdkPixbuf *) source, TRUE, 128, 128);
+  if (width <= 128 && height <= 128)
+    {
+      /* nothing to scale */
+      g_assert (result == source);
+    }
+  else
+    {
+      dest_width = MAX (gdk_pixbuf_get_width (result), 1);
+      dest_height = MAX (gdk_pixbuf_get_height (result), 1);
+      g_assert_cmpint (MAX (dest_width, dest_height), ==, 128);
+
+      /* large images go through the box filter pre-reduction */
+      large = ((gint64) width * height >= 1024 * 1024);
+      expected = gdk_pixbuf_scale_simple (source, dest_width, dest_height, GDK_INTERP_BILINEAR);
+      assert_pixbufs_equal (result, expected, large ? SCALE_MAX_DIFF : 0, large ? SCALE_MAX_MEAN_DIFF : 0.0);
+      g_object_unref (G_OBJECT (expected));
+    }
+  g_object_unref (G_OBJECT (result));
+
+  bench ("scale-down", bench_scale_down, source);
+}
+
+
+
+static void
+check_scale_ratio (const GdkPixbuf *source)
+{
+  GdkPixbuf *expected;
+  GdkPixbuf *result;
+  gboolean   large;
+  gint       width = gdk_pixbuf_get_width (source);
+  gint       height = gdk_pixbuf_get_height (source);
+
+  result = blxo_gdk_pixbuf_scale_ratio ((GdkPixbuf *) source, 256);
+  g_assert_cmpint (MAX (gdk_pixbuf_get_width (result), gdk_pixbuf_get_height (result)), ==, 256);
+  if (width >= height)
+    g_assert_cmpint (gdk_pixbuf_get_height (result), ==, MAX ((gint) rint (height * 256.0 / width), 1));
+  else
+    g_assert_cmpint (gdk_pixbuf_get_width (result), ==, MAX ((gint) rint (width * 256.0 / height), 1));
+
+  /* large images go through the box filter pre-reduction */
+  large = ((gint64) width * height >= 1024 * 1024);
+  expected = gdk_pixbuf_scale_simple (source, gdk_pixbuf_get_width (result), gdk_pixbuf_get_height (result), GDK_INTERP_BILINEAR);
+  assert_pixbufs_equal (result, expected, large ? SCALE_MAX_DIFF : 0, large ? SCALE_MAX_MEAN_DIFF : 0.0);
+  g_object_unref (G_OBJECT (expected));
+  g_object_unref (G_OBJECT (result));
+
+  bench ("scale-ratio", bench_scale_ratio, source);
+}
+
+
+
+static void
+check_effects (const GdkPixbuf *source)
+{
+  BlxoGdkPixbufEffects effects = { 128, 128, &test_color, TRUE, TRUE, 50 };
+  GdkPixbuf           *expected;
+  GdkPixbuf           *result;
+  GdkPixbuf           *temp;
+
+  /* the fused pipeline must match the separate steps */
+  expected = blxo_gdk_pixbuf_scale_down ((GdkPixbuf *) source, TRUE, 128, 128);
+  temp = blxo_gdk_pixbuf_colorize (expected, &test_color);
+  g_object_unref (G_OBJECT (expected));
+  expected = blxo_gdk_pixbuf_spotlight (temp);
+  g_object_unref (G_OBJECT (temp));
+  temp = blxo_gdk_pixbuf_lucent (expected, 50);
+  g_object_unref (G_OBJECT (expected));
+  expected = temp;
+
+  result = blxo_gdk_pixbuf_apply_effects (source, &effects);
+  assert_pixbufs_equal (result, expected, 0, 0.0);
+  g_object_unref (G_OBJECT (result));
+  g_object_unref (G_OBJECT (expected));
+
+  bench ("effects", bench_effects, source);
+}
+
+
+
+static void
+check_frame (const GdkPixbuf *source)
+{
+  BlxoPixbufFrame *frame;
+  GdkPixbuf       *image;
+  GdkPixbuf       *expected;
+  GdkPixbuf       *result;
+  gint             n;
+
+  /* a frame image with edges shorter than most images */
+  image = create_pixbuf (17, 13, TRUE, 1, FALSE);
+  expected = reference_frame (source, image, 4, 3, 5, 6);
+
+  result = blxo_gdk_pixbuf_frame (source, image, 4, 3, 5, 6);
+  assert_pixbufs_equal (result, expected, 0, 0.0);
+  g_object_unref (G_OBJECT (result));
+
+  /* the second application uses the cached background */
+  frame = blxo_pixbuf_frame_new (image, 4, 3, 5, 6);
+  for (n = 0; n < 2; ++n)
+    {
+      result = blxo_pixbuf_frame_apply (frame, source);
+      assert_pixbufs_equal (result, expected, 0, 0.0);
+      g_object_unref (G_OBJECT (result));
+    }
+  blxo_pixbuf_frame_unref (frame);
+
+  g_object_unref (G_OBJECT (expected));
+  g_object_unref (G_OBJECT (image));
+}
+
+
+
+static void
+check_surfaces (const GdkPixbuf *source)
+{
+  cairo_surface_t *expected;
+  cairo_surface_t *surface;
+  cairo_surface_t *scaled;
+  GdkPixbuf       *gradient;
+  GdkPixbuf       *opaque;
+  GdkPixbuf       *temp;
+
+  /* premultiplication is lossless for opaque images */
+  opaque = gdk_pixbuf_add_alpha (source, FALSE, 0, 0, 0);
+  gdk_pixbuf_fill (opaque, 0x000000ff);
+  gdk_pixbuf_composite (source, opaque, 0, 0, gdk_pixbuf_get_width (source), gdk_pixbuf_get_height (source),
+                        0.0, 0.0, 1.0, 1.0, GDK_INTERP_NEAREST, 255);
+
+  temp = blxo_gdk_pixbuf_colorize (opaque, &test_color);
+  expected = blxo_gdk_pixbuf_create_surface (temp);
+  g_object_unref (G_OBJECT (temp));
+  surface = blxo_gdk_pixbuf_create_surface (opaque);
+  blxo_cairo_surface_colorize (surface, &test_color);
+  assert_surfaces_equal (surface, expected, 0);
+  cairo_surface_destroy (expected);
+  cairo_surface_destroy (surface);
+
+  temp = blxo_gdk_pixbuf_spotlight (opaque);
+  expected = blxo_gdk_pixbuf_create_surface (temp);
+  g_object_unref (G_OBJECT (temp));
+  surface = blxo_gdk_pixbuf_create_surface (opaque);
+  blxo_cairo_surface_spotlight (surface);
+  assert_surfaces_equal (surface, expected, 0);
+  cairo_surface_destroy (expected);
+  cairo_surface_destroy (surface);
+
+  /* the alpha factor is rounded to 1/256 */
+  temp = blxo_gdk_pixbuf_lucent (opaque, 50);
+  expected = blxo_gdk_pixbuf_create_surface (temp);
+  g_object_unref (G_OBJECT (temp));
+  surface = blxo_gdk_pixbuf_create_surface (opaque);
+  blxo_cairo_surface_lucent (surface, 50);
+  assert_surfaces_equal (surface, expected, 2);
+  cairo_surface_destroy (expected);
+  cairo_surface_destroy (surface);
+
+  /* the filters differ, but neither may darken or fade the edges */
+  gradient = create_pixbuf (gdk_pixbuf_get_width (source), gdk_pixbuf_get_height (source), TRUE, 0, TRUE);
+  temp = blxo_gdk_pixbuf_scale_down (gradient, TRUE, 32, 32);
+  expected = blxo_gdk_pixbuf_create_surface (temp);
+  g_object_unref (G_OBJECT (temp));
+  surface = blxo_gdk_pixbuf_create_surface (gradient);
+  scaled = blxo_cairo_surface_scale_down (surface, TRUE, 32, 32);
+  assert_surfaces_equal (scaled, expected, SCALE_MAX_DIFF);
+  cairo_surface_destroy (scaled);
+  cairo_surface_destroy (expected);
+  cairo_surface_destroy (surface);
+  g_object_unref (G_OBJECT (gradient));
+
+  g_object_unref (G_OBJECT (opaque));
+}
+
+
+
+static void
+test_colorize (void)
+{
+  foreach_pixbuf (check_colorize, FALSE);
+}
+
+
+
+static void
+test_spotlight (void)
+{
+  foreach_pixbuf (check_spotlight, FALSE);
+}
+
+
+
+static void
+test_lucent (void)
+{
+  foreach_pixbuf (check_lucent, FALSE);
+}
+
+
+
+static void
+test_scale_down (void)
+{
+  foreach_pixbuf (check_scale_down, TRUE);
+}
+
+
+
+static void
+test_scale_ratio (void)
+{
+  foreach_pixbuf (check_scale_ratio, TRUE);
+}
+
+
+
+static void
+test_effects (void)
+{
+  foreach_pixbuf (check_effects, FALSE);
+}
+
+
+
+static void
+test_frame (void)
+{
+  foreach_pixbuf (check_frame, FALSE);
+}
+
+
+
+static void
+test_surfaces (void)
+{
+  foreach_pixbuf (check_surfaces, FALSE);
+}
+
+
+
+static void
+test_kernels (gconstpointer level)
+{
+  /* the kernels are picked once per process */
+  if (g_test_subprocess ())
+    {
+      test_colorize ();
+      test_spotlight ();
+      test_lucent ();
+      test_effects ();
+      test_surfaces ();
+      return;
+    }
+
+  g_setenv ("BLXO_PIXBUF_KERNELS", level, TRUE);
+  g_test_trap_subprocess (NULL, 0, 0);
+  g_unsetenv ("BLXO_PIXBUF_KERNELS");
+  g_test_trap_assert_passed ();
+}
+
+
+
+gint
+main (gint    argc,
+      gchar **argv)
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/pixbuf/colorize", test_colorize);
+  g_test_add_func ("/pixbuf/spotlight", test_spotlight);
+  g_test_add_func ("/pixbuf/lucent", test_lucent);
+  g_test_add_func ("/pixbuf/scale-down", test_scale_down);
+  g_test_add_func ("/pixbuf/scale-ratio", test_scale_ratio);
+  g_test_add_func ("/pixbuf/effects", test_effects);
+  g_test_add_func ("/pixbuf/frame", test_frame);
+  g_test_add_func ("/pixbuf/surfaces", test_surfaces);
+  g_test_add_data_func ("/pixbuf/kernels/sse2", "sse2", test_kernels);
+  g_test_add_data_func ("/pixbuf/kernels/scalar", "scalar", test_kernels);
+
+  return g_test_run ();
+}
@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) 2026 Xfce Development Team <xfce4-dev@xfce.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <glib/gstdio.h>
+
+#include <blxo/blxo.h>
+
+/* the number of images in the view, and their size */
+#define N_IMAGES   (64)
+#define IMAGE_SIZE (200)
+
+/* microseconds to wait for the prefetched thumbnails */
+#define TIMEOUT (10 * G_USEC_PER_SEC)
+
+
+
+static gboolean  have_display = FALSE;
+static gchar    *cache_dir = NULL;
+
+
+
+static gchar*
+thumbnail_path (const gchar *filename)
+{
+  gchar *checksum;
+  gchar *basename;
+  gchar *path;
+  gchar *uri;
+
+  uri = g_filename_to_uri (filename, NULL, NULL);
+  checksum = g_compute_checksum_for_string (G_CHECKSUM_MD5, uri, -1);
+  basename = g_strconcat (checksum, ".png", NULL);
+  path = g_build_filename (cache_dir, "thumbnails", "normal", basename, NULL);
+  g_free (basename);
+  g_free (checksum);
+  g_free (uri);
+
+  return path;
+}
+
+
+
+static gboolean
+wait_for_file (const gchar *path)
+{
+  gint64 deadline = g_get_monotonic_time () + TIMEOUT;
+
+  /* the thumbnails are saved by the workers of the icon cache */
+  while (!g_file_test (path, G_FILE_TEST_EXISTS))
+    {
+      if (g_get_monotonic_time () > deadline)
+        return FALSE;
+
+      if (!g_main_context_iteration (NULL, FALSE))
+        g_usleep (1000);
+    }
+
+  return TRUE;
+}
+
+
+
+static void
+test_prefetch_sync (void)
+{
+  GtkCellRenderer *renderer;
+  GtkListStore    *store;
+  GtkTreePath     *end_path = NULL;
+  GtkTreeIter      iter;
+  GtkWidget       *window;
+  GtkWidget       *swin;
+  GtkWidget       *view;
+  GdkPixbuf       *pixbuf;
+  gchar           *filenames[N_IMAGES];
+  gchar           *image_dir;
+  gchar           *path;
+  gchar           *name;
+  gint             end;
+  gint             n;
+
+  if (!have_display)
+    {
+      g_test_skip ("no display");
+      return;
+    }
+
+  /* images, that are larger than normal sized thumbnails */
+  image_dir = g_dir_make_tmp ("blxo-prefetch-XXXXXX", NULL);
+  g_assert (image_dir != NULL);
+  pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, FALSE, 8, IMAGE_SIZE, IMAGE_SIZE);
+  store = gtk_list_store_new (1, G_TYPE_STRING);
+  for (n = 0; n < N_IMAGES; ++n)
+    {
+      name = g_strdup_printf ("image-%02d.png", n);
+      filenames[n] = g_build_filename (image_dir, name, NULL);
+      gdk_pixbuf_fill (pixbuf, 0x10204000 + n);
+      g_assert (gdk_pixbuf_save (pixbuf, filenames[n], "png", NULL, NULL));
+      gtk_list_store_insert_with_values (store, &iter, n, 0, filenames[n], -1);
+      g_free (name);
+    }
+  g_object_unref (G_OBJECT (pixbuf));
+
+  /* a view that loads its images synchronously, showing only a few rows */
+  view = blxo_icon_view_new_with_model (GTK_TREE_MODEL (store));
+  renderer = blxo_cell_renderer_icon_new ();
+  g_object_set (G_OBJECT (renderer), "async", FALSE, "follow-state", FALSE, "size", 128, NULL);
+  gtk_cell_layout_pack_start (GTK_CELL_LAYOUT (view), renderer, FALSE);
+  gtk_cell_layout_add_attribute (GTK_CELL_LAYOUT (view), renderer, "icon", 0);
+
+  swin = gtk_scrolled_window_new (NULL, NULL);
+  gtk_scrolled_window_set_policy (GTK_SCROLLED_WINDOW (swin), GTK_POLICY_NEVER, GTK_POLICY_ALWAYS);
+  gtk_container_add (GTK_CONTAINER (swin), view);
+
+  window = gtk_offscreen_window_new ();
+  gtk_window_set_default_size (GTK_WINDOW (window), 400, 300);
+  gtk_container_add (GTK_CONTAINER (window), swin);
+  gtk_widget_show_all (window);
+
+  /* wait until the view is allocated, laid out and painted */
+  while (gtk_events_pending ())
+    gtk_main_iteration ();
+  g_assert (blxo_icon_view_get_visible_range (BLXO_ICON_VIEW (view), NULL, &end_path));
+  end = gtk_tree_path_get_indices (end_path)[0];
+  gtk_tree_path_free (end_path);
+  g_assert_cmpint (end + 1, <, N_IMAGES);
+
+  /* the item after the visible ones is never painted, so its thumbnail
+   * can only have been generated by the prefetch of the view */
+  path = thumbnail_path (filenames[end + 1]);
+  g_assert (wait_for_file (path));
+  g_free (path);
+
+  gtk_widget_destroy (window);
+  g_object_unref (G_OBJECT (store));
+
+  for (n = 0; n < N_IMAGES; ++n)
+    {
+      g_unlink (filenames[n]);
+      g_free (filenames[n]);
+    }
+  g_rmdir (image_dir);
+  g_free (image_dir);
+}
+
+
+
+gint
+main (gint    argc,
+      gchar **argv)
+{
+  gint result;
+
+  /* generate the thumbnails in a cache directory of our own */
+  cache_dir = g_dir_make_tmp ("blxo-cache-XXXXXX", NULL);
+  g_setenv ("XDG_CACHE_HOME", cache_dir, TRUE);
+
+  g_test_init (&argc, &argv, NULL);
+  have_display = gtk_init_check (&argc, &argv);
+
+  g_test_add_func ("/icon-view/prefetch-sync", test_prefetch_sync);
+
+  result = g_test_run ();
+
+  g_free (cache_dir);
+
+  return result;
+}
@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2026 Xfce Development Team <xfce4-dev@xfce.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include <blxo/blxo-thumbnail-path.h>
+
+
+
+static const gchar *uris[] =
+{
+  "file:///home/user/picture.png",
+  "file:///home/user/a%20picture%20with%20spaces.jpg",
+  "file:///home/user/%C3%A4%C3%B6%C3%BC.png",
+  "sftp://host/srv/photos/IMG_0001.CR2",
+  "file:///",
+};
+
+
+
+static gchar*
+thumbnail_path (const gchar *uri,
+                const gchar *dir)
+{
+  gchar *checksum;
+  gchar *filename;
+  gchar *path;
+
+  /* the path as specified by the thumbnail managing standard */
+  checksum = g_compute_checksum_for_string (G_CHECKSUM_MD5, uri, -1);
+  filename = g_strconcat (checksum, ".png", NULL);
+  path = g_build_path ("/", g_get_user_cache_dir (), "thumbnails", dir, filename, NULL);
+  g_free (filename);
+  g_free (checksum);
+
+  return path;
+}
+
+
+
+static void
+test_path_builder_build (void)
+{
+  static const struct
+  {
+    BlxoThumbnailSize size;
+    const gchar     *dir;
+  } sizes[] =
+  {
+    { BLXO_THUMBNAIL_SIZE_NORMAL,   "normal"   },
+    { BLXO_THUMBNAIL_SIZE_LARGE,    "large"    },
+    { BLXO_THUMBNAIL_SIZE_X_LARGE,  "x-large"  },
+    { BLXO_THUMBNAIL_SIZE_XX_LARGE, "xx-large" },
+  };
+  BlxoThumbnailPathBuilder *builder;
+  gchar                    *expected;
+  guint                     n, m;
+
+  builder = _blxo_thumbnail_path_builder_new ();
+
+  for (n = 0; n < G_N_ELEMENTS (sizes); ++n)
+    for (m = 0; m < G_N_ELEMENTS (uris); ++m)
+      {
+        expected = thumbnail_path (uris[m], sizes[n].dir);
+        g_assert_cmpstr (_blxo_thumbnail_path_builder_build (builder, uris[m], sizes[n].size), ==, expected);
+        g_free (expected);
+      }
+
+  _blxo_thumbnail_path_builder_free (builder);
+}
+
+
+
+static void
+test_path_builder_build_failure (void)
+{
+  BlxoThumbnailPathBuilder *builder;
+  const gchar              *path;
+  gchar                    *checksum;
+  gchar                    *filename;
+  gchar                    *prefix;
+  guint                     m;
+
+  builder = _blxo_thumbnail_path_builder_new ();
+  prefix = g_build_path ("/", g_get_user_cache_dir (), "thumbnails", "fail", "blxo-", NULL);
+
+  for (m = 0; m < G_N_ELEMENTS (uris); ++m)
+    {
+      /* failure markers are kept below fail/ in a directory of our own */
+      path = _blxo_thumbnail_path_builder_build_failure (builder, uris[m]);
+      g_assert (g_str_has_prefix (path, prefix));
+      g_assert (strchr (path + strlen (prefix), '/') != NULL);
+
+      checksum = g_compute_checksum_for_string (G_CHECKSUM_MD5, uris[m], -1);
+      filename = g_strconcat (checksum, ".png", NULL);
+      g_assert_cmpstr (strrchr (path, '/') + 1, ==, filename);
+      g_free (filename);
+      g_free (checksum);
+    }
+
+  g_free (prefix);
+  _blxo_thumbnail_path_builder_free (builder);
+}
+
+
+
+static gpointer
+test_path_builder_thread (gpointer data)
+{
+  return _blxo_thumbnail_path_builder_get_default ();
+}
+
+
+
+static void
+test_path_builder_get_default (void)
+{
+  BlxoThumbnailPathBuilder *builder;
+  GThread                  *thread;
+
+  /* every thread gets a builder of its own */
+  builder = _blxo_thumbnail_path_builder_get_default ();
+  g_assert (builder != NULL);
+  g_assert (_blxo_thumbnail_path_builder_get_default () == builder);
+
+  thread = g_thread_new ("path-builder", test_path_builder_thread, NULL);
+  g_assert (g_thread_join (thread) != builder);
+}
+
+
+
+gint
+main (gint    argc,
+      gchar **argv)
+{
+  /* the builder determines the directories from the cache dir */
+  g_setenv ("XDG_CACHE_HOME", "/tmp/blxo-test-cache", TRUE);
+
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/thumbnail-path/build", test_path_builder_build);
+  g_test_add_func ("/thumbnail-path/build-failure", test_path_builder_build_failure);
+  g_test_add_func ("/thumbnail-path/get-default", test_path_builder_get_default);
+
+  return g_test_run ();
+}